@@ -0,0 +1,236 @@
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/node.h"
+#include "ns3/mobility-model.h"
+#include "ns3/double.h"
+#include "ns3/boolean.h"
+#include "ns3/uinteger.h"
+#include "AbstractChannel.h"
+#include "AbstractNetDevice.h"
+#ifdef NS3_MPI
+#include "ns3/mpi-interface.h"
+#endif
+
+NS_LOG_COMPONENT_DEFINE("AbstractChannel");
+NS_OBJECT_ENSURE_REGISTERED(AbstractChannel);
+
+//光速 单位m/s，用于计算传播时延
+const double SPEED_OF_LIGHT = 299792458.0;
+
+TypeId AbstractChannel::GetTypeId()
+{
+    static TypeId tid = TypeId("ns3::AbstractChannel")
+                .SetParent <Channel> ()
+                .AddConstructor<AbstractChannel> ()
+                .AddAttribute ("MaxRange", "最大通信距离 单位m",
+                      DoubleValue (150),
+                      MakeDoubleAccessor (&AbstractChannel::m_max_range),
+                      MakeDoubleChecker<double> (1.0)
+                      )
+                .AddAttribute ("ReliableRange", "一定能收到的距离 单位m，超过后收到的概率线性下降",
+                      DoubleValue (150),
+                      MakeDoubleAccessor (&AbstractChannel::m_reliable_range),
+                      MakeDoubleChecker<double> (0.0)
+                      )
+                .AddAttribute ("FrameAirtime", "每帧占用信道的时间",
+                      TimeValue (MicroSeconds (250)),
+                      MakeTimeAccessor (&AbstractChannel::m_frame_airtime),
+                      MakeTimeChecker ()
+                      )
+                .AddAttribute ("Contention", "是否模拟CSMA退避和接收冲突",
+                      BooleanValue (false),
+                      MakeBooleanAccessor (&AbstractChannel::m_contention),
+                      MakeBooleanChecker ()
+                      )
+                .AddAttribute ("SlotTime", "退避时隙，默认为802.11p 10MHz的时隙",
+                      TimeValue (MicroSeconds (13)),
+                      MakeTimeAccessor (&AbstractChannel::m_slot_time),
+                      MakeTimeChecker ()
+                      )
+                .AddAttribute ("CwMin", "最小竞争窗口",
+                      UintegerValue (15),
+                      MakeUintegerAccessor (&AbstractChannel::m_cw_min),
+                      MakeUintegerChecker<uint32_t> ()
+                      )
+                .AddAttribute ("MaxSpeed", "车辆最大速度 单位m/s",
+                      DoubleValue (70),
+                      MakeDoubleAccessor (&AbstractChannel::m_max_speed),
+                      MakeDoubleChecker<double> (0.0)
+                      )
+                .AddAttribute ("UpdateInterval", "根据移动模型更新网格的周期",
+                      TimeValue (Seconds (1)),
+                      MakeTimeAccessor (&AbstractChannel::m_update_interval),
+                      MakeTimeChecker ()
+                      )
+                .AddAttribute ("MinRemoteDelay", "分布式仿真时跨进程投递的最小时延（lookahead），越大并行度越高，跨进程的帧到达得越晚，默认与FrameAirtime相同",
+                      TimeValue (MicroSeconds (250)),
+                      MakeTimeAccessor (&AbstractChannel::m_min_remote_delay),
+                      MakeTimeChecker ()
+                      )
+                      ;
+    return tid;
+}
+
+AbstractChannel::AbstractChannel()
+{
+    m_random = CreateObject<UniformRandomVariable>();
+    m_tx_count = 0;
+    m_rx_event_count = 0;
+}
+
+AbstractChannel::~AbstractChannel()
+{
+
+}
+
+void AbstractChannel::DoDispose()
+{
+    Simulator::Cancel(m_update_event);
+    m_devices.clear();
+    m_grid.Clear();
+    Channel::DoDispose();
+}
+
+void AbstractChannel::Add(Ptr<AbstractNetDevice> dev)
+{
+    if (m_devices.empty()) {
+        m_grid.SetCellSize(m_max_range);
+    }
+    m_devices.push_back(dev);
+
+    Ptr<MobilityModel> mobility = dev->GetNode()->GetObject<MobilityModel>();
+    if (mobility) {
+        m_grid.Update(dev, mobility->GetPosition());
+    }
+    if (!m_update_event.IsRunning()) {
+        m_update_event = Simulator::Schedule(m_update_interval, &AbstractChannel::UpdateGrid, this);
+    }
+}
+
+void AbstractChannel::Remove(Ptr<AbstractNetDevice> dev)
+{
+    for (vector< Ptr<AbstractNetDevice> >::iterator iter = m_devices.begin(); iter != m_devices.end(); iter++) {
+        if (*iter == dev) {
+            m_devices.erase(iter);
+            break;
+        }
+    }
+    m_grid.Remove(dev);
+}
+
+void AbstractChannel::UpdateGrid()
+{
+    for (vector< Ptr<AbstractNetDevice> >::iterator iter = m_devices.begin(); iter != m_devices.end(); iter++) {
+        Ptr<MobilityModel> mobility = (*iter)->GetNode()->GetObject<MobilityModel>();
+        if (mobility) {
+            m_grid.Update(*iter, mobility->GetPosition());
+        }
+    }
+    m_update_event = Simulator::Schedule(m_update_interval, &AbstractChannel::UpdateGrid, this);
+}
+
+void AbstractChannel::Send(Ptr<AbstractNetDevice> sender, Ptr<const Packet> packet, Mac48Address src, Mac48Address dest, uint16_t protocol)
+{
+    m_tx_count++;
+    Ptr<MobilityModel> senderMobility = sender->GetNode()->GetObject<MobilityModel>();
+    if (!senderMobility) {
+        NS_LOG_WARN("发送节点没有移动模型，丢弃");
+        return;
+    }
+    Vector pos = senderMobility->GetPosition();
+
+    //两次网格更新之间收发双方都可能移动
+    vector< Ptr<AbstractNetDevice> > candidates;
+    m_grid.GetItemsInRange(pos, m_max_range + 2 * m_max_speed * m_update_interval.GetSeconds(), candidates);
+
+    for (vector< Ptr<AbstractNetDevice> >::iterator iter = candidates.begin(); iter != candidates.end(); iter++) {
+        if (*iter == sender) {
+            continue;
+        }
+        double distance = CalculateDistance(pos, (*iter)->GetNode()->GetObject<MobilityModel>()->GetPosition());
+        if (distance > m_max_range) {
+            continue;
+        }
+        if (distance > m_reliable_range &&
+            m_random->GetValue() > (m_max_range - distance) / (m_max_range - m_reliable_range)) {
+            continue;
+        }
+        m_rx_event_count++;
+        Ptr<Node> receiver = (*iter)->GetNode();
+        if (receiver->GetSystemId() != Simulator::GetSystemId()) {
+            SendRemote(*iter, packet, src, dest, protocol, Seconds(distance / SPEED_OF_LIGHT));
+            continue;
+        }
+        Simulator::ScheduleWithContext(receiver->GetId(), Seconds(distance / SPEED_OF_LIGHT),
+                                       &AbstractNetDevice::StartReceive, *iter, packet, src, dest, protocol);
+    }
+}
+
+void AbstractChannel::SendRemote(Ptr<AbstractNetDevice> receiver, Ptr<const Packet> packet, Mac48Address src, Mac48Address dest, uint16_t protocol, Time delay)
+{
+#ifdef NS3_MPI
+    AbstractFrameHeader header;
+    header.m_src = src;
+    header.m_dest = dest;
+    header.m_protocol = protocol;
+    Ptr<Packet> copy = packet->Copy();
+    copy->AddHeader(header);
+    if (delay < GetRemoteDelay()) {
+        delay = GetRemoteDelay();
+    }
+    MpiInterface::SendPacket(copy, Simulator::Now() + delay, receiver->GetNode()->GetId(), receiver->GetIfIndex());
+#else
+    NS_FATAL_ERROR ("节点" << receiver->GetNode()->GetId() << "不在本进程上，但没有启用MPI");
+#endif
+}
+
+std::size_t AbstractChannel::GetNDevices (void) const
+{
+    return m_devices.size();
+}
+
+Ptr<NetDevice> AbstractChannel::GetDevice (std::size_t i) const
+{
+    return m_devices.at(i);
+}
+
+Time AbstractChannel::GetFrameAirtime()
+{
+    return m_frame_airtime;
+}
+
+bool AbstractChannel::IsContentionEnabled()
+{
+    return m_contention;
+}
+
+Time AbstractChannel::GetSlotTime()
+{
+    return m_slot_time;
+}
+
+uint32_t AbstractChannel::GetCwMin()
+{
+    return m_cw_min;
+}
+
+Time AbstractChannel::GetRemoteDelay()
+{
+    Time propagation = Seconds(m_max_range / SPEED_OF_LIGHT);
+    return m_min_remote_delay > propagation ? m_min_remote_delay : propagation;
+}
+
+uint64_t AbstractChannel::GetTxCount()
+{
+    return m_tx_count;
+}
+
+uint64_t AbstractChannel::GetRxEventCount()
+{
+    return m_rx_event_count;
+}
+
+uint64_t AbstractChannel::GetMemoryBytes()
+{
+    return VectorBytes(m_devices) + m_grid.GetMemoryBytes();
+}
@@ -0,0 +1,92 @@
+#ifndef ABSTRACT_CHANNEL_H
+#define ABSTRACT_CHANNEL_H
+
+#include "ns3/channel.h"
+#include "ns3/packet.h"
+#include "ns3/mac48-address.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/event-id.h"
+#include "SpatialGrid.h"
+#include <vector>
+
+using namespace ns3;
+using namespace std;
+
+class AbstractNetDevice;
+
+/*
+ * 抽象链路层的信道，配合AbstractNetDevice使用
+ * 不模拟802.11p的PHY/MAC，只按距离决定是否投递：
+ * ReliableRange内一定收到，ReliableRange到MaxRange之间收到的概率线性下降到0
+ * 每帧占用固定的FrameAirtime，Contention打开时按简单的CSMA退避并检测接收端冲突
+ * 用于大规模车群协议的仿真，协议代码不需要修改
+ * 分布式仿真时接收节点在其它进程上的帧通过MpiInterface发送，
+ * 到达时间至少推迟GetRemoteDelay()，作为分布式调度器的lookahead
+ * 各进程每次只能前进一个lookahead，只用MaxRange处的传播时延（约1us）时进程之间几乎串行，
+ * 所以MinRemoteDelay默认取一帧的空中时间（250us）：跨进程的帧比单进程仿真晚到最多250us，
+ * 相当于在接收端晚一帧开始接收，只影响跨进程的车群之间的消息（车群内的节点划分在同一进程）的时延和冲突判断；
+ * 需要与单进程结果逐帧一致时把MinRemoteDelay设为0，代价是失去并行度
+ */
+class AbstractChannel : public Channel
+{
+public:
+    static TypeId GetTypeId (void);
+    AbstractChannel();
+    virtual ~AbstractChannel();
+
+    //加入/移除设备
+    void Add(Ptr<AbstractNetDevice> dev);
+    void Remove(Ptr<AbstractNetDevice> dev);
+
+    //把一帧发给通信范围内的设备
+    void Send(Ptr<AbstractNetDevice> sender, Ptr<const Packet> packet, Mac48Address src, Mac48Address dest, uint16_t protocol);
+
+    // Channel的接口
+    virtual std::size_t GetNDevices (void) const;
+    virtual Ptr<NetDevice> GetDevice (std::size_t i) const;
+
+    //设备使用的参数
+    Time GetFrameAirtime();
+    bool IsContentionEnabled();
+    Time GetSlotTime();
+    uint32_t GetCwMin();
+
+    //跨进程投递的最小时延：MinRemoteDelay与MaxRange处传播时延中的较大者，精度与并行度的取舍见类的注释
+    Time GetRemoteDelay();
+
+    //统计信息
+    uint64_t GetTxCount();
+    uint64_t GetRxEventCount();
+
+    //信道数据结构（设备列表、网格）占用的内存 单位byte
+    uint64_t GetMemoryBytes();
+
+private:
+    virtual void DoDispose (void);
+
+    //根据当前位置重新放置所有设备，周期性调用
+    void UpdateGrid();
+
+    //接收设备在其它进程上时，通过MpiInterface把帧发过去
+    void SendRemote(Ptr<AbstractNetDevice> receiver, Ptr<const Packet> packet, Mac48Address src, Mac48Address dest, uint16_t protocol, Time delay);
+
+    double m_max_range;//最大通信距离 单位m
+    double m_reliable_range;//一定能收到的距离 单位m
+    Time m_frame_airtime;//每帧占用信道的时间
+    bool m_contention;//是否模拟信道竞争
+    Time m_slot_time;//退避时隙
+    uint32_t m_cw_min;//最小竞争窗口
+    double m_max_speed;//车辆最大速度 单位m/s，用于估计两次更新之间的位移
+    Time m_update_interval;//网格更新周期
+    Time m_min_remote_delay;//跨进程投递的最小时延
+    EventId m_update_event;
+
+    vector< Ptr<AbstractNetDevice> > m_devices;
+    SpatialGrid< Ptr<AbstractNetDevice> > m_grid;
+    Ptr<UniformRandomVariable> m_random;
+
+    uint64_t m_tx_count;
+    uint64_t m_rx_event_count;
+};
+
+#endif
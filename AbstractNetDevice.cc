@@ -0,0 +1,471 @@
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/uinteger.h"
+#include "ns3/boolean.h"
+#include "ns3/socket.h"
+#include "ns3/qos-utils.h"
+#include "ns3/address-utils.h"
+#include "AbstractNetDevice.h"
+#include "AbstractChannel.h"
+#include "LatencyStats.h"
+#ifdef NS3_MPI
+#include "ns3/mpi-receiver.h"
+#endif
+
+NS_LOG_COMPONENT_DEFINE("AbstractNetDevice");
+NS_OBJECT_ENSURE_REGISTERED(AbstractNetDevice);
+NS_OBJECT_ENSURE_REGISTERED(AbstractFrameHeader);
+
+TypeId AbstractFrameHeader::GetTypeId()
+{
+    static TypeId tid = TypeId("ns3::AbstractFrameHeader")
+                .SetParent <Header> ()
+                .AddConstructor<AbstractFrameHeader> ()
+                ;
+    return tid;
+}
+
+TypeId AbstractFrameHeader::GetInstanceTypeId() const
+{
+    return GetTypeId();
+}
+
+uint32_t AbstractFrameHeader::GetSerializedSize() const
+{
+    return 6 + 6 + 2;
+}
+
+void AbstractFrameHeader::Serialize(Buffer::Iterator start) const
+{
+    WriteTo(start, m_src);
+    WriteTo(start, m_dest);
+    start.WriteU16(m_protocol);
+}
+
+uint32_t AbstractFrameHeader::Deserialize(Buffer::Iterator start)
+{
+    ReadFrom(start, m_src);
+    ReadFrom(start, m_dest);
+    m_protocol = start.ReadU16();
+    return GetSerializedSize();
+}
+
+void AbstractFrameHeader::Print(std::ostream &os) const
+{
+    os << "src=" << m_src << " dest=" << m_dest << " protocol=" << m_protocol;
+}
+
+TypeId AbstractNetDevice::GetTypeId()
+{
+    static TypeId tid = TypeId("ns3::AbstractNetDevice")
+                .SetParent <NetDevice> ()
+                .AddConstructor<AbstractNetDevice> ()
+                .AddAttribute ("MaxQueueSize", "每个接入类别的发送队列的最大长度，超过则丢弃",
+                      UintegerValue (100),
+                      MakeUintegerAccessor (&AbstractNetDevice::m_max_queue_size),
+                      MakeUintegerChecker<uint32_t> ()
+                      )
+                .AddAttribute ("Qos", "按帧的优先级分到各接入类别的队列，关闭时所有帧在同一个队列中按到达顺序发送",
+                      BooleanValue (true),
+                      MakeBooleanAccessor (&AbstractNetDevice::m_qos),
+                      MakeBooleanChecker ()
+                      )
+                      ;
+    return tid;
+}
+
+AbstractNetDevice::AbstractNetDevice()
+{
+    m_ifIndex = 0;
+    m_mtu = 1500;
+    m_transmitting = false;
+    m_next_rx_id = 0;
+    m_backoff = CreateObject<UniformRandomVariable>();
+    m_collision_count = 0;
+    m_queue_drop_count = 0;
+    m_qos = true;
+    m_link_up = true;
+    m_busy_time = Seconds(0);
+    m_busy_mark = Seconds(0);
+}
+
+AbstractNetDevice::~AbstractNetDevice()
+{
+
+}
+
+void AbstractNetDevice::DoDispose()
+{
+    Simulator::Cancel(m_tx_event);
+    for (uint8_t q = 0; q < ABSTRACT_QUEUE_COUNT; q++) {
+        m_queues[q].clear();
+    }
+    m_node = 0;
+    m_channel = 0;
+    NetDevice::DoDispose();
+}
+
+void AbstractNetDevice::SetChannel(Ptr<AbstractChannel> channel)
+{
+    m_channel = channel;
+    m_channel->Add(this);
+#ifdef NS3_MPI
+    //其它进程发来的帧由MpiInterface交给设备上聚合的MpiReceiver
+    Ptr<MpiReceiver> receiver = CreateObject<MpiReceiver>();
+    receiver->SetReceiveCallback(MakeCallback(&AbstractNetDevice::ReceiveRemote, this));
+    AggregateObject(receiver);
+#endif
+}
+
+void AbstractNetDevice::SetLinkDown()
+{
+    m_link_up = false;
+    Simulator::Cancel(m_tx_event);
+    m_transmitting = false;
+    for (uint8_t q = 0; q < ABSTRACT_QUEUE_COUNT; q++) {
+        m_queues[q].clear();
+    }
+    m_receptions.clear();
+}
+
+uint64_t AbstractNetDevice::GetCollisionCount()
+{
+    return m_collision_count;
+}
+
+uint64_t AbstractNetDevice::GetQueueDropCount()
+{
+    return m_queue_drop_count;
+}
+
+void AbstractNetDevice::GetMemoryUsage(MemoryUsage& usage)
+{
+    //队列中的数据包由设备独占，按Packet对象加上载荷估计
+    uint64_t packets = 0;
+    for(uint8_t q = 0; q < ABSTRACT_QUEUE_COUNT; q++){
+        for(deque<PendingFrame>::iterator iter = m_queues[q].begin(); iter != m_queues[q].end(); iter++){
+            packets += sizeof(Packet) + iter->packet->GetSize();
+        }
+        packets += DequeBytes(m_queues[q]);
+    }
+    usage["device_queue"] += packets;
+    usage["device_receptions"] += VectorBytes(m_receptions);
+}
+
+Time AbstractNetDevice::GetBackoff(uint8_t queue)
+{
+    uint32_t cw = m_channel->GetCwMin();
+    int64_t aifs = 0;
+    if (queue == 0) {
+        cw = (cw + 1) / 4 - 1;
+    } else if (queue == 1) {
+        cw = (cw + 1) / 2 - 1;
+    } else if (queue == 3) {
+        aifs = 4;
+    }
+    return m_channel->GetSlotTime() * (aifs + (int64_t)m_backoff->GetInteger(0, cw));
+}
+
+uint8_t AbstractNetDevice::GetQueueIndex(Ptr<const Packet> packet)
+{
+    SocketPriorityTag priority;
+    if (!m_qos || !packet->PeekPacketTag(priority)) {
+        return 2;
+    }
+    switch (QosUtilsMapTidToAc(priority.GetPriority() & 0x07)) {
+        case AC_VO:
+            return 0;
+        case AC_VI:
+            return 1;
+        case AC_BK:
+            return 3;
+        default:
+            return 2;
+    }
+}
+
+uint8_t AbstractNetDevice::GetHeadQueue()
+{
+    for (uint8_t q = 0; q < ABSTRACT_QUEUE_COUNT; q++) {
+        if (!m_queues[q].empty()) {
+            return q;
+        }
+    }
+    return ABSTRACT_QUEUE_COUNT;
+}
+
+void AbstractNetDevice::MarkBusy(Time end)
+{
+    Time start = Now() > m_busy_mark ? Now() : m_busy_mark;
+    if (end > start) {
+        m_busy_time += end - start;
+        m_busy_mark = end;
+    }
+}
+
+Time AbstractNetDevice::GetBusyTime()
+{
+    //不计还没有过去的部分
+    if (m_busy_mark > Now()) {
+        return m_busy_time - (m_busy_mark - Now());
+    }
+    return m_busy_time;
+}
+
+void AbstractNetDevice::TryTransmit()
+{
+    uint8_t queue = GetHeadQueue();
+    if (queue == ABSTRACT_QUEUE_COUNT || m_transmitting) {
+        return;
+    }
+    bool contention = m_channel->IsContentionEnabled();
+
+    //信道忙则等到空闲后再随机退避，退避结束时重新选择队列，期间到达的高优先级帧先发
+    if (contention && (Now() < m_busy_until || !m_receptions.empty())) {
+        Time wait = GetBackoff(queue);
+        if (Now() < m_busy_until) {
+            wait += m_busy_until - Now();
+        }
+        m_tx_event = Simulator::Schedule(wait, &AbstractNetDevice::TryTransmit, this);
+        return;
+    }
+
+    PendingFrame frame = m_queues[queue].front();
+    m_queues[queue].pop_front();
+    m_transmitting = true;
+    LatencyStats::Get()->RecordQueueDelay(frame.packet, Now() - frame.enqueued);
+
+    //半双工，发送时正在接收的帧都收不到
+    if (contention) {
+        for (vector<Reception>::iterator iter = m_receptions.begin(); iter != m_receptions.end(); iter++) {
+            iter->collided = true;
+        }
+    }
+    m_channel->Send(this, frame.packet, frame.src, frame.dest, frame.protocol);
+    MarkBusy(Now() + m_channel->GetFrameAirtime());
+    m_tx_event = Simulator::Schedule(m_channel->GetFrameAirtime(), &AbstractNetDevice::EndTransmit, this);
+}
+
+void AbstractNetDevice::EndTransmit()
+{
+    m_transmitting = false;
+    uint8_t queue = GetHeadQueue();
+    if (queue == ABSTRACT_QUEUE_COUNT) {
+        return;
+    }
+    if (m_channel->IsContentionEnabled()) {
+        m_tx_event = Simulator::Schedule(GetBackoff(queue), &AbstractNetDevice::TryTransmit, this);
+    } else {
+        TryTransmit();
+    }
+}
+
+void AbstractNetDevice::StartReceive(Ptr<const Packet> packet, Mac48Address src, Mac48Address dest, uint16_t protocol)
+{
+    if (!m_link_up) {
+        return;
+    }
+    Time airtime = m_channel->GetFrameAirtime();
+    Reception reception;
+    reception.id = m_next_rx_id++;
+    reception.collided = false;
+
+    //与正在发送或正在接收的帧重叠，则都收不到
+    if (m_channel->IsContentionEnabled() && (m_transmitting || !m_receptions.empty())) {
+        reception.collided = true;
+        for (vector<Reception>::iterator iter = m_receptions.begin(); iter != m_receptions.end(); iter++) {
+            iter->collided = true;
+        }
+    }
+    m_receptions.push_back(reception);
+    if (Now() + airtime > m_busy_until) {
+        m_busy_until = Now() + airtime;
+    }
+    MarkBusy(Now() + airtime);
+    Simulator::Schedule(airtime, &AbstractNetDevice::EndReceive, this, reception.id, packet, src, dest, protocol);
+}
+
+void AbstractNetDevice::ReceiveRemote(Ptr<Packet> packet)
+{
+    AbstractFrameHeader header;
+    packet->RemoveHeader(header);
+    StartReceive(packet, header.m_src, header.m_dest, header.m_protocol);
+}
+
+void AbstractNetDevice::EndReceive(uint64_t id, Ptr<const Packet> packet, Mac48Address src, Mac48Address dest, uint16_t protocol)
+{
+    //断开链路之前开始接收的帧
+    if (!m_link_up) {
+        return;
+    }
+    bool collided = false;
+    for (vector<Reception>::iterator iter = m_receptions.begin(); iter != m_receptions.end(); iter++) {
+        if (iter->id == id) {
+            collided = iter->collided;
+            m_receptions.erase(iter);
+            break;
+        }
+    }
+    if (collided) {
+        m_collision_count++;
+        return;
+    }
+
+    NetDevice::PacketType type;
+    if (dest.IsBroadcast()) {
+        type = NetDevice::PACKET_BROADCAST;
+    } else if (dest.IsGroup()) {
+        type = NetDevice::PACKET_MULTICAST;
+    } else if (dest == m_address) {
+        type = NetDevice::PACKET_HOST;
+    } else {
+        type = NetDevice::PACKET_OTHERHOST;
+    }
+
+    if (!m_promiscRxCallback.IsNull()) {
+        m_promiscRxCallback(this, packet->Copy(), protocol, src, dest, type);
+    }
+    if (type != NetDevice::PACKET_OTHERHOST && !m_rxCallback.IsNull()) {
+        m_rxCallback(this, packet->Copy(), protocol, src);
+    }
+}
+
+void AbstractNetDevice::SetIfIndex (const uint32_t index)
+{
+    m_ifIndex = index;
+}
+
+uint32_t AbstractNetDevice::GetIfIndex (void) const
+{
+    return m_ifIndex;
+}
+
+Ptr<Channel> AbstractNetDevice::GetChannel (void) const
+{
+    return m_channel;
+}
+
+void AbstractNetDevice::SetAddress (Address address)
+{
+    m_address = Mac48Address::ConvertFrom(address);
+}
+
+Address AbstractNetDevice::GetAddress (void) const
+{
+    return m_address;
+}
+
+bool AbstractNetDevice::SetMtu (const uint16_t mtu)
+{
+    m_mtu = mtu;
+    return true;
+}
+
+uint16_t AbstractNetDevice::GetMtu (void) const
+{
+    return m_mtu;
+}
+
+bool AbstractNetDevice::IsLinkUp (void) const
+{
+    return m_channel != 0 && m_link_up;
+}
+
+void AbstractNetDevice::AddLinkChangeCallback (Callback<void> callback)
+{
+
+}
+
+bool AbstractNetDevice::IsBroadcast (void) const
+{
+    return true;
+}
+
+Address AbstractNetDevice::GetBroadcast (void) const
+{
+    return Mac48Address::GetBroadcast();
+}
+
+bool AbstractNetDevice::IsMulticast (void) const
+{
+    return true;
+}
+
+Address AbstractNetDevice::GetMulticast (Ipv4Address multicastGroup) const
+{
+    return Mac48Address::GetMulticast(multicastGroup);
+}
+
+Address AbstractNetDevice::GetMulticast (Ipv6Address addr) const
+{
+    return Mac48Address::GetMulticast(addr);
+}
+
+bool AbstractNetDevice::IsBridge (void) const
+{
+    return false;
+}
+
+bool AbstractNetDevice::IsPointToPoint (void) const
+{
+    return false;
+}
+
+bool AbstractNetDevice::Send (Ptr<Packet> packet, const Address& dest, uint16_t protocolNumber)
+{
+    return SendFrom(packet, m_address, dest, protocolNumber);
+}
+
+bool AbstractNetDevice::SendFrom (Ptr<Packet> packet, const Address& source, const Address& dest, uint16_t protocolNumber)
+{
+    if (!m_channel || !m_link_up) {
+        return false;
+    }
+    uint8_t queue = GetQueueIndex(packet);
+    if (m_queues[queue].size() >= m_max_queue_size) {
+        m_queue_drop_count++;
+        return false;
+    }
+    PendingFrame frame;
+    frame.packet = packet;
+    frame.src = Mac48Address::ConvertFrom(source);
+    frame.dest = Mac48Address::ConvertFrom(dest);
+    frame.protocol = protocolNumber;
+    frame.enqueued = Now();
+    m_queues[queue].push_back(frame);
+
+    if (!m_transmitting && !m_tx_event.IsRunning()) {
+        TryTransmit();
+    }
+    return true;
+}
+
+Ptr<Node> AbstractNetDevice::GetNode (void) const
+{
+    return m_node;
+}
+
+void AbstractNetDevice::SetNode (Ptr<Node> node)
+{
+    m_node = node;
+}
+
+bool AbstractNetDevice::NeedsArp (void) const
+{
+    return false;
+}
+
+void AbstractNetDevice::SetReceiveCallback (NetDevice::ReceiveCallback cb)
+{
+    m_rxCallback = cb;
+}
+
+void AbstractNetDevice::SetPromiscReceiveCallback (PromiscReceiveCallback cb)
+{
+    m_promiscRxCallback = cb;
+}
+
+bool AbstractNetDevice::SupportsSendFrom (void) const
+{
+    return true;
+}
@@ -0,0 +1,162 @@
+#ifndef ABSTRACT_NET_DEVICE_H
+#define ABSTRACT_NET_DEVICE_H
+
+#include "ns3/net-device.h"
+#include "ns3/node.h"
+#include "ns3/packet.h"
+#include "ns3/header.h"
+#include "ns3/mac48-address.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/event-id.h"
+#include "MemoryAccounting.h"
+#include <deque>
+#include <vector>
+
+using namespace ns3;
+using namespace std;
+
+class AbstractChannel;
+
+//发送队列按802.11e的接入类别分开，下标越小优先级越高：AC_VO、AC_VI、AC_BE、AC_BK
+const uint8_t ABSTRACT_QUEUE_COUNT = 4;
+
+/*
+ * 分布式仿真时跨进程发送的帧前面加上这个头，接收进程据此恢复收发地址和协议号
+ */
+class AbstractFrameHeader : public Header
+{
+public:
+    static TypeId GetTypeId (void);
+    virtual TypeId GetInstanceTypeId (void) const;
+    virtual uint32_t GetSerializedSize (void) const;
+    virtual void Serialize (Buffer::Iterator start) const;
+    virtual uint32_t Deserialize (Buffer::Iterator start);
+    virtual void Print (std::ostream &os) const;
+
+    Mac48Address m_src;
+    Mac48Address m_dest;
+    uint16_t m_protocol;
+};
+
+/*
+ * 轻量的NetDevice，替代WifiNetDevice用于大规模仿真
+ * 发送队列按FrameAirtime逐帧发送，收发行为由AbstractChannel决定
+ * 启用Qos时按帧的SocketPriorityTag分到各接入类别的队列，近似EDCA：优先发送高优先级队列的帧，
+ * 退避窗口按802.11e的默认参数缩放（AC_VO为CwMin的1/4，AC_VI为1/2），AC_BK多等待4个时隙
+ */
+class AbstractNetDevice : public NetDevice
+{
+public:
+    static TypeId GetTypeId (void);
+    AbstractNetDevice();
+    virtual ~AbstractNetDevice();
+
+    //连接到信道
+    void SetChannel(Ptr<AbstractChannel> channel);
+
+    //断开链路（车辆离开或失联）：丢弃发送队列和正在接收的帧，之后的发送和接收都被丢弃
+    void SetLinkDown();
+
+    //信道调用：一帧开始到达本设备
+    void StartReceive(Ptr<const Packet> packet, Mac48Address src, Mac48Address dest, uint16_t protocol);
+
+    //分布式仿真时其它进程发来的帧，带有AbstractFrameHeader
+    void ReceiveRemote(Ptr<Packet> packet);
+
+    //统计信息
+    uint64_t GetCollisionCount();
+    uint64_t GetQueueDropCount();
+
+    //信道忙（发送或接收，重叠部分只算一次）的累计时间，用于计算信道忙比例
+    Time GetBusyTime();
+
+    //把发送队列中的帧和正在接收的帧占用的内存加到usage中
+    void GetMemoryUsage(MemoryUsage& usage);
+
+    // NetDevice的接口
+    virtual void SetIfIndex (const uint32_t index);
+    virtual uint32_t GetIfIndex (void) const;
+    virtual Ptr<Channel> GetChannel (void) const;
+    virtual void SetAddress (Address address);
+    virtual Address GetAddress (void) const;
+    virtual bool SetMtu (const uint16_t mtu);
+    virtual uint16_t GetMtu (void) const;
+    virtual bool IsLinkUp (void) const;
+    virtual void AddLinkChangeCallback (Callback<void> callback);
+    virtual bool IsBroadcast (void) const;
+    virtual Address GetBroadcast (void) const;
+    virtual bool IsMulticast (void) const;
+    virtual Address GetMulticast (Ipv4Address multicastGroup) const;
+    virtual Address GetMulticast (Ipv6Address addr) const;
+    virtual bool IsBridge (void) const;
+    virtual bool IsPointToPoint (void) const;
+    virtual bool Send (Ptr<Packet> packet, const Address& dest, uint16_t protocolNumber);
+    virtual bool SendFrom (Ptr<Packet> packet, const Address& source, const Address& dest, uint16_t protocolNumber);
+    virtual Ptr<Node> GetNode (void) const;
+    virtual void SetNode (Ptr<Node> node);
+    virtual bool NeedsArp (void) const;
+    virtual void SetReceiveCallback (NetDevice::ReceiveCallback cb);
+    virtual void SetPromiscReceiveCallback (PromiscReceiveCallback cb);
+    virtual bool SupportsSendFrom (void) const;
+
+private:
+    virtual void DoDispose (void);
+
+    //发送队列中的帧
+    typedef struct{
+        Ptr<Packet> packet;
+        Mac48Address src;
+        Mac48Address dest;
+        uint16_t protocol;
+        Time enqueued;//进入队列的时间，用于统计排队时延
+    } PendingFrame;
+
+    //正在接收的帧，重叠的帧都会被标记为冲突
+    typedef struct{
+        uint64_t id;
+        bool collided;
+    } Reception;
+
+    //尝试发送队首的帧，信道忙时退避
+    void TryTransmit();
+    void EndTransmit();
+    void EndReceive(uint64_t id, Ptr<const Packet> packet, Mac48Address src, Mac48Address dest, uint16_t protocol);
+    //按队列的接入类别退避
+    Time GetBackoff(uint8_t queue);
+
+    //帧应该进入的队列，没有启用Qos或者没有优先级tag时为AC_BE
+    uint8_t GetQueueIndex(Ptr<const Packet> packet);
+
+    //有帧的优先级最高的队列，都为空时返回ABSTRACT_QUEUE_COUNT
+    uint8_t GetHeadQueue();
+
+    //信道忙到end，累计到m_busy_time
+    void MarkBusy(Time end);
+
+    Ptr<Node> m_node;
+    Ptr<AbstractChannel> m_channel;
+    Mac48Address m_address;
+    uint32_t m_ifIndex;
+    uint16_t m_mtu;
+    NetDevice::ReceiveCallback m_rxCallback;
+    NetDevice::PromiscReceiveCallback m_promiscRxCallback;
+
+    deque<PendingFrame> m_queues[ABSTRACT_QUEUE_COUNT];
+    uint32_t m_max_queue_size;//每个队列的最大长度
+    bool m_qos;
+    bool m_link_up;
+    bool m_transmitting;
+    EventId m_tx_event;
+    Time m_busy_until;//收到的帧占用信道到这个时间
+    vector<Reception> m_receptions;
+    uint64_t m_next_rx_id;
+    Ptr<UniformRandomVariable> m_backoff;
+
+    Time m_busy_time;//信道忙的累计时间，包括还没有过去的部分
+    Time m_busy_mark;//已经累计到这个时间
+
+    uint64_t m_collision_count;
+    uint64_t m_queue_drop_count;
+};
+
+#endif
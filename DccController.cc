@@ -0,0 +1,103 @@
+#include "DccController.h"
+
+DccController::DccController()
+{
+    m_state = 0;
+    m_cbr = 0;
+    m_below_samples = 0;
+    m_samples = 0;
+    m_raw_cbr_sum = 0;
+    m_raw_cbr_max = 0;
+    m_state_changes = 0;
+}
+
+bool DccController::Sample(Time busy, Time elapsed)
+{
+    if(!elapsed.IsStrictlyPositive()){
+        return false;
+    }
+    double raw = busy.GetSeconds() / elapsed.GetSeconds();
+    if(raw > 1){
+        raw = 1;
+    }
+    //第一次采样没有上一次的值可以平均
+    m_cbr = m_samples == 0 ? raw : (m_cbr + raw) / 2;
+    m_samples++;
+    m_raw_cbr_sum += raw;
+    if(raw > m_raw_cbr_max){
+        m_raw_cbr_max = raw;
+    }
+
+    uint8_t target = 0;
+    for(uint8_t s = DCC_STATE_COUNT - 1; s > 0; s--){
+        if(m_cbr >= DCC_STATE_TABLE[s].cbr_threshold){
+            target = s;
+            break;
+        }
+    }
+    uint8_t next = m_state;
+    if(target > m_state){
+        next = target;
+        m_below_samples = 0;
+    }
+    else if(target < m_state){
+        m_below_samples++;
+        if(m_below_samples >= DCC_DOWN_SAMPLES){
+            next = m_state - 1;
+            m_below_samples = 0;
+        }
+    }
+    else{
+        m_below_samples = 0;
+    }
+    if(next == m_state){
+        return false;
+    }
+    m_state = next;
+    m_state_changes++;
+    return true;
+}
+
+uint8_t DccController::GetState()
+{
+    return m_state;
+}
+
+double DccController::GetChannelBusyRatio()
+{
+    return m_cbr;
+}
+
+double DccController::GetIntervalScale()
+{
+    return DCC_STATE_TABLE[m_state].interval_scale;
+}
+
+uint64_t DccController::GetSampleCount()
+{
+    return m_samples;
+}
+
+double DccController::GetRawCbrSum()
+{
+    return m_raw_cbr_sum;
+}
+
+double DccController::GetRawCbrMax()
+{
+    return m_raw_cbr_max;
+}
+
+uint64_t DccController::GetStateChangeCount()
+{
+    return m_state_changes;
+}
+
+const char* DccController::StateName(uint8_t state)
+{
+    static const char* names[DCC_STATE_COUNT] = {"relaxed", "active1", "active2", "active3", "restrictive"};
+    if(state < DCC_STATE_COUNT){
+        return names[state];
+    }
+    return "unknown";
+}
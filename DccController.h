@@ -0,0 +1,74 @@
+#ifndef DCC_CONTROLLER_H
+#define DCC_CONTROLLER_H
+
+#include "ns3/nstime.h"
+#include <stdint.h>
+
+using namespace ns3;
+
+//DCC的状态数，0为宽松，最后一个为限制，中间为活跃
+const uint8_t DCC_STATE_COUNT = 5;
+
+//采样信道忙比例的周期 单位s
+const double DCC_SAMPLE_INTERVAL = 0.1;
+
+//平滑后的CBR连续低于当前状态门限这么多次采样后才降低一级，避免在门限附近来回切换
+const uint32_t DCC_DOWN_SAMPLES = 10;
+
+//一个DCC状态：平滑后的CBR达到门限时进入，心跳和建立广播的间隔乘以倍数
+typedef struct{
+    double cbr_threshold;
+    double interval_scale;
+} DccStateConfig;
+
+//门限和间隔按ETSI TS 102 687的反应式DCC（间隔从100ms到1s）换算为相对于配置间隔的倍数
+const DccStateConfig DCC_STATE_TABLE[DCC_STATE_COUNT] = {
+    {0.0, 1},//relaxed
+    {0.3, 2},//active1
+    {0.4, 4},//active2
+    {0.5, 6},//active3
+    {0.6, 10},//restrictive
+};
+
+/*
+ * 反应式的分布式拥塞控制（DCC），每个EvolutionApplication一个
+ * 每DCC_SAMPLE_INTERVAL由应用传入这段时间内信道忙（接收、发送或CCA忙）的时间，
+ * CBR按ETSI的方式与上一次的值取平均后选择状态：升高时直接进入对应状态，降低时每次只降一级
+ * 信标（心跳、建立广播）的间隔乘以GetIntervalScale()，最大为配置值的10倍
+ */
+class DccController
+{
+public:
+    DccController();
+
+    //加入一次采样，elapsed内信道忙busy，返回状态是否改变
+    bool Sample(Time busy, Time elapsed);
+
+    uint8_t GetState();
+
+    //平滑后的CBR
+    double GetChannelBusyRatio();
+
+    //当前状态下信标间隔相对于配置值的倍数
+    double GetIntervalScale();
+
+    //统计信息：采样次数、未平滑CBR的和与最大值、状态改变次数
+    uint64_t GetSampleCount();
+    double GetRawCbrSum();
+    double GetRawCbrMax();
+    uint64_t GetStateChangeCount();
+
+    //状态的名字，用于统计输出
+    static const char* StateName(uint8_t state);
+
+private:
+    uint8_t m_state;
+    double m_cbr;
+    uint32_t m_below_samples;//连续低于当前状态门限的采样次数
+    uint64_t m_samples;
+    double m_raw_cbr_sum;
+    double m_raw_cbr_max;
+    uint64_t m_state_changes;
+};
+
+#endif
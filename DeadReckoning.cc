@@ -0,0 +1,112 @@
+#include "DeadReckoning.h"
+
+Vector ExtrapolatePosition(const Vector& pos, const Vector& velocity, const Vector& acceleration, double dt)
+{
+    if(dt <= 0){
+        return pos;
+    }
+    //加速度与速度反向时，速度在t_stop后降为0，之后停在原地
+    double along = velocity.x * acceleration.x + velocity.y * acceleration.y + velocity.z * acceleration.z;
+    double speed2 = velocity.x * velocity.x + velocity.y * velocity.y + velocity.z * velocity.z;
+    if(along < 0){
+        double t_stop = -speed2 / along;
+        if(dt > t_stop){
+            dt = t_stop;
+        }
+    }
+    return Vector(pos.x + velocity.x * dt + 0.5 * acceleration.x * dt * dt,
+                  pos.y + velocity.y * dt + 0.5 * acceleration.y * dt * dt,
+                  pos.z + velocity.z * dt + 0.5 * acceleration.z * dt * dt);
+}
+
+DeadReckoning::DeadReckoning()
+{
+    m_sampled = false;
+    m_sent = false;
+    m_error_sum = 0;
+    m_error_max = 0;
+    m_error_count = 0;
+}
+
+void DeadReckoning::Sample(const Vector& pos, const Vector& velocity, Time now)
+{
+    if(m_sampled && now > m_sample_time){
+        double dt = (now - m_sample_time).GetSeconds();
+        m_acceleration = Vector((velocity.x - m_velocity.x) / dt,
+                                (velocity.y - m_velocity.y) / dt,
+                                (velocity.z - m_velocity.z) / dt);
+    }
+    m_sampled = true;
+    m_sample_time = now;
+    m_pos = pos;
+    m_velocity = velocity;
+}
+
+double DeadReckoning::GetError(Time now)
+{
+    if(!m_sent || !m_sampled){
+        return 0;
+    }
+    Vector predicted = ExtrapolatePosition(m_sent_pos, m_sent_velocity, m_sent_acceleration, (now - m_sent_time).GetSeconds());
+    return CalculateDistance(predicted, m_pos);
+}
+
+bool DeadReckoning::NeedsBeacon(double threshold, Time max_interval, Time now)
+{
+    if(!m_sent){
+        return true;
+    }
+    return now - m_sent_time >= max_interval || GetError(now) > threshold;
+}
+
+void DeadReckoning::MarkSent(Time now)
+{
+    if(m_sent){
+        double error = GetError(now);
+        m_error_sum += error;
+        m_error_count++;
+        if(error > m_error_max){
+            m_error_max = error;
+        }
+    }
+    m_sent = true;
+    m_sent_time = now;
+    m_sent_pos = m_pos;
+    m_sent_velocity = m_velocity;
+    m_sent_acceleration = m_acceleration;
+}
+
+void DeadReckoning::Reset()
+{
+    m_sent = false;
+}
+
+Vector DeadReckoning::GetPosition()
+{
+    return m_pos;
+}
+
+Vector DeadReckoning::GetVelocity()
+{
+    return m_velocity;
+}
+
+Vector DeadReckoning::GetAcceleration()
+{
+    return m_acceleration;
+}
+
+double DeadReckoning::GetErrorSum()
+{
+    return m_error_sum;
+}
+
+double DeadReckoning::GetErrorMax()
+{
+    return m_error_max;
+}
+
+uint64_t DeadReckoning::GetErrorCount()
+{
+    return m_error_count;
+}
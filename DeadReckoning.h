@@ -0,0 +1,77 @@
+#ifndef DEAD_RECKONING_H
+#define DEAD_RECKONING_H
+
+#include "ns3/nstime.h"
+#include "ns3/vector.h"
+#include <stdint.h>
+
+using namespace ns3;
+
+//航位推算模式下采样本车运动状态、判断是否需要发送心跳包的周期 单位s
+const double DR_CHECK_INTERVAL = 0.1;
+
+//真实位置偏离共享预测超过这个距离时发送心跳包 单位m，与ETSI CAM的位置触发条件相同
+const double DR_POSITION_THRESHOLD = 4;
+
+//航位推算模式下两次心跳包的最大间隔，父节点据此判断子节点仍然在线 单位s
+const double DR_MAX_INTERVAL = 5;
+
+//按匀加速外推dt秒后的位置；减速时只推算到速度降为0，不会倒退
+Vector ExtrapolatePosition(const Vector& pos, const Vector& velocity, const Vector& acceleration, double dt);
+
+/*
+ * 发送方的航位推算，每个EvolutionApplication一个
+ * 心跳包携带位置、速度和加速度，父节点用ExtrapolatePosition在两次心跳之间外推子节点的位置；
+ * 子节点用同样的方法从上一次发送的状态外推，得到与父节点相同的预测，
+ * 真实位置偏离预测超过门限或距上次发送过久时才发送，匀速行驶时心跳包大大减少而位置误差有上限
+ * 加速度由相邻两次采样的速度差估计，移动模型一般不提供加速度
+ */
+class DeadReckoning
+{
+public:
+    DeadReckoning();
+
+    //采样本车当前的真实位置和速度
+    void Sample(const Vector& pos, const Vector& velocity, Time now);
+
+    //当前真实位置与共享预测的距离 单位m，还没有发送过时为0
+    double GetError(Time now);
+
+    //是否需要发送心跳包：还没有发送过、误差超过threshold，或距上次发送已有max_interval
+    bool NeedsBeacon(double threshold, Time max_interval, Time now);
+
+    //按最近一次采样的状态发送了心跳包，它成为新的共享预测
+    void MarkSent(Time now);
+
+    //接收方不再有本车的预测（例如父节点改变），下一次检查时一定发送
+    void Reset();
+
+    //最近一次采样的状态，用于填写心跳包
+    Vector GetPosition();
+    Vector GetVelocity();
+    Vector GetAcceleration();
+
+    //统计信息：每次发送前共享预测的误差之和、最大值和次数，即接收方在刷新前的位置误差
+    double GetErrorSum();
+    double GetErrorMax();
+    uint64_t GetErrorCount();
+
+private:
+    bool m_sampled;
+    Time m_sample_time;
+    Vector m_pos;
+    Vector m_velocity;
+    Vector m_acceleration;
+
+    bool m_sent;
+    Time m_sent_time;
+    Vector m_sent_pos;
+    Vector m_sent_velocity;
+    Vector m_sent_acceleration;
+
+    double m_error_sum;
+    double m_error_max;
+    uint64_t m_error_count;
+};
+
+#endif
@@ -0,0 +1,91 @@
+#include "ns3/log.h"
+#include "EventLog.h"
+#include <cstring>
+
+NS_LOG_COMPONENT_DEFINE("EventLog");
+
+EventLog* EventLog::Get(){
+    static EventLog log;
+    return &log;
+}
+
+EventLog::EventLog(){
+    m_enabled = false;
+    m_file = NULL;
+}
+
+EventLog::~EventLog(){
+    Close();
+    for(vector<Buffer*>::iterator iter = m_buffers.begin(); iter != m_buffers.end(); iter++){
+        delete *iter;
+    }
+}
+
+bool EventLog::Open(string path){
+    if(m_enabled){
+        NS_LOG_ERROR("事件日志文件已经打开");
+        return false;
+    }
+    m_file = fopen(path.c_str(), "wb");
+    if(!m_file){
+        NS_LOG_ERROR("无法打开事件日志文件 " << path);
+        return false;
+    }
+    m_path = path;
+    EventLogFileHeader header;
+    header.magic = EVENT_LOG_MAGIC;
+    header.version = EVENT_LOG_VERSION;
+    header.record_size = sizeof(EventLogRecord);
+    fwrite(&header, sizeof(header), 1, m_file);
+    m_enabled = true;
+    return true;
+}
+
+void EventLog::Close(){
+    if(!m_enabled){
+        return;
+    }
+    m_enabled = false;
+    //此时仿真已经结束，其它线程不会再写缓冲区
+    vector<Buffer*> buffers;
+    {
+        unique_lock<mutex> lock(m_mutex);
+        buffers = m_buffers;
+    }
+    for(vector<Buffer*>::iterator iter = buffers.begin(); iter != buffers.end(); iter++){
+        Flush(*iter);
+    }
+    fclose(m_file);
+    m_file = NULL;
+}
+
+uint64_t EventLog::AddressToArg(const Address& addr){
+    uint8_t mac[Address::MAX_SIZE];
+    uint32_t len = addr.CopyTo(mac);
+    uint64_t arg = 0;
+    for(uint32_t i = 0; i < len && i < 6; i++){
+        arg = (arg << 8) | mac[i];
+    }
+    return arg;
+}
+
+EventLog::Buffer* EventLog::AllocateBuffer(){
+    Buffer* buffer = new Buffer;
+    buffer->count = 0;
+    unique_lock<mutex> lock(m_mutex);
+    m_buffers.push_back(buffer);
+    return buffer;
+}
+
+void EventLog::Flush(Buffer* buffer){
+    if(buffer->count == 0){
+        return;
+    }
+    {
+        unique_lock<mutex> lock(m_mutex);
+        if(m_file){
+            fwrite(buffer->records, sizeof(EventLogRecord), buffer->count, m_file);
+        }
+    }
+    buffer->count = 0;
+}
@@ -0,0 +1,131 @@
+#ifndef EVENT_LOG_H
+#define EVENT_LOG_H
+
+#include "ns3/address.h"
+#include "ns3/simulator.h"
+#include "EventLogRecord.h"
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <mutex>
+
+using namespace ns3;
+using namespace std;
+
+/*
+ * 结构化事件日志，替代协议代码中的cout
+ * 编译时级别：低于EVENT_LOG_LEVEL的日志宏展开为空，参数也不会求值，例如
+ *     CXXFLAGS="-DEVENT_LOG_LEVEL=EVENT_LEVEL_DEBUG" ./waf configure
+ * 运行时：没有打开日志文件时，保留的日志点只有一次分支判断
+ * 记录写入线程自己的定长缓冲区，只保存事件编号和参数，不加锁、不格式化，
+ * 缓冲区写满时才写文件，用tools/event-log-reader.cc离线格式化
+ */
+#ifndef EVENT_LOG_LEVEL
+#define EVENT_LOG_LEVEL EVENT_LEVEL_INFO
+#endif
+
+//用法：EVENT_LOG_INFO(EVENT_CONSTRUCTED, node_id, level, parent_mac, leader_mac)，最多4个参数
+#define EVENT_LOG_AT(level, ...) EventLog::Get()->Log(level, __VA_ARGS__)
+
+#if EVENT_LOG_LEVEL >= EVENT_LEVEL_ERROR
+#define EVENT_LOG_ERROR(...) EVENT_LOG_AT(EVENT_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define EVENT_LOG_ERROR(...) ((void)0)
+#endif
+
+#if EVENT_LOG_LEVEL >= EVENT_LEVEL_WARN
+#define EVENT_LOG_WARN(...) EVENT_LOG_AT(EVENT_LEVEL_WARN, __VA_ARGS__)
+#else
+#define EVENT_LOG_WARN(...) ((void)0)
+#endif
+
+#if EVENT_LOG_LEVEL >= EVENT_LEVEL_INFO
+#define EVENT_LOG_INFO(...) EVENT_LOG_AT(EVENT_LEVEL_INFO, __VA_ARGS__)
+#else
+#define EVENT_LOG_INFO(...) ((void)0)
+#endif
+
+#if EVENT_LOG_LEVEL >= EVENT_LEVEL_DEBUG
+#define EVENT_LOG_DEBUG(...) EVENT_LOG_AT(EVENT_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define EVENT_LOG_DEBUG(...) ((void)0)
+#endif
+
+class EventLog{
+public:
+    //全局唯一的实例
+    static EventLog* Get();
+
+    //打开日志文件，打开后开始记录
+    bool Open(string path);
+
+    //写出所有缓冲区并关闭文件，仿真结束后调用
+    void Close();
+
+    bool IsEnabled(){
+        return m_enabled;
+    }
+
+    //当前日志文件的路径，没有打开时为空
+    string GetPath(){
+        return m_enabled ? m_path : "";
+    }
+
+    //记录一个事件，未打开日志文件时直接返回
+    void Log(uint8_t level, uint16_t event, uint32_t node, uint64_t a0 = 0, uint64_t a1 = 0, uint64_t a2 = 0, uint64_t a3 = 0){
+        if(!m_enabled){
+            return;
+        }
+        Buffer* buffer = GetThreadBuffer();
+        EventLogRecord& r = buffer->records[buffer->count];
+        r.time_ns = Simulator::Now().GetNanoSeconds();
+        r.node = node;
+        r.event = event;
+        r.level = level;
+        r.reserved = 0;
+        r.args[0] = a0;
+        r.args[1] = a1;
+        r.args[2] = a2;
+        r.args[3] = a3;
+        if(++buffer->count == EVENT_LOG_BUFFER_RECORDS){
+            Flush(buffer);
+        }
+    }
+
+    //把mac地址转成日志参数
+    static uint64_t AddressToArg(const Address& addr);
+
+private:
+    static const size_t EVENT_LOG_BUFFER_RECORDS = 4096;//每个缓冲区的记录数，4096条为192KB
+
+    //每个线程的缓冲区
+    typedef struct{
+        EventLogRecord records[EVENT_LOG_BUFFER_RECORDS];
+        size_t count;
+    } Buffer;
+
+    EventLog();
+    ~EventLog();
+
+    //取得当前线程的缓冲区，第一次调用时分配
+    Buffer* GetThreadBuffer(){
+        static thread_local Buffer* buffer = NULL;
+        if(!buffer){
+            buffer = AllocateBuffer();
+        }
+        return buffer;
+    }
+
+    Buffer* AllocateBuffer();
+
+    //把缓冲区写入文件并清空
+    void Flush(Buffer* buffer);
+
+    bool m_enabled;
+    string m_path;
+    FILE* m_file;
+    mutex m_mutex;//只在分配缓冲区和写文件时使用
+    vector<Buffer*> m_buffers;//所有线程的缓冲区，关闭时写出
+};
+
+#endif
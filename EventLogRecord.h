@@ -0,0 +1,102 @@
+#ifndef EVENT_LOG_RECORD_H
+#define EVENT_LOG_RECORD_H
+
+// 结构化事件日志的二进制格式和事件表，不依赖ns-3，离线读取工具tools/event-log-reader.cc也使用这个头文件
+// 文件由一个EventLogFileHeader和若干个定长的EventLogRecord组成，字节序为本机字节序
+// 记录中只保存事件编号和参数，格式化在离线读取时按EVENT_LOG_TABLE完成
+
+#include <stdint.h>
+
+const uint32_t EVENT_LOG_MAGIC = 0x4c455456;//"VTEL"
+const uint16_t EVENT_LOG_VERSION = 1;
+
+//日志级别，数值越小越重要
+#define EVENT_LEVEL_ERROR 0
+#define EVENT_LEVEL_WARN 1
+#define EVENT_LEVEL_INFO 2
+#define EVENT_LEVEL_DEBUG 3
+
+const uint32_t EVENT_LOG_MAX_ARGS = 4;
+
+typedef struct{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t record_size;//sizeof(EventLogRecord)，读取时用于校验
+} EventLogFileHeader;
+
+typedef struct{
+    int64_t time_ns;//仿真时间 单位ns
+    uint32_t node;//记录的节点编号
+    uint16_t event;//EVENT_CONSTRUCT_BROADCAST等
+    uint8_t level;//EVENT_LEVEL_INFO等
+    uint8_t reserved;
+    uint64_t args[EVENT_LOG_MAX_ARGS];//参数，含义见EVENT_LOG_TABLE
+} EventLogRecord;
+
+static_assert(sizeof(EventLogFileHeader) == 8, "EventLogFileHeader的大小必须固定");
+static_assert(sizeof(EventLogRecord) == 48, "EventLogRecord的大小必须固定");
+
+//事件编号，新的事件只能加在最后，否则旧的日志文件无法读取
+enum EventId{
+    EVENT_CONSTRUCT_BROADCAST = 0,
+    EVENT_CONSTRUCT_STOP,
+    EVENT_CONSTRUCT_REPLY_SENT,
+    EVENT_CONSTRUCT_REPLY_RECEIVED,
+    EVENT_CONSTRUCT_CONFIRM_SENT,
+    EVENT_CONSTRUCT_CONFIRM_RECEIVED,
+    EVENT_CONSTRUCTED,
+    EVENT_CONSTRUCT_REJECTED,
+    EVENT_OBSTACLE_DETECTED,
+    EVENT_OBSTACLE_RELAY,
+    EVENT_OBSTACLE_AVOID,
+    EVENT_SEARCH_RECEIVED,
+    EVENT_GROUP_FORWARD,
+    EVENT_ROUTE_ENTRY,
+    EVENT_ROUTE_UPDATE_SENT,
+    EVENT_ROUTE_UPDATE_APPLIED,
+    EVENT_MERGED,
+    EVENT_SPLIT,
+    EVENT_DETACHED,
+    EVENT_FAILOVER,
+    EVENT_GROUP_COMMAND_SENT,
+    EVENT_GROUP_COMMAND_DONE,
+    EVENT_GROUP_ACK_SENT,
+    EVENT_DCC_STATE,
+    EVENT_COUNT
+};
+
+//参数的类型：'u'无符号整数，'m'为mac地址（低6字节），'-'表示不使用
+typedef struct{
+    const char* name;
+    const char* arg_names[EVENT_LOG_MAX_ARGS];
+    char arg_kinds[EVENT_LOG_MAX_ARGS];
+} EventDescription;
+
+static const EventDescription EVENT_LOG_TABLE[EVENT_COUNT] = {
+    {"construct_broadcast", {"task", "", "", ""}, {'u', '-', '-', '-'}},
+    {"construct_stop", {"reason", "subnodes", "", ""}, {'u', 'u', '-', '-'}},//reason: 0不在车群中 1子节点过多
+    {"construct_reply_sent", {"to", "", "", ""}, {'m', '-', '-', '-'}},
+    {"construct_reply_received", {"from", "", "", ""}, {'m', '-', '-', '-'}},
+    {"construct_confirm_sent", {"to", "accept", "", ""}, {'m', 'u', '-', '-'}},
+    {"construct_confirm_received", {"from", "", "", ""}, {'m', '-', '-', '-'}},
+    {"constructed", {"level", "parent", "leader", ""}, {'u', 'm', 'm', '-'}},
+    {"construct_rejected", {"", "", "", ""}, {'-', '-', '-', '-'}},
+    {"obstacle_detected", {"leader", "neighbor_leaders", "", ""}, {'u', 'u', '-', '-'}},
+    {"obstacle_relay", {"children", "", "", ""}, {'u', '-', '-', '-'}},
+    {"obstacle_avoid", {"from", "", "", ""}, {'m', '-', '-', '-'}},
+    {"search_received", {"leader", "", "", ""}, {'u', '-', '-', '-'}},
+    {"group_forward", {"next_hop", "type", "", ""}, {'m', 'u', '-', '-'}},//车群命令沿树转发给子节点，没有单独的目的节点
+    {"route_entry", {"dest", "next_hop", "", ""}, {'m', 'm', '-', '-'}},
+    {"route_update_sent", {"to", "deltas", "", ""}, {'m', 'u', '-', '-'}},
+    {"route_update_applied", {"from", "dest", "add", ""}, {'m', 'm', 'u', '-'}},
+    {"merged", {"level", "parent", "leader", ""}, {'u', 'm', 'm', '-'}},
+    {"split", {"peer", "initiator", "", ""}, {'m', 'u', '-', '-'}},//initiator: 1为原车群的leader 0为新车群的leader
+    {"detached", {"level", "", "", ""}, {'u', '-', '-', '-'}},
+    {"failover", {"old_leader", "children", "neighbor_leaders", ""}, {'m', 'u', 'u', '-'}},
+    {"group_command_sent", {"seq", "type", "children", ""}, {'u', 'u', 'u', '-'}},
+    {"group_command_done", {"seq", "confirmed", "missing", ""}, {'u', 'u', 'u', '-'}},
+    {"group_ack_sent", {"to", "seq", "confirmed", "missing"}, {'m', 'u', 'u', 'u'}},
+    {"dcc_state", {"state", "cbr_permille", "hello_ms", "construct_ms"}, {'u', 'u', 'u', 'u'}},//state见DccController::StateName
+};
+
+#endif
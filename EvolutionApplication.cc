@@ -1,8 +1,23 @@
 #include "ns3/mobility-model.h"
 #include "ns3/log.h"
 #include "ns3/simulator.h"
+#include "ns3/uinteger.h"
+#include "ns3/socket.h"
+#include "ns3/boolean.h"
+#include "ns3/double.h"
+#include "ns3/pointer.h"
+#include "ns3/wifi-phy-state-helper.h"
 #include "EvolutionApplication.h"
 #include "MessageHeader.h"
+#include "AbstractNetDevice.h"
+#include "TraceRecorder.h"
+#include "LatencyStats.h"
+#include "EventLog.h"
+#include "HandlerProfiler.h"
+#include "HazardStats.h"
+#include <algorithm>
+#include <cstring>
+#include <utility>
 
 NS_LOG_COMPONENT_DEFINE("EvolutionApplication");
 NS_OBJECT_ENSURE_REGISTERED(EvolutionApplication);
@@ -17,6 +32,31 @@ TypeId EvolutionApplication::GetTypeId()
                       MakeTimeAccessor (&EvolutionApplication::m_hello_interval),
                       MakeTimeChecker()
                       )
+                .AddAttribute ("MaxSubnodes", "每个节点最多的子结点数",
+                      UintegerValue (MAX_SUBNODES),
+                      MakeUintegerAccessor (&EvolutionApplication::m_max_subnodes),
+                      MakeUintegerChecker<uint8_t> (1)
+                      )
+                .AddAttribute ("Dcc", "按信道忙比例调整心跳和建立广播的间隔",
+                      BooleanValue (false),
+                      MakeBooleanAccessor (&EvolutionApplication::m_dcc_enabled),
+                      MakeBooleanChecker ()
+                      )
+                .AddAttribute ("DeadReckoning", "只在真实位置偏离心跳包共享的预测时发送心跳包",
+                      BooleanValue (false),
+                      MakeBooleanAccessor (&EvolutionApplication::m_dead_reckoning),
+                      MakeBooleanChecker ()
+                      )
+                .AddAttribute ("PositionThreshold", "航位推算触发心跳包的位置误差 单位m",
+                      DoubleValue (DR_POSITION_THRESHOLD),
+                      MakeDoubleAccessor (&EvolutionApplication::m_position_threshold),
+                      MakeDoubleChecker<double> (0)
+                      )
+                .AddAttribute ("MaxBeaconInterval", "航位推算时两次心跳包的最大间隔",
+                      TimeValue (Seconds(DR_MAX_INTERVAL)),
+                      MakeTimeAccessor (&EvolutionApplication::m_dr_max_interval),
+                      MakeTimeChecker()
+                      )
                       ;
     return tid;
 }
@@ -31,12 +71,32 @@ EvolutionApplication::EvolutionApplication()
     m_max_level = MAX_LEVEL;
     m_max_subnodes = MAX_SUBNODES;
     m_hello_interval = Seconds(HELLO_INTERVAL);
+    m_dead_reckoning = false;
+    m_position_threshold = DR_POSITION_THRESHOLD;
+    m_dr_max_interval = Seconds(DR_MAX_INTERVAL);
+    m_dcc_enabled = false;
+    m_phy_busy_time = Seconds(0);
+    m_dcc_last_busy = Seconds(0);
+    m_dcc_last_sample = Seconds(0);
+    m_hello_sent = 0;
+    m_hello_replies = 0;
     m_check_missing_interval = Seconds(CHECK_MISSING_INTERVAL);
     m_time_limit = Seconds (TIME_LIMIT);
     m_mode = WifiMode(WIFI_MODE);
     m_state = INITIAL_STATE;
     m_wait_construct_time = Seconds(WAIT_CONSTRUCT_TIME);
     m_construct_interval = Seconds(CONSTRUCT_INTERVAL);
+    m_route_update_interval = Seconds(ROUTE_UPDATE_INTERVAL);
+    m_sent_count = 0;
+    m_received_count = 0;
+    memset(m_channel_sent, 0, sizeof(m_channel_sent));
+    memset(m_channel_received_bytes, 0, sizeof(m_channel_received_bytes));
+    m_merge_messages = 0;
+    m_split_messages = 0;
+    m_failover_messages = 0;
+    m_standby_sync_time = Seconds(-1);
+    m_restore_time = Seconds(-1);
+    m_pending_task = -1;
 
     // 各个参数的默认值，默认关闭，具体设置在Test.cc每一个testCase的函数里
     
@@ -49,9 +109,31 @@ EvolutionApplication::EvolutionApplication()
     m_check_obstacle_interval = Seconds(1);
     m_obstacle = Vector(60, -4.8, 0);
     m_safe_avoid_obstacle_distance = 21;
+    m_geocast_obstacle = false;
+    m_geocast_radius = GEOCAST_RADIUS;
+    m_geocast_sent = 0;
+    m_geocast_suppressed = 0;
+
+    // ---------- 可靠的车群命令 ----------
+    m_group_command_deadline = Seconds(GROUP_COMMAND_DEADLINE);
+    m_group_ack_slack = Seconds(GROUP_ACK_SLACK);
+    m_group_retransmit_interval = Seconds(GROUP_RETRANSMIT_INTERVAL);
+    m_group_max_retries = GROUP_MAX_RETRIES;
+    m_next_group_seq = 0;
+    m_group_commands_sent = 0;
+    m_group_commands_incomplete = 0;
+    m_group_retransmissions = 0;
+    m_group_acks = 0;
 
     // ---------- 节点失联相关 ----------
     m_is_simulate_node_missing = false;
+    m_is_simulate_beacon = false;
+
+    // ---------- 合并与分裂相关 ----------
+    m_is_simulate_adjust = false;
+    m_adjust_interval = Seconds(ADJUST_INTERVAL);
+    m_merge_distance = MERGE_DISTANCE;
+    m_split_distance = SPLIT_DISTANCE;
 }
 
 EvolutionApplication::~EvolutionApplication()
@@ -67,9 +149,111 @@ bool EvolutionApplication::isMember(){
     return m_state & MEMBER_STATE;
 }
 
+uint64_t EvolutionApplication::GetSentCount(){
+    return m_sent_count;
+}
+
+void EvolutionApplication::GetMemoryUsage(MemoryUsage& usage){
+    usage["app"] += sizeof(*this);
+    usage["router"] += MapBytes(m_router);
+    usage["next"] += VectorBytes(m_next);
+    usage["neighbor_leaders"] += VectorBytes(m_neighbor_leaders);
+    usage["neighbors"] += MapBytes(m_neighbors);
+    usage["pending_routes"] += MapBytes(m_pending_routes);
+    usage["standby"] += VectorBytes(m_standby_children) + VectorBytes(m_standby_neighbor_leaders);
+    usage["packet_pool"] += m_hello_pool.GetMemoryBytes() + m_hello_r_pool.GetMemoryBytes()
+                            + m_obstacle_pool.GetMemoryBytes() + m_group_pool.GetMemoryBytes();
+    usage["io_buffer"] += VectorBytes(m_rx_buffer) + VectorBytes(m_tx_buffer) + VectorBytes(m_tx_macs);
+    usage["geocast"] += MapBytes(m_geocasts);
+    for(std::map<HazardKey, GeocastState>::iterator iter = m_geocasts.begin(); iter != m_geocasts.end(); iter++){
+        usage["geocast"] += VectorBytes(iter->second.forwarders);
+    }
+    usage["group_commands"] += MapBytes(m_group_commands);
+    for(std::map<GroupCommandKey, GroupCommandState>::iterator iter = m_group_commands.begin(); iter != m_group_commands.end(); iter++){
+        usage["group_commands"] += VectorBytes(iter->second.payload) + VectorBytes(iter->second.waiting)
+                                   + VectorBytes(iter->second.missing);
+    }
+}
+
+uint64_t EvolutionApplication::GetPacketPoolReusedCount(){
+    return m_hello_pool.GetReusedCount() + m_hello_r_pool.GetReusedCount()
+           + m_obstacle_pool.GetReusedCount() + m_group_pool.GetReusedCount();
+}
+
+uint64_t EvolutionApplication::GetPacketPoolAllocatedCount(){
+    return m_hello_pool.GetAllocatedCount() + m_hello_r_pool.GetAllocatedCount()
+           + m_obstacle_pool.GetAllocatedCount() + m_group_pool.GetAllocatedCount();
+}
+
+uint64_t EvolutionApplication::GetReceivedCount(){
+    return m_received_count;
+}
+
+uint64_t EvolutionApplication::GetChannelSentCount(uint8_t channel){
+    return channel < MESSAGE_CHANNEL_COUNT ? m_channel_sent[channel] : 0;
+}
+
+uint64_t EvolutionApplication::GetChannelReceivedBytes(uint8_t channel){
+    return channel < MESSAGE_CHANNEL_COUNT ? m_channel_received_bytes[channel] : 0;
+}
+
+MessageHeader EvolutionApplication::MakeTag(const Address &dest)
+{
+    MessageHeader tag;
+    tag.SetTimestamp(Now());
+    tag.SetDesAddr(dest);
+    tag.SetSrcAddr(m_device->GetAddress());
+    return tag;
+}
+
+template <class Msg>
+bool EvolutionApplication::Decode(const uint8_t* buffer, uint32_t size, Msg& msg)
+{
+    if(!ReadMessage(buffer, size, msg)){
+        NS_LOG_ERROR(MessageTypeName(MessageSchema<Msg>::Type()) << "长度错误：" << size);
+        return false;
+    }
+    return true;
+}
+
+template <uint8_t TYPE, class... Params, class... Args>
+bool EvolutionApplication::Dispatch(const uint8_t* buffer, uint32_t size,
+                                    void (EvolutionApplication::*handler)(const typename MessageOfType<TYPE>::type&, Params...),
+                                    Args&&... args)
+{
+    typename MessageOfType<TYPE>::type msg = typename MessageOfType<TYPE>::type();
+    if(!Decode(buffer, size, msg)){
+        return false;
+    }
+    (this->*handler)(msg, std::forward<Args>(args)...);
+    return true;
+}
+
+NeighborRecord ToNeighborRecord(const NeighborInformation& ni)
+{
+    NeighborRecord record = NeighborRecord();
+    AddressToMac(ni.mac, record.mac);
+    record.last_beacon = ni.last_beacon.GetNanoSeconds();
+    record.pos = ni.pos;
+    record.velocity = ni.velocity;
+    record.acceleration = ni.acceleration;
+    return record;
+}
+
+NeighborInformation FromNeighborRecord(const NeighborRecord& record)
+{
+    NeighborInformation ni;
+    ni.mac = MacToAddress(record.mac);
+    ni.last_beacon = NanoSeconds(record.last_beacon);
+    ni.pos = record.pos;
+    ni.velocity = record.velocity;
+    ni.acceleration = record.acceleration;
+    return ni;
+}
+
 Address EvolutionApplication::GetAddress()
 {
-    return m_wifiDevice->GetAddress();
+    return m_device->GetAddress();
 }
 
 
@@ -82,19 +266,33 @@ void EvolutionApplication::StartApplication()
 {
     Ptr<Node> n = GetNode ();
     
+    //分布式仿真时每个进程都有全部节点，只运行本进程节点上的应用
+    if (n->GetSystemId () != Simulator::GetSystemId ())
+    {
+        return;
+    }
+    
     for (uint32_t i = 0; i < n->GetNDevices (); i++)
     {
         Ptr<NetDevice> dev = n->GetDevice (i);
-        if (dev->GetInstanceTypeId () == WifiNetDevice::GetTypeId())
+        if (dev->GetInstanceTypeId () == WifiNetDevice::GetTypeId()
+            || dev->GetInstanceTypeId () == WaveNetDevice::GetTypeId()
+            || dev->GetInstanceTypeId () == AbstractNetDevice::GetTypeId())
         {
-            //获取节点的wifi设备
-            m_wifiDevice = DynamicCast <WifiNetDevice> (dev);
+            //获取节点的wifi设备或抽象链路层设备，双射频时第二个wifi设备在服务信道上
+            if (!m_device) {
+                m_device = dev;
+                m_wave_device = DynamicCast<WaveNetDevice> (dev);
+            } else if (dev->GetInstanceTypeId () == WifiNetDevice::GetTypeId()) {
+                m_sch_device = dev;
+            } else {
+                continue;
+            }
             //接收数据包的回调
             dev->SetReceiveCallback (MakeCallback (&EvolutionApplication::ReceivePacket, this));
-            break;
         } 
     }
-    if (m_wifiDevice)
+    if (m_device)
     {
         //Ptr<UniformRandomVariable> rand = CreateObject<UniformRandomVariable> ();
         //Time random_offset = MicroSeconds (rand->GetValue(50,200));
@@ -103,24 +301,132 @@ void EvolutionApplication::StartApplication()
     }
     else
     {
-        NS_FATAL_ERROR ("There's no WifiNetDevice in your node");
+        NS_FATAL_ERROR ("There's no WifiNetDevice or AbstractNetDevice in your node");
+    }
+    //拥塞控制按信道忙比例调整信标间隔
+    if (m_dcc_enabled) {
+        ConnectChannelBusy();
+        m_dcc_event = Simulator::Schedule(Seconds(DCC_SAMPLE_INTERVAL), &EvolutionApplication::SampleChannelBusy, this);
     }
+
     //周期性检查邻居节点，并移除长时间未通信的节点
-    Simulator::Schedule (Seconds (1), &EvolutionApplication::RemoveOldNeighbors, this);
+    m_remove_neighbors_event = Simulator::Schedule (Seconds (1), &EvolutionApplication::RemoveOldNeighbors, this);
     
     // 周期性检查周围是否有障碍物
     if (m_is_simulate_avoid_obstacle) {
-        Simulator::Schedule(m_check_obstacle_interval, &EvolutionApplication::CheckObstacle, this);
+        m_check_obstacle_event = Simulator::Schedule(m_check_obstacle_interval, &EvolutionApplication::CheckObstacle, this);
+    }
+
+    // 周期性检查是否有节点失联，成员用心跳包确认父节点仍然在线
+    if (m_is_simulate_node_missing) {
+        m_check_missing_event = Simulator::Schedule(m_check_missing_interval, &EvolutionApplication::CheckMissing, this);
+    }
+    if ((m_is_simulate_node_missing || m_is_simulate_beacon) && isMember()) {
+        m_hello_event = Simulator::Schedule(GetHelloInterval(), &EvolutionApplication::SendHello, this);
+    }
+
+    // 周期性检查是否需要合并或分裂
+    if (m_is_simulate_adjust) {
+        m_adjust_event = Simulator::Schedule(m_adjust_interval, &EvolutionApplication::CheckAdjust, this);
+    }
+
+    //启动前分配的任务
+    if (m_pending_task >= 0) {
+        AssignTask((uint32_t)m_pending_task);
+    }
+}
+
+void EvolutionApplication::StopApplication()
+{
+    Simulator::Cancel (m_assign_task_event);
+    m_pending_task = -1;
+    Simulator::Cancel (m_hello_event);
+    Simulator::Cancel (m_construct_event);
+    Simulator::Cancel (m_wait_construct_event);
+    Simulator::Cancel (m_remove_neighbors_event);
+    Simulator::Cancel (m_check_obstacle_event);
+    Simulator::Cancel (m_route_update_event);
+    Simulator::Cancel (m_adjust_event);
+    Simulator::Cancel (m_check_missing_event);
+    Simulator::Cancel (m_dcc_event);
+    for (std::map<GroupCommandKey, GroupCommandState>::iterator iter = m_group_commands.begin();
+         iter != m_group_commands.end(); iter++) {
+        Simulator::Cancel (iter->second.retransmit_event);
+        Simulator::Cancel (iter->second.ack_event);
     }
+    for (std::map<HazardKey, GeocastState>::iterator iter = m_geocasts.begin(); iter != m_geocasts.end(); iter++) {
+        Simulator::Cancel (iter->second.forward_event);
+        Simulator::Cancel (iter->second.expire_event);
+    }
+}
+
+void EvolutionApplication::SetHelloInterval(Time interval)
+{
+    m_hello_interval = interval;
+    //航位推算时按检查周期调度，不受心跳包间隔影响
+    if (m_hello_event.IsRunning () && !m_dead_reckoning) {
+        Simulator::Cancel (m_hello_event);
+        m_hello_event = Simulator::Schedule (GetHelloInterval (), &EvolutionApplication::SendHello, this);
+    }
+}
+
+void EvolutionApplication::SetMissing()
+{
+    StopApplication ();
 }
 
 void EvolutionApplication::BroadcastInformation(Ptr<Packet> packet)
 {
     //将数据包以 WSMP (0x88dc)格式广播出去
-    m_wifiDevice->Send (packet, Mac48Address::GetBroadcast(), 0x88dc);
+    SendToDevice (packet, Mac48Address::GetBroadcast());
     
 }
 
+bool EvolutionApplication::SendToDevice(Ptr<Packet> packet, const Address &next_hop)
+{
+    PROFILE_SCOPE("EvolutionApplication::SendToDevice");
+    //按消息类别设置用户优先级，QoS MAC据此选择接入类别，安全消息不会排在心跳和建立广播后面
+    MessageHeader tag;
+    packet->PeekPacketTag (tag);
+    uint8_t type = tag.GetType () & ~GROUP_MESSAGE;
+    SocketPriorityTag priority;
+    priority.SetPriority (MessageClassPriority (MessageClass (type)));
+    if (!packet->ReplacePacketTag (priority)) {
+        packet->AddPacketTag (priority);
+    }
+    if (type == OBSTACLE_MESSAGE || type == GEOCAST_MESSAGE) {
+        RecordHazardTransmission (packet, tag);
+    }
+    //多信道时按消息类型选择信道：交替接入时SCH上的消息在MAC队列中等到SCH时隙，双射频时交给服务信道上的设备
+    uint8_t channel = MessageChannel (type);
+    bool ok;
+    if (m_wave_device) {
+        TxInfo info (MESSAGE_CHANNEL_NUMBERS[channel], priority.GetPriority ());
+        ok = m_wave_device->SendX (packet, next_hop, 0x88dc, info);
+    } else if (m_sch_device && channel == MESSAGE_CHANNEL_SCH) {
+        ok = m_sch_device->Send (packet, next_hop, 0x88dc);
+    } else {
+        ok = m_device->Send (packet, next_hop, 0x88dc);
+    }
+    if(ok){
+        m_sent_count++;
+        m_channel_sent[channel]++;
+    }
+    TracePacket (packet, GetAddress(), next_hop, ok ? TRACE_SENT : TRACE_SEND_FAILED);
+    return ok;
+}
+
+void EvolutionApplication::TracePacket(Ptr<const Packet> packet, const Address &src, const Address &dst, uint8_t outcome)
+{
+    TraceRecorder* recorder = TraceRecorder::Get();
+    if (!recorder->IsEnabled()) {
+        return;
+    }
+    MessageHeader tag;
+    packet->PeekPacketTag (tag);
+    recorder->Record (GetNode()->GetId(), tag.GetType(), src, dst, packet->GetSize(), outcome);
+}
+
 void EvolutionApplication::SendInformation(Ptr<Packet> packet, Address addr){
     
     // std::cout << m_router[addr] << std::endl;
@@ -131,12 +437,14 @@ void EvolutionApplication::SendInformation(Ptr<Packet> packet, Address addr){
         dest_addr = m_parent.mac;
     } else {
 	    //router不存在则丢弃
-	    if(m_router.find(addr)!=m_router.end()){
+	    std::map<Address,Address>::iterator route = m_router.find(addr);
+	    if(route == m_router.end()){
+            TracePacket (packet, GetAddress(), addr, TRACE_NO_ROUTE);
             return;
         }
-        dest_addr = m_router[addr];
+        dest_addr = route->second;
     }
-    m_wifiDevice->Send (packet, dest_addr, 0x88dc);
+    SendToDevice (packet, dest_addr);
 }
 
 void EvolutionApplication::SendGroupInformation(Ptr<Packet> packet){
@@ -168,6 +476,7 @@ void EvolutionApplication::SendToLeader(Ptr<Packet> packet, Address addr){
 }
 
 void EvolutionApplication::ConvertFromWaitConstructToLeader(){
+    PROFILE_SCOPE("EvolutionApplication::ConvertFromWaitConstructToLeader");
     //若过了一段时间还是WAIT_CONSTRUCT_STATE则主动成为leader
     if(m_state == WAIT_CONSTRUCT_STATE){
         m_state = LEADER_STATE;
@@ -178,71 +487,132 @@ void EvolutionApplication::ConvertFromWaitConstructToLeader(){
         SendConstructMessage();
     }
     else if(m_state == WAIT_CONSTRUCT_CONFIRM_STATE){//如果在等待确认阶段则过一段时间再看
-        Simulator::Schedule(m_wait_construct_time, &EvolutionApplication::ConvertFromWaitConstructToLeader, this);
+        m_wait_construct_event = Simulator::Schedule(m_wait_construct_time, &EvolutionApplication::ConvertFromWaitConstructToLeader, this);
     }
 }
 
 void EvolutionApplication::AssignTask(uint32_t task_id){
+    PROFILE_SCOPE("EvolutionApplication::AssignTask");
+    //分布式仿真时其它进程上的节点不运行应用
+    if(GetNode()->GetSystemId() != Simulator::GetSystemId()){
+        return;
+    }
+    //从检查点恢复时，检查点之前的任务分配已经完成
+    if(!m_restore_time.IsNegative() && Now() <= m_restore_time){
+        return;
+    }
+    //应用还没有启动（车辆还没有出现）时先记下任务，StartApplication取得设备后再分配
+    if(!m_device){
+        m_pending_task = task_id;
+        return;
+    }
+    m_pending_task = -1;
     m_state = WAIT_CONSTRUCT_STATE;
     m_task_id = task_id;
-    Simulator::Schedule(m_wait_construct_time, &EvolutionApplication::ConvertFromWaitConstructToLeader, this);
+    m_wait_construct_event = Simulator::Schedule(m_wait_construct_time, &EvolutionApplication::ConvertFromWaitConstructToLeader, this);
 }
 
 void EvolutionApplication::AssignTaskAtTime(uint32_t task_id, Time t){
-    Simulator::Schedule(t, &EvolutionApplication::AssignTask, this, task_id);
+    Simulator::Cancel(m_assign_task_event);
+    m_assign_task_event = Simulator::Schedule(t, &EvolutionApplication::AssignTask, this, task_id);
+}
+
+void EvolutionApplication::GetTimerState(Time& construct_delay, Time& wait_construct_delay){
+    construct_delay = m_construct_event.IsRunning() ? Simulator::GetDelayLeft(m_construct_event) : Seconds(-1);
+    wait_construct_delay = m_wait_construct_event.IsRunning() ? Simulator::GetDelayLeft(m_wait_construct_event) : Seconds(-1);
+}
+
+void EvolutionApplication::SetRestoreTime(Time t){
+    m_restore_time = t;
+}
+
+void EvolutionApplication::RestoreTimers(Time construct_delay, Time wait_construct_delay){
+    Simulator::Cancel(m_construct_event);
+    Simulator::Cancel(m_wait_construct_event);
+    if(!construct_delay.IsNegative()){
+        m_construct_event = Simulator::Schedule(construct_delay, &EvolutionApplication::SendConstructMessage, this);
+    }
+    if(!wait_construct_delay.IsNegative()){
+        m_wait_construct_event = Simulator::Schedule(wait_construct_delay, &EvolutionApplication::ConvertFromWaitConstructToLeader, this);
+    }
 }
 
 bool EvolutionApplication::ReceivePacket (Ptr<NetDevice> device, Ptr<const Packet> packet,uint16_t protocol, const Address &sender)
 {   
+    PROFILE_SCOPE("EvolutionApplication::ReceivePacket");
     MessageHeader tag;
     if (packet->PeekPacketTag (tag))
     {
+        TracePacket (packet, sender, GetAddress(), TRACE_RECEIVED);
+        m_received_count++;
+        m_channel_received_bytes[MessageChannel (tag.GetType () & ~GROUP_MESSAGE)] += packet->GetSize ();
         //取得载荷
+        //载荷复制到复用的接收缓冲区，处理函数不会在处理过程中再次进入ReceivePacket
         uint32_t payloadSize = tag.GetPayloadSize();
-        uint8_t* buffer = new uint8_t[payloadSize];
+        if(m_rx_buffer.size() < payloadSize){
+            m_rx_buffer.resize(payloadSize);
+        }
+        uint8_t* buffer = m_rx_buffer.empty() ? NULL : &m_rx_buffer[0];
         packet->CopyData(buffer,payloadSize);
         uint8_t type = tag.GetType();
         bool isGroup = type & GROUP_MESSAGE;
         type &= ~(GROUP_MESSAGE);
+        PROFILE_SCOPE(MessageTypeName(type));
+        //时间戳在转发时不变，时延为从消息产生到本节点收到
+        uint8_t hops = tag.GetHopCount() + 1;
+        LatencyStats::Get()->RecordDelivery(type, hops, Now() - tag.GetTimestamp());
 
-        // ReceivePacket要求packet参数指向一个const，但是我们其它的SendInformation类的函数不要求const，所以复制一个
-        Ptr<Packet> copy_packet = new Packet(*packet);
         // std::cout << (int)tag.GetType() << " isGroup: " << isGroup << ", " << type << std::endl;
         
+        //定长消息在这里按MessageSchema取出载荷并分派给对应的处理函数，变长消息由处理函数按项读取
         switch(type){
             case HELLO:
-                HandleHelloMessage(buffer, sender, tag.GetTimestamp());
+                Dispatch<HELLO>(buffer, payloadSize, &EvolutionApplication::HandleHelloMessage, sender, tag.GetTimestamp());
                 break;
             case HELLO_R:
-                HandleHelloRMessage(buffer, sender, tag.GetTimestamp());
+                Dispatch<HELLO_R>(buffer, payloadSize, &EvolutionApplication::HandleHelloRMessage, sender, tag.GetTimestamp());
                 break;
             case CONSTRUCT_MESSAGE:
                 if(m_debug_construct){
-                    HandleConstructMessage(buffer, sender);
+                    Dispatch<CONSTRUCT_MESSAGE>(buffer, payloadSize, &EvolutionApplication::HandleConstructMessage, sender);
                 }
                 break;
             case CONSTRUCT_REPLY_MESSAGE:
                 if(m_debug_construct){
-                    cout<<Now()<<" "<<GetAddress()<<" receive construct reply message from "<<sender<<endl;
+                    EVENT_LOG_DEBUG(EVENT_CONSTRUCT_REPLY_RECEIVED, GetNode()->GetId(), EventLog::AddressToArg(sender));
                 }
-                HandleConstructReplyMessage(buffer, sender, tag.GetTimestamp());
+                Dispatch<CONSTRUCT_REPLY_MESSAGE>(buffer, payloadSize, &EvolutionApplication::HandleConstructReplyMessage,
+                                                  sender, tag.GetTimestamp());
                 break;
             case CONSTRUCT_CONFIRM_MESSAGE:
                 if(m_debug_construct){
-                    cout<<Now()<<" "<<GetAddress()<<" receive construct confirm message from "<<sender<<endl;
+                    EVENT_LOG_DEBUG(EVENT_CONSTRUCT_CONFIRM_RECEIVED, GetNode()->GetId(), EventLog::AddressToArg(sender));
                 }
-                HandleConstructConfirmMessage(buffer);
+                Dispatch<CONSTRUCT_CONFIRM_MESSAGE>(buffer, payloadSize, &EvolutionApplication::HandleConstructConfirmMessage);
+                break;
+            case ROUTE_UPDATE_MESSAGE:
+                HandleRouteUpdateMessage(buffer, payloadSize, sender);
+                break;
+            case ADJUST_MESSAGE:
+                Dispatch<ADJUST_MESSAGE>(buffer, payloadSize, &EvolutionApplication::HandleAdjustMessage, sender);
+                break;
+            case TRANSFER_MESSAGE:
+                HandleTransferMessage(buffer, payloadSize, sender);
+                break;
+            case RECEIVE_MESSAGE:
+                HandleGroupAckMessage(buffer, payloadSize, sender);
                 break;
             case OBSTACLE_MESSAGE:
-                // 如果是leader接到，则发给它的子节点避障命令
-                // 如果是普通节点，则执行避障命令
-                if (isLeader()) {
-                    SendGroupInformation(copy_packet);
-                    std::cout << "Leader " << GetAddress() << " 向子节点下达避障命令，自己也避障" << std::endl;
-                } else {
-                    // 模拟执行避障动作
-                    std::cout << GetAddress() << " 正在避障" << std::endl;
+                // 组播的避障命令：执行并沿车群树可靠地向下转发
+                if (isGroup) {
+                    HandleGroupCommandMessage(type, buffer, payloadSize, sender, tag.GetTimestamp(), hops);
+                    break;
                 }
+                Dispatch<OBSTACLE_MESSAGE>(buffer, payloadSize, &EvolutionApplication::HandleObstacleMessage, sender);
+                break;
+            case GEOCAST_MESSAGE:
+                Dispatch<GEOCAST_MESSAGE>(buffer, payloadSize, &EvolutionApplication::HandleGeocastMessage,
+                                          tag.GetTimestamp(), hops, sender);
                 break;
             // case AVOID_MESSAGE:
             //     std::cout << GetAddress() << " is avoiding obstacle" << std::endl;
@@ -254,43 +624,41 @@ bool EvolutionApplication::ReceivePacket (Ptr<NetDevice> device, Ptr<const Packe
             case SEARCH_MESSAGE:
                 // 如果是leader收到搜寻消息，则让子节点也去帮忙找
                 // 如果是子节点收到消息，则帮忙找
-                if (isLeader()) {
-                    // todo SendGroupInformation(packet, addr);
-                    std::cout << "Leader向子节点下达搜寻命令(?自己也开始搜寻?)" << std::endl;
-                } else {
-                    // 模拟执行搜寻动作
-                    // todo 如果sumo设计得好，后面真找到了，需要再写一个schedule用的定时搜寻
-                    std::cout << "正在搜寻节点" << std::endl;
-                }
+                // todo leader: SendGroupInformation(packet, addr);
+                // todo 子节点：如果sumo设计得好，后面真找到了，需要再写一个schedule用的定时搜寻
+                EVENT_LOG_INFO(EVENT_SEARCH_RECEIVED, GetNode()->GetId(), isLeader() ? 1 : 0);
             default:
                 NS_LOG_ERROR("unknown message type");
                 break;
         }
-        
-        // 如果是组播 还需要继续转发消息，目前只有一个车群的组播，子节点的信息都在router里
-        if (isGroup) {
-            for (std::map<Address,Address>::iterator iter = m_router.begin();
-                iter != m_router.end(); iter++) {
-                SendInformation(copy_packet, iter->first);
-                std::cout << GetAddress() << " 向 " << iter->second << "发送消息" << std::endl;
-            }
-        }
-        
-        delete buffer;
     }
 
-    UpdateNeighbor (sender);
     return true;
 }
 
-void EvolutionApplication::UpdateNeighbor (Address addr)
+void EvolutionApplication::UpdateNeighbor (const Address& addr, const Vector& pos, const Vector& velocity,
+                                           const Vector& acceleration)
 {
-
+    NeighborInformation& ni = m_neighbors[addr];
+    ni.mac = addr;
+    ni.last_beacon = Now();
+    ni.pos = pos;
+    ni.velocity = velocity;
+    ni.acceleration = acceleration;
 }
 
 void EvolutionApplication::RemoveOldNeighbors ()
 {
-
+    PROFILE_SCOPE("EvolutionApplication::RemoveOldNeighbors");
+    //超过失联时间限制没有再听到的邻居位置已不可信
+    for(std::map<Address, NeighborInformation>::iterator iter = m_neighbors.begin(); iter != m_neighbors.end();){
+        if(Now() - iter->second.last_beacon >= GetTimeLimit()){
+            m_neighbors.erase(iter++);
+        }else{
+            iter++;
+        }
+    }
+    m_remove_neighbors_event = Simulator::Schedule (Seconds (1), &EvolutionApplication::RemoveOldNeighbors, this);
 }
 
 void EvolutionApplication::SetWifiMode (WifiMode mode)
@@ -300,6 +668,7 @@ void EvolutionApplication::SetWifiMode (WifiMode mode)
 
 bool EvolutionApplication::CheckObstacle()
 {
+    PROFILE_SCOPE("EvolutionApplication::CheckObstacle");
     //取得节点位置
     Vector curPos = GetNode()->GetObject<MobilityModel>()->GetPosition();
 
@@ -313,41 +682,36 @@ bool EvolutionApplication::CheckObstacle()
 
     // 将障碍物位置信息放在payload里
     Vector pos = Vector(m_obstacle.x, m_obstacle.y, m_obstacle.z); // todo check valid
-    int payloadSize = sizeof(Vector);
-    uint8_t *buffer = new uint8_t[payloadSize];
-    uint16_t index = 0;
-    memcpy(buffer + index, &pos, sizeof(pos));
-    index += sizeof(pos);
-    Ptr<Packet> packet = Create<Packet>(buffer, payloadSize);
-
-    //心跳包消息头
-    MessageHeader tag;
-    tag.SetType(OBSTACLE_MESSAGE);
-    tag.SetTimestamp(Now());
-    tag.SetPayloadSize(payloadSize);
-    tag.SetSrcAddr(m_wifiDevice->GetAddress());
+    ObstacleInformation oi = ObstacleInformation();
+    oi.hazard = pos;
+    HazardStats::Get()->StartHazard(pos, m_geocast_radius, GetNode()->GetId());
+
+    // 地理广播模式：不论是否在车群中，都直接向障碍物周围的区域广播
+    if (m_geocast_obstacle) {
+        EVENT_LOG_INFO(EVENT_OBSTACLE_DETECTED, GetNode()->GetId(), isLeader() ? 1 : 0, m_neighbor_leaders.size());
+        StartGeocast(pos);
+        return true;
+    }
+
+    //避障消息消息头
+    MessageHeader tag = MakeTag(Mac48Address::GetBroadcast());
 
     // 遇到障碍，如果是leader，通知子车群和其它车群leader避障；如果是普通子节点，通知leader
     if (isLeader()) {
         // 通知其它车群避障
-        std::cout << "Leader " << GetAddress() << " 检测到障碍，通知其子节点和其它车群Leader避障" << std::endl;
-        tag.SetDesAddr(Mac48Address::GetBroadcast());
-        packet->AddPacketTag(tag);
+        EVENT_LOG_INFO(EVENT_OBSTACLE_DETECTED, GetNode()->GetId(), 1, m_neighbor_leaders.size());
+        Ptr<Packet> packet = MakeMessage(tag, oi, &m_obstacle_pool);
         std::vector<NeighborInformation>::iterator it;
         for(it = m_neighbor_leaders.begin(); it != m_neighbor_leaders.end(); it++) {
             // std::cout << "hello1" << std::endl;
             SendToLeader(packet, it->mac);
         }
 
-        // 通知子车群避障
-        Ptr<Packet> packetForSon = Create<Packet>(buffer, payloadSize);
-        tag.SetType(OBSTACLE_MESSAGE | GROUP_MESSAGE); // 组播
-        packetForSon->AddPacketTag(tag);
-        SendGroupInformation(packetForSon);
+        // 可靠地通知整个车群避障
+        SendGroupCommand(oi);
         // std::cout << "==========================" << std::endl;
     } else {
-        tag.SetDesAddr(Mac48Address::GetBroadcast());
-        packet->AddPacketTag(tag);
+        Ptr<Packet> packet = MakeMessage(tag, oi, &m_obstacle_pool);
         // std::cout << "hello2" << std::endl;
         // PrintRouter();
         SendToLeader(packet);
@@ -358,12 +722,167 @@ bool EvolutionApplication::CheckObstacle()
 
 bool EvolutionApplication::CheckMissing()
 {
-    return false;
+    PROFILE_SCOPE("EvolutionApplication::CheckMissing");
+    m_check_missing_event = Simulator::Schedule(m_check_missing_interval, &EvolutionApplication::CheckMissing, this);
+    //父节点或子节点超过这个时间没有心跳时离开车群或被移除，需要比备用leader接替的时间长
+    Time expire = GetTimeLimit() + m_check_missing_interval * 2;
+    bool missing = false;
+
+    //移除失联的子节点和它的子树
+    std::vector<Address> expired;
+    for (vector<NeighborInformation>::iterator iter = m_next.begin(); iter != m_next.end(); iter++) {
+        if (Now() - iter->last_beacon > expire) {
+            expired.push_back(iter->mac);
+        }
+    }
+    for (size_t i = 0; i < expired.size(); i++) {
+        RemoveChild(expired[i]);
+        missing = true;
+    }
+
+    if (isLeader()) {
+        SyncStandby();
+        return missing;
+    }
+
+    if (!isMember()) {
+        return false;
+    }
+    if (!m_hello_event.IsRunning()) {
+        StartHelloIfMember();
+        return missing;
+    }
+    Time silence = Now() - m_parent.last_beacon;
+    if (silence < GetTimeLimit()) {
+        return missing;
+    }
+    //leader失联：最近同步过的备用leader立即接替
+    if (m_parent.mac == m_standby_leader && !m_standby_sync_time.IsNegative()
+        && m_parent.last_beacon - m_standby_sync_time <= m_check_missing_interval * 2) {
+        SwitchLeader();
+        return true;
+    }
+    //没有备用leader接替，子树离开车群重新建立
+    if (silence > expire) {
+        AdjustInformation ai = AdjustInformation();
+        ai.reason = ADJUST_REASON_FAILOVER;
+        ai.start = m_parent.last_beacon.GetNanoSeconds();
+        ai.task_id = m_task_id;
+        Detach(ai);
+        return true;
+    }
+    return missing;
 }
 
-void switchLeader()
+void EvolutionApplication::SwitchLeader()
 {
-    
+    Address old_leader = m_parent.mac;
+    Time last_beacon = m_parent.last_beacon;
+    m_state = LEADER_STATE;
+    m_level = 1;
+    m_leader.mac = GetAddress();
+    m_leader.pos = GetLocation();
+    m_leader.last_beacon = Now();
+    m_parent.mac = Address();
+    m_router.erase(old_leader);
+    //成为leader后不再向上通告路由
+    m_pending_routes.clear();
+    Simulator::Cancel(m_route_update_event);
+    LatencyStats::Get()->RecordFlow("failover_takeover", Now() - last_beacon);
+    EVENT_LOG_INFO(EVENT_FAILOVER, GetNode()->GetId(), EventLog::AddressToArg(old_leader), m_standby_children.size(),
+                   m_standby_neighbor_leaders.size());
+
+    //自己的子树级数减1
+    AdjustInformation ai = AdjustInformation();
+    ai.reason = ADJUST_REASON_FAILOVER;
+    ai.start = last_beacon.GetNanoSeconds();
+    ai.task_id = m_task_id;
+    RelevelChildren(ai);
+
+    TransferInformation ti = TransferInformation();
+    ti.op = TRANSFER_TAKEOVER;
+    ti.task_id = m_task_id;
+    ti.start = last_beacon.GetNanoSeconds();
+    AddressToMac(old_leader, ti.old_leader);
+    std::vector<Address> none;
+
+    //接替原leader与邻近车群的连接
+    for (size_t i = 0; i < m_standby_neighbor_leaders.size(); i++) {
+        NeighborInformation ni;
+        ni.mac = m_standby_neighbor_leaders[i];
+        ni.last_beacon = Now();
+        m_neighbor_leaders.push_back(ni);
+        m_router[ni.mac] = ni.mac;
+        TransferInformation announce = ti;
+        announce.op = TRANSFER_ANNOUNCE;
+        SendTransferMessage(announce, none, none, ni.mac);
+    }
+
+    //其它二级节点一次接到自己下面，子节点已满时成为新车群的leader，与本车群相邻
+    for (size_t i = 0; i < m_standby_children.size(); i++) {
+        NeighborInformation ni;
+        ni.mac = m_standby_children[i];
+        ni.last_beacon = Now();
+        if (m_next.size() < m_max_subnodes) {
+            ti.role = TRANSFER_ROLE_MEMBER;
+            m_next.push_back(ni);
+        }
+        else {
+            ti.role = TRANSFER_ROLE_LEADER;
+            m_neighbor_leaders.push_back(ni);
+        }
+        m_router[ni.mac] = ni.mac;
+        SendTransferMessage(ti, none, none, ni.mac);
+    }
+
+    m_standby_sync_time = Seconds(-1);
+    m_standby_leader = Address();
+    m_standby_children.clear();
+    m_standby_neighbor_leaders.clear();
+}
+
+void EvolutionApplication::SyncStandby()
+{
+    //按最近由心跳包更新过的位置选择离leader最近的二级节点，它与leader的链路最不容易断开
+    Vector pos = GetLocation();
+    vector<NeighborInformation>::iterator best = m_next.end();
+    vector<NeighborInformation>::iterator current = m_next.end();
+    double best_distance = 0;
+    for (vector<NeighborInformation>::iterator iter = m_next.begin(); iter != m_next.end(); iter++) {
+        if (Now() - iter->last_beacon >= GetTimeLimit()) {
+            continue;
+        }
+        double distance = CalculateDistance(PredictPosition(*iter), pos);
+        if (best == m_next.end() || distance < best_distance) {
+            best = iter;
+            best_distance = distance;
+        }
+        if (iter->mac == m_standby) {
+            current = iter;
+        }
+    }
+    if (best == m_next.end()) {
+        m_standby = Address();
+        return;
+    }
+    if (current == m_next.end() || best_distance < STANDBY_SWITCH_RATIO * CalculateDistance(PredictPosition(*current), pos)) {
+        m_standby = best->mac;
+    }
+
+    std::vector<Address> children;
+    for (vector<NeighborInformation>::iterator iter = m_next.begin(); iter != m_next.end(); iter++) {
+        if (iter->mac != m_standby) {
+            children.push_back(iter->mac);
+        }
+    }
+    std::vector<Address> neighbor_leaders;
+    for (vector<NeighborInformation>::iterator iter = m_neighbor_leaders.begin(); iter != m_neighbor_leaders.end(); iter++) {
+        neighbor_leaders.push_back(iter->mac);
+    }
+    TransferInformation ti = TransferInformation();
+    ti.op = TRANSFER_SYNC;
+    ti.task_id = m_task_id;
+    SendTransferMessage(ti, children, neighbor_leaders, m_standby);
 }
 
 void EvolutionApplication::PrintRouter() {
@@ -375,46 +894,70 @@ void EvolutionApplication::PrintRouter() {
     std::cout << "======= end print router =======" << std::endl;
 }
 
+void EvolutionApplication::LogRouter() {
+    for (std::map<Address,Address>::iterator iter = m_router.begin();
+        iter != m_router.end(); iter++) {
+        EVENT_LOG_DEBUG(EVENT_ROUTE_ENTRY, GetNode()->GetId(), EventLog::AddressToArg(iter->first), EventLog::AddressToArg(iter->second));
+    }
+}
+
 void EvolutionApplication::SendHello(){
+    PROFILE_SCOPE("EvolutionApplication::SendHello");
     //如果是leader，则不用发送心跳包
     if(!isMember()){
         return ;
     }
     
-    //心跳包载荷
-    HelloInformation hi;
-    hi.pos = GetLocation();
-    Ptr<Packet> packet = Create <Packet> ((uint8_t*)&hi, sizeof(hi));
+    m_dr.Sample(GetLocation(), GetNode()->GetObject<MobilityModel>()->GetVelocity(), Now());
+    if(m_dead_reckoning){
+        if(m_parent.mac != m_dr_parent){
+            m_dr.Reset();
+        }
+        if(m_dr.NeedsBeacon(m_position_threshold, m_dr_max_interval, Now())){
+            TransmitHello();
+        }
+        m_hello_event = Simulator::Schedule (GetDeadReckoningInterval(), &EvolutionApplication::SendHello, this);
+        return;
+    }
+    TransmitHello();
+    m_hello_event = Simulator::Schedule (GetHelloInterval(), &EvolutionApplication::SendHello, this);
+}
+
+void EvolutionApplication::TransmitHello(){
+    //心跳包载荷，与接收方的预测一致，位置也取采样时的值
+    HelloInformation hi = HelloInformation();
+    hi.pos = m_dr.GetPosition();
+    hi.velocity = m_dr.GetVelocity();
+    hi.acceleration = m_dr.GetAcceleration();
     
     //心跳包消息头 
-    MessageHeader tag;
-    tag.SetType(HELLO);
-    tag.SetTimestamp(Now());
-    tag.SetPayloadSize(sizeof(hi));
-    tag.SetDesAddr(m_parent.mac);
-    tag.SetSrcAddr(m_wifiDevice->GetAddress());
-    packet->AddPacketTag (tag);
+    MessageHeader tag = MakeTag(m_parent.mac);
+    Ptr<Packet> packet = MakeMessage(tag, hi, &m_hello_pool);
     
     //广播心跳包
     SendInformation(packet,m_parent.mac);
-    Simulator::Schedule (m_hello_interval, &EvolutionApplication::SendHello, this);
-    
+    m_hello_sent++;
+    m_dr.MarkSent(Now());
+    m_dr_parent = m_parent.mac;
 }
 
-void EvolutionApplication::HandleHelloMessage(uint8_t *buffer, const Address &sender, Time timestamp){
+void EvolutionApplication::HandleHelloMessage(const HelloInformation& hi, const Address &sender, Time timestamp){
+    UpdateNeighbor(sender, hi.pos, hi.velocity, hi.acceleration);
     bool find = false;//是否在m_next中找到sender
     //更新m_next的节点信息
-    HelloInformation* hi = (HelloInformation*)buffer;
     for(vector<NeighborInformation>::iterator iter=m_next.begin();iter!=m_next.end();iter++){
         if(iter->mac == sender){
             iter->last_beacon = timestamp;
-            iter->pos = hi->pos;
+            iter->pos = hi.pos;
+            iter->velocity = hi.velocity;
+            iter->acceleration = hi.acceleration;
             find = true;
             break;
         }
     }
+    //合并、分裂后父节点已经改变，旧的心跳包可能还在路上
     if(!find){
-        NS_FATAL_ERROR ("收到非子结点的HELLOMessage");
+        NS_LOG_WARN ("收到非子结点的HELLOMessage");
         return ;
     }
     
@@ -425,43 +968,32 @@ void EvolutionApplication::SendHelloR(const Address &addr){
     //TODO 计算节点引领度
     
     
-    //构造载荷
-    int payloadSize = 0;
-    uint8_t * buffer = new uint8_t[payloadSize];
-    //uint16_t index = 0;
-    
-    Ptr<Packet> packet = Create <Packet> (buffer,payloadSize);
-    
-    delete buffer;
-    
-    //心跳回复包消息头 
-    MessageHeader tag;
-    tag.SetType(HELLO_R);
-    tag.SetTimestamp(Now());
-    tag.SetPayloadSize(payloadSize);
-    tag.SetDesAddr(addr);
-    tag.SetSrcAddr(m_wifiDevice->GetAddress());
-    packet->AddPacketTag (tag);
+    //心跳回复包没有载荷
+    HelloRInformation hri = HelloRInformation();
+    MessageHeader tag = MakeTag(addr);
+    Ptr<Packet> packet = MakeMessage(tag, hri, &m_hello_r_pool);
     
     SendInformation(packet, addr);
 }
 
-void EvolutionApplication::HandleHelloRMessage(uint8_t *buffer, const Address &sender, Time timestamp){
+void EvolutionApplication::HandleHelloRMessage(const HelloRInformation& hri, const Address &sender, Time timestamp){
     if(sender!=m_parent.mac){
-        NS_FATAL_ERROR ("收到非父结点的HELLORMessage");
+        NS_LOG_WARN ("收到非父结点的HELLORMessage");
         return ;
     }
     //TODO 更新节点引领度
     
     //更新parent信息
     m_parent.last_beacon = timestamp;
+    m_hello_replies++;
 }
 
 void EvolutionApplication::SendConstructMessage(){
+    PROFILE_SCOPE("EvolutionApplication::SendConstructMessage");
     //如果自己没有车群，则不发送建立消息
     if(!isLeader() && !isMember()){
         if(m_debug_construct){
-            cout<<Now()<<" "<<GetAddress()<<" stop broadcast construct message for isnt leader or member"<<endl;
+            EVENT_LOG_DEBUG(EVENT_CONSTRUCT_STOP, GetNode()->GetId(), 0, m_next.size());
         }
         return;
     }
@@ -469,95 +1001,74 @@ void EvolutionApplication::SendConstructMessage(){
     //如果子结点达到最大子结点数的2/3，就不再广播建立消息
     if(3*m_next.size()>=2*m_max_subnodes){
         if(m_debug_construct){
-            cout<<Now()<<" "<<GetAddress()<<" stop broadcast construct message for too many subnodes "<<endl;
+            EVENT_LOG_DEBUG(EVENT_CONSTRUCT_STOP, GetNode()->GetId(), 1, m_next.size());
         }
         return ;
     }
     
     //建立消息载荷
-    ConstructInformation ci;
+    ConstructInformation ci = ConstructInformation();
     ci.pos = GetNode()->GetObject<MobilityModel>()->GetPosition();//取得节点位置
     ci.task_id = m_task_id;
     
-    Ptr<Packet> packet = Create <Packet> ((uint8_t*)&ci,sizeof(ci));
-    
-    //建立消息消息头 
-    MessageHeader tag;
-    tag.SetType(CONSTRUCT_MESSAGE);
-    tag.SetTimestamp(Now());
-    tag.SetPayloadSize(sizeof(ci));
-    tag.SetDesAddr(Mac48Address::GetBroadcast());
-    tag.SetSrcAddr(m_wifiDevice->GetAddress());
-    packet->AddPacketTag (tag);
-    
     //广播建立消息
     if(m_debug_construct){
-        cout<<Now()<<" "<<GetAddress()<<" broadcast construct message"<<endl;
+        EVENT_LOG_DEBUG(EVENT_CONSTRUCT_BROADCAST, GetNode()->GetId(), m_task_id);
     }
-    BroadcastInformation(packet);
+    Send(ci, Mac48Address::GetBroadcast());
     
     Ptr<UniformRandomVariable> rand = CreateObject<UniformRandomVariable> ();
     Time random_offset = Seconds (rand->GetValue(0,m_construct_interval.GetSeconds()/4));
-    Simulator::Schedule (m_construct_interval, &EvolutionApplication::SendConstructMessage, this);
+    m_construct_event = Simulator::Schedule (GetConstructInterval(), &EvolutionApplication::SendConstructMessage, this);
     
 }
 
-void EvolutionApplication::HandleConstructMessage(uint8_t *buffer, const Address &sender){
+void EvolutionApplication::HandleConstructMessage(const ConstructInformation& ci, const Address &sender){
+    UpdateNeighbor(sender, ci.pos);
     //只有处于等待建立状态才接收建立消息
     if(m_state!=WAIT_CONSTRUCT_STATE){
         return ;
     }
     
-    ConstructInformation* ci = (ConstructInformation*)buffer;
-    
-    
     //和发送建立消息的车任务不同，则忽视其他的建立消息
-    if(ci->task_id != m_task_id){
+    if(ci.task_id != m_task_id){
             return ;
     }
     //回复建立消息
     SendConstructReplyMessage(sender);
+    m_construct_reply_time = Now();
     m_state = WAIT_CONSTRUCT_CONFIRM_STATE;
 }
 
 void EvolutionApplication::SendConstructReplyMessage(const Address &addr){
     if(m_debug_construct){
-        cout<<Now()<<" "<<GetAddress()<<" send construct reply message to "<<addr<<endl;
+        EVENT_LOG_DEBUG(EVENT_CONSTRUCT_REPLY_SENT, GetNode()->GetId(), EventLog::AddressToArg(addr));
     }
     //建立回复消息载荷
-    ConstructReplyInformation cri;
+    ConstructReplyInformation cri = ConstructReplyInformation();
     cri.pos = GetNode()->GetObject<MobilityModel>()->GetPosition();//取得节点位置
-    Ptr<Packet> packet = Create <Packet> ((uint8_t*)&cri,sizeof(cri));
-    
-    //建立回复消息消息头 
-    MessageHeader tag;
-    tag.SetType(CONSTRUCT_REPLY_MESSAGE);
-    tag.SetTimestamp(Now());
-    tag.SetPayloadSize(sizeof(cri));
-    tag.SetDesAddr(addr);
-    tag.SetSrcAddr(m_wifiDevice->GetAddress());
-    packet->AddPacketTag (tag);
     
-    m_wifiDevice->Send (packet, addr, 0x88dc);
+    Send(cri, addr);
 }
 
-void EvolutionApplication::HandleConstructReplyMessage(uint8_t* buffer, const Address &sender, Time timestamp){
-    ConstructReplyInformation* cri = (ConstructReplyInformation*)buffer;       
-       
+void EvolutionApplication::HandleConstructReplyMessage(const ConstructReplyInformation& cri, const Address &sender, Time timestamp){
+    UpdateNeighbor(sender, cri.pos);
     //建立确认消息载荷
-    ConstructConfirmInformation cci;
+    ConstructConfirmInformation cci = ConstructConfirmInformation();
     if(3*m_next.size()<2*m_max_subnodes){
         cci.accept = 1;
         cci.level = m_level + 1;
-        cci.leader = m_leader;
-        cci.parent.mac = GetAddress();
-        cci.parent.last_beacon = Now();
-        m_router[sender] = sender;
+        cci.leader = ToNeighborRecord(m_leader);
+        NeighborInformation parent;
+        parent.mac = GetAddress();
+        parent.last_beacon = Now();
+        cci.parent = ToNeighborRecord(parent);
+        AddChildRoute(sender);
         //添加子节点信息
         NeighborInformation ni;
         ni.mac = sender;
         ni.last_beacon = timestamp;
-        ni.pos = cri->pos;
+        ni.pos = cri.pos;
         m_next.push_back(ni);
     }
     else{
@@ -568,39 +1079,1068 @@ void EvolutionApplication::HandleConstructReplyMessage(uint8_t* buffer, const Ad
 }
 
 void EvolutionApplication::SendConstructConfirmMessage(const ConstructConfirmInformation& cci, const Address &addr){
-    Ptr<Packet> packet = Create <Packet> ((uint8_t*)&cci,sizeof(cci));
-    
-    //建立确认消息消息头 
-    MessageHeader tag;
-    tag.SetType(CONSTRUCT_CONFIRM_MESSAGE);
-    tag.SetTimestamp(Now());
-    tag.SetPayloadSize(sizeof(cci));
-    tag.SetDesAddr(addr);
-    tag.SetSrcAddr(m_wifiDevice->GetAddress());
-    packet->AddPacketTag (tag);
     if(m_debug_construct){
-        cout<<Now()<<" "<<GetAddress()<<" send construct confirm message to "<<addr<<endl;
+        EVENT_LOG_DEBUG(EVENT_CONSTRUCT_CONFIRM_SENT, GetNode()->GetId(), EventLog::AddressToArg(addr), cci.accept);
     }
-    m_wifiDevice->Send (packet, addr, 0x88dc);
+    Send(cci, addr);
 }
 
-void EvolutionApplication::HandleConstructConfirmMessage(uint8_t* buffer){
-    ConstructConfirmInformation* cci = (ConstructConfirmInformation*)buffer;
-    if(cci->accept == 1){
+void EvolutionApplication::HandleConstructConfirmMessage(const ConstructConfirmInformation& cci){
+    if(m_state == WAIT_CONSTRUCT_CONFIRM_STATE){
+        LatencyStats::Get()->RecordFlow("construct_round_trip", Now() - m_construct_reply_time);
+    }
+    if(cci.accept == 1){
         m_state = MEMBER_STATE;
-        m_parent = cci->parent;
-        m_leader = cci->leader;
-        m_level = cci->level;
+        m_parent = FromNeighborRecord(cci.parent);
+        m_leader = FromNeighborRecord(cci.leader);
+        m_level = cci.level;
+        AnnounceSubtree();
         SendConstructMessage();
-        if(m_debug_construct){
-            cout<<Now()<<" "<<GetAddress()<<" get constructed level= "<<(int)m_level<<" parent= "<<m_parent.mac<<" leader= "<<m_leader.mac<<endl;
-        }
+        EVENT_LOG_INFO(EVENT_CONSTRUCTED, GetNode()->GetId(), m_level, EventLog::AddressToArg(m_parent.mac), EventLog::AddressToArg(m_leader.mac));
     }
     else{
         m_state = WAIT_CONSTRUCT_STATE;
-        if(m_debug_construct){
-            cout<<Now()<<" "<<GetAddress()<<" get rejected "<<endl;
+        EVENT_LOG_INFO(EVENT_CONSTRUCT_REJECTED, GetNode()->GetId());
+    }
+}
+
+
+void EvolutionApplication::AddChildRoute(const Address &child){
+    std::map<Address,Address>::iterator iter = m_router.find(child);
+    if(iter != m_router.end() && iter->second == child){
+        return;
+    }
+    m_router[child] = child;
+    QueueRouteDelta(child, ROUTE_ADD);
+}
+
+void EvolutionApplication::RemoveChild(const Address &child){
+    for(vector<NeighborInformation>::iterator iter=m_next.begin();iter!=m_next.end();iter++){
+        if(iter->mac == child){
+            m_next.erase(iter);
+            break;
+        }
+    }
+    //删除子节点本身和它的子树中的节点
+    for(std::map<Address,Address>::iterator iter = m_router.begin(); iter != m_router.end(); ){
+        if(iter->second == child){
+            QueueRouteDelta(iter->first, ROUTE_REMOVE);
+            m_router.erase(iter++);
+        }
+        else{
+            iter++;
+        }
+    }
+}
+
+void EvolutionApplication::AnnounceSubtree(){
+    //父节点已经添加了到本节点的路由，只需要通告本节点的子树，不包括到邻近leader的路由
+    for(std::map<Address,Address>::iterator iter = m_router.begin(); iter != m_router.end(); iter++){
+        if(IsChild(iter->second)){
+            QueueRouteDelta(iter->first, ROUTE_ADD);
+        }
+    }
+}
+
+void EvolutionApplication::QueueRouteDelta(const Address &dest, uint8_t op){
+    if(!isMember()){
+        return;
+    }
+    m_pending_routes[dest] = op;
+    if(!m_route_update_event.IsRunning()){
+        m_route_update_event = Simulator::Schedule(m_route_update_interval, &EvolutionApplication::SendRouteUpdate, this);
+    }
+}
+
+void EvolutionApplication::SendRouteUpdate(){
+    PROFILE_SCOPE("EvolutionApplication::SendRouteUpdate");
+    if(!isMember() || m_pending_routes.empty()){
+        m_pending_routes.clear();
+        return;
+    }
+    std::vector<RouteDelta> deltas;
+    deltas.reserve(std::min<size_t>(m_pending_routes.size(), MAX_ROUTE_DELTAS));
+    std::map<Address,uint8_t>::iterator iter = m_pending_routes.begin();
+    while(iter != m_pending_routes.end()){
+        RouteDelta delta = RouteDelta();
+        delta.op = iter->second;
+        AddressToMac(iter->first, delta.mac);
+        deltas.push_back(delta);
+        iter++;
+        //一个消息放不下时分成多个消息
+        if(deltas.size() < MAX_ROUTE_DELTAS && iter != m_pending_routes.end()){
+            continue;
+        }
+        //路由更新消息消息头
+        MessageHeader tag = MakeTag(m_parent.mac);
+        Ptr<Packet> packet = MakeMessage(tag, RouteUpdateInformation(), &deltas[0], deltas.size(), NULL);
+
+        EVENT_LOG_DEBUG(EVENT_ROUTE_UPDATE_SENT, GetNode()->GetId(), EventLog::AddressToArg(m_parent.mac), deltas.size());
+        SendToDevice (packet, m_parent.mac);
+        deltas.clear();
+    }
+    m_pending_routes.clear();
+}
+
+void EvolutionApplication::HandleRouteUpdateMessage(const uint8_t* buffer, uint32_t size, const Address &sender){
+    //只接受子节点的路由更新，离开后迟到的更新不能再添加路由
+    if(!IsChild(sender)){
+        return;
+    }
+    int64_t n = MessageItemCount<RouteUpdateInformation>(size);
+    if(n < 0){
+        NS_LOG_ERROR("ROUTE_UPDATE_MESSAGE长度错误");
+        return;
+    }
+    for(uint32_t i = 0; i < n; i++){
+        RouteDelta delta = ReadMessageItem<RouteUpdateInformation>(buffer, i);
+        Address dest = MacToAddress(delta.mac);
+        if(dest == GetAddress()){
+            continue;
+        }
+        std::map<Address,Address>::iterator iter = m_router.find(dest);
+        if(delta.op == ROUTE_ADD){
+            //已经经过这个子节点时不需要再向上通告
+            if(iter != m_router.end() && iter->second == sender){
+                continue;
+            }
+            m_router[dest] = sender;
+            QueueRouteDelta(dest, ROUTE_ADD);
+        }
+        else{
+            //节点已经转到其它子树时，旧子树迟到的删除不生效
+            if(iter == m_router.end() || iter->second != sender){
+                continue;
+            }
+            m_router.erase(iter);
+            QueueRouteDelta(dest, ROUTE_REMOVE);
+        }
+        EVENT_LOG_DEBUG(EVENT_ROUTE_UPDATE_APPLIED, GetNode()->GetId(), EventLog::AddressToArg(sender),
+                        EventLog::AddressToArg(dest), delta.op);
+    }
+}
+
+bool EvolutionApplication::IsChild(const Address &addr){
+    for(vector<NeighborInformation>::iterator iter=m_next.begin();iter!=m_next.end();iter++){
+        if(iter->mac == addr){
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t EvolutionApplication::GetGroupSize(){
+    uint32_t size = 1;
+    for(std::map<Address,Address>::iterator iter = m_router.begin(); iter != m_router.end(); iter++){
+        if(IsChild(iter->second)){
+            size++;
         }
     }
+    return size;
+}
+
+uint64_t EvolutionApplication::GetMergeMessageCount(){
+    return m_merge_messages;
+}
+
+uint64_t EvolutionApplication::GetSplitMessageCount(){
+    return m_split_messages;
 }
 
+void EvolutionApplication::SendAdjustMessage(const AdjustInformation& ai, const Address &addr){
+    //合并与分裂消息消息头
+    MessageHeader tag = MakeTag(addr);
+    Ptr<Packet> packet = MakeMessage(tag, ai, &m_group_pool);
+
+    if(ai.reason == ADJUST_REASON_SPLIT){
+        m_split_messages++;
+    }
+    else if(ai.reason == ADJUST_REASON_FAILOVER){
+        m_failover_messages++;
+    }
+    else{
+        m_merge_messages++;
+    }
+    SendToDevice (packet, addr);
+}
+
+void EvolutionApplication::CheckAdjust(){
+    PROFILE_SCOPE("EvolutionApplication::CheckAdjust");
+    m_adjust_event = Simulator::Schedule(m_adjust_interval, &EvolutionApplication::CheckAdjust, this);
+    //成员用心跳包向父节点报告位置，成为成员后开始发送，离开车群后SendHello自己停止
+    StartHelloIfMember();
+    if(!isLeader()){
+        return;
+    }
+
+    Vector pos = GetLocation();
+    AdjustInformation ai = AdjustInformation();
+    ai.task_id = m_task_id;
+    ai.pos = pos;
+    ai.start = Now().GetNanoSeconds();
+
+    //分裂：距离过远的子节点带着子树成为新的车群，只使用最近由心跳包更新过的位置
+    std::vector<NeighborInformation> far;
+    for(vector<NeighborInformation>::iterator iter=m_next.begin();iter!=m_next.end();iter++){
+        if(Now() - iter->last_beacon < GetTimeLimit() && CalculateDistance(PredictPosition(*iter), pos) > m_split_distance){
+            far.push_back(*iter);
+        }
+    }
+    ai.op = ADJUST_SPLIT;
+    ai.reason = ADJUST_REASON_SPLIT;
+    for(size_t i = 0; i < far.size(); i++){
+        SendAdjustMessage(ai, far[i].mac);
+        RemoveChild(far[i].mac);
+        //分裂出去的车群成为邻近车群
+        NeighborInformation ni = far[i];
+        ni.last_beacon = Now();
+        m_neighbor_leaders.push_back(ni);
+        m_router[ni.mac] = ni.mac;
+        EVENT_LOG_INFO(EVENT_SPLIT, GetNode()->GetId(), EventLog::AddressToArg(ni.mac), 1);
+    }
+
+    //合并：向邻近leader通告自己，由较大的车群决定是否吸收
+    ai.op = ADJUST_PROBE;
+    ai.reason = ADJUST_REASON_MERGE;
+    ai.group_size = std::min<uint32_t>(GetGroupSize(), 0xffff);
+    for(vector<NeighborInformation>::iterator iter=m_neighbor_leaders.begin();iter!=m_neighbor_leaders.end();iter++){
+        SendAdjustMessage(ai, iter->mac);
+    }
+}
+
+void EvolutionApplication::HandleAdjustMessage(const AdjustInformation& ai, const Address &sender){
+    switch(ai.op){
+        case ADJUST_PROBE:{
+            if(!isLeader() || ai.task_id != m_task_id || CalculateDistance(ai.pos, GetLocation()) > m_merge_distance){
+                return;
+            }
+            //已经接入本车群，GRAFT_ACCEPT还在路上
+            std::map<Address,Address>::iterator route = m_router.find(sender);
+            if(route != m_router.end() && IsChild(route->second)){
+                return;
+            }
+            //较大的车群吸收较小的车群，大小相同时mac较小的一方吸收，两个leader的判断结果一致
+            uint32_t size = GetGroupSize();
+            if(size < ai.group_size || (size == ai.group_size && sender < GetAddress())){
+                return;
+            }
+            for(vector<NeighborInformation>::iterator iter=m_neighbor_leaders.begin();iter!=m_neighbor_leaders.end();iter++){
+                if(iter->mac == sender){
+                    m_neighbor_leaders.erase(iter);
+                    break;
+                }
+            }
+            AdjustInformation graft = ai;
+            graft.op = ADJUST_GRAFT;
+            NeighborInformation candidate;
+            candidate.mac = sender;
+            candidate.pos = ai.pos;
+            candidate.last_beacon = Now();
+            graft.candidate = ToNeighborRecord(candidate);
+            GraftOrForward(graft);
+            break;
+        }
+        case ADJUST_GRAFT:
+            if(sender == m_parent.mac){
+                GraftOrForward(ai);
+            }
+            break;
+        case ADJUST_GRAFT_ACCEPT:{
+            //已经并入其它车群，让接入点删除自己
+            if(!isLeader()){
+                AdjustInformation leave = ai;
+                leave.op = ADJUST_LEAVE;
+                SendAdjustMessage(leave, sender);
+                return;
+            }
+            m_state = MEMBER_STATE;
+            m_level = ai.level;
+            m_leader = FromNeighborRecord(ai.leader);
+            m_parent.mac = sender;
+            m_parent.pos = ai.pos;
+            m_parent.last_beacon = Now();
+            ClearNeighborLeaders();
+            AnnounceSubtree();
+            LatencyStats::Get()->RecordFlow("merge_graft", Now() - NanoSeconds(ai.start));
+            EVENT_LOG_INFO(EVENT_MERGED, GetNode()->GetId(), m_level, EventLog::AddressToArg(m_parent.mac), EventLog::AddressToArg(m_leader.mac));
+            RelevelChildren(ai);
+            break;
+        }
+        case ADJUST_RELEVEL:
+            if(sender != m_parent.mac){
+                return;
+            }
+            m_level = ai.level;
+            m_leader = FromNeighborRecord(ai.leader);
+            if(ai.reason == ADJUST_REASON_FAILOVER){
+                LatencyStats::Get()->RecordFlow("failover_relevel", Now() - NanoSeconds(ai.start));
+            }
+            else{
+                LatencyStats::Get()->RecordFlow(ai.reason == ADJUST_REASON_SPLIT ? "split_relevel" : "merge_relevel", Now() - NanoSeconds(ai.start));
+            }
+            RelevelChildren(ai);
+            break;
+        case ADJUST_DETACH:
+            if(sender == m_parent.mac){
+                Detach(ai);
+            }
+            break;
+        case ADJUST_LEAVE:
+            RemoveChild(sender);
+            break;
+        case ADJUST_SPLIT:{
+            if(sender != m_parent.mac){
+                return;
+            }
+            m_state = LEADER_STATE;
+            m_level = 1;
+            m_leader.mac = GetAddress();
+            m_leader.pos = GetLocation();
+            m_leader.last_beacon = Now();
+            m_parent.mac = Address();
+            //成为leader后不再向上通告路由
+            m_pending_routes.clear();
+            Simulator::Cancel(m_route_update_event);
+            //原来的车群成为邻近车群
+            NeighborInformation ni;
+            ni.mac = sender;
+            ni.pos = ai.pos;
+            ni.last_beacon = Now();
+            m_neighbor_leaders.push_back(ni);
+            m_router[sender] = sender;
+            LatencyStats::Get()->RecordFlow("split", Now() - NanoSeconds(ai.start));
+            EVENT_LOG_INFO(EVENT_SPLIT, GetNode()->GetId(), EventLog::AddressToArg(sender), 0);
+            RelevelChildren(ai);
+            break;
+        }
+        default:
+            NS_LOG_ERROR("unknown adjust op");
+            break;
+    }
+}
+
+void EvolutionApplication::GraftOrForward(const AdjustInformation& ai){
+    NeighborInformation candidate = FromNeighborRecord(ai.candidate);
+    if(candidate.mac == GetAddress() || IsChild(candidate.mac)){
+        return;
+    }
+    if(m_next.size() < m_max_subnodes && m_level < m_max_level){
+        m_next.push_back(candidate);
+        AddChildRoute(candidate.mac);
+        AdjustInformation accept = ai;
+        accept.op = ADJUST_GRAFT_ACCEPT;
+        accept.level = m_level + 1;
+        accept.pos = GetLocation();
+        if(isLeader()){
+            NeighborInformation leader;
+            leader.mac = GetAddress();
+            leader.pos = accept.pos;
+            leader.last_beacon = Now();
+            accept.leader = ToNeighborRecord(leader);
+        }
+        else{
+            accept.leader = ToNeighborRecord(m_leader);
+        }
+        SendAdjustMessage(accept, candidate.mac);
+        return;
+    }
+    //没有空位，交给离candidate最近的子节点；叶子节点也没有空位时放弃，candidate在下一次PROBE时重试
+    vector<NeighborInformation>::iterator closest = m_next.end();
+    double closest_distance = 0;
+    for(vector<NeighborInformation>::iterator iter=m_next.begin();iter!=m_next.end();iter++){
+        double distance = CalculateDistance(PredictPosition(*iter), candidate.pos);
+        if(closest == m_next.end() || distance < closest_distance){
+            closest = iter;
+            closest_distance = distance;
+        }
+    }
+    if(closest != m_next.end() && m_level + 1 < m_max_level){
+        SendAdjustMessage(ai, closest->mac);
+    }
+}
+
+void EvolutionApplication::RelevelChildren(const AdjustInformation& ai){
+    AdjustInformation relevel = ai;
+    relevel.level = m_level + 1;
+    relevel.leader = ToNeighborRecord(m_leader);
+    relevel.pos = GetLocation();
+    std::vector<Address> children;
+    for(vector<NeighborInformation>::iterator iter=m_next.begin();iter!=m_next.end();iter++){
+        children.push_back(iter->mac);
+    }
+    for(size_t i = 0; i < children.size(); i++){
+        if(relevel.level > m_max_level){
+            relevel.op = ADJUST_DETACH;
+            SendAdjustMessage(relevel, children[i]);
+            RemoveChild(children[i]);
+        }
+        else{
+            relevel.op = ADJUST_RELEVEL;
+            SendAdjustMessage(relevel, children[i]);
+        }
+    }
+}
+
+void EvolutionApplication::Detach(const AdjustInformation& ai){
+    AdjustInformation detach = ai;
+    detach.op = ADJUST_DETACH;
+    for(vector<NeighborInformation>::iterator iter=m_next.begin();iter!=m_next.end();iter++){
+        SendAdjustMessage(detach, iter->mac);
+    }
+    m_next.clear();
+    m_router.clear();
+    m_neighbor_leaders.clear();
+    m_pending_routes.clear();
+    Simulator::Cancel(m_route_update_event);
+    Simulator::Cancel(m_construct_event);
+    Simulator::Cancel(m_wait_construct_event);
+    m_parent.mac = Address();
+    m_leader.mac = Address();
+    EVENT_LOG_INFO(EVENT_DETACHED, GetNode()->GetId(), m_level);
+    //按原来的任务重新加入附近的车群
+    AssignTask(m_task_id);
+}
+
+void EvolutionApplication::ClearNeighborLeaders(){
+    for(vector<NeighborInformation>::iterator iter=m_neighbor_leaders.begin();iter!=m_neighbor_leaders.end();iter++){
+        std::map<Address,Address>::iterator route = m_router.find(iter->mac);
+        if(route != m_router.end() && !IsChild(route->second)){
+            m_router.erase(route);
+        }
+    }
+    m_neighbor_leaders.clear();
+}
+
+void EvolutionApplication::StartHelloIfMember(){
+    if(isMember() && !m_hello_event.IsRunning()){
+        //给父节点一个心跳周期的时间回复
+        m_parent.last_beacon = Now();
+        SendHello();
+    }
+}
+
+uint64_t EvolutionApplication::GetHelloSentCount(){
+    return m_hello_sent;
+}
+
+uint64_t EvolutionApplication::GetHelloReplyCount(){
+    return m_hello_replies;
+}
+
+DccController& EvolutionApplication::GetDccController(){
+    return m_dcc;
+}
+
+void EvolutionApplication::ConnectChannelBusy(){
+    //信标所在信道的设备，双射频时可能是服务信道上的设备
+    Ptr<NetDevice> dev = m_sch_device && MessageChannel(HELLO) == MESSAGE_CHANNEL_SCH ? m_sch_device : m_device;
+    Ptr<WifiPhy> phy;
+    if (m_wave_device) {
+        phy = m_wave_device->GetPhy(0);
+    } else if (Ptr<WifiNetDevice> wifi = DynamicCast<WifiNetDevice>(dev)) {
+        phy = wifi->GetPhy();
+    }
+    if (phy) {
+        PointerValue state;
+        phy->GetAttribute("State", state);
+        state.Get<WifiPhyStateHelper>()->TraceConnectWithoutContext("State", MakeCallback(&EvolutionApplication::RecordPhyState, this));
+    }
+    Ptr<AbstractNetDevice> abstract = DynamicCast<AbstractNetDevice>(m_device);
+    m_dcc_last_busy = abstract ? abstract->GetBusyTime() : m_phy_busy_time;
+    m_dcc_last_sample = Now();
+}
+
+void EvolutionApplication::RecordPhyState(Time start, Time duration, WifiPhyState state){
+    if (state == WifiPhyState::CCA_BUSY || state == WifiPhyState::TX || state == WifiPhyState::RX) {
+        m_phy_busy_time += duration;
+    }
+}
+
+void EvolutionApplication::SampleChannelBusy(){
+    PROFILE_SCOPE("EvolutionApplication::SampleChannelBusy");
+    m_dcc_event = Simulator::Schedule(Seconds(DCC_SAMPLE_INTERVAL), &EvolutionApplication::SampleChannelBusy, this);
+    Time busy = m_phy_busy_time;
+    Ptr<AbstractNetDevice> abstract = DynamicCast<AbstractNetDevice>(m_device);
+    if (abstract) {
+        busy = abstract->GetBusyTime();
+    }
+    bool changed = m_dcc.Sample(busy - m_dcc_last_busy, Now() - m_dcc_last_sample);
+    m_dcc_last_busy = busy;
+    m_dcc_last_sample = Now();
+    if (changed) {
+        EVENT_LOG_INFO(EVENT_DCC_STATE, GetNode()->GetId(), m_dcc.GetState(), (uint64_t)(m_dcc.GetChannelBusyRatio() * 1000),
+                       GetHelloInterval().GetMilliSeconds(), GetConstructInterval().GetMilliSeconds());
+    }
+}
+
+Time EvolutionApplication::GetHelloInterval(){
+    return m_dcc_enabled ? Seconds(m_hello_interval.GetSeconds() * m_dcc.GetIntervalScale()) : m_hello_interval;
+}
+
+Time EvolutionApplication::GetConstructInterval(){
+    return m_dcc_enabled ? Seconds(m_construct_interval.GetSeconds() * m_dcc.GetIntervalScale()) : m_construct_interval;
+}
+
+Time EvolutionApplication::GetTimeLimit(){
+    //航位推算时心跳包最多m_dr_max_interval才发送一次，至少容忍丢失一个
+    Time limit = m_dead_reckoning ? Max(m_time_limit, Seconds(m_dr_max_interval.GetSeconds() * 2)) : m_time_limit;
+    return m_dcc_enabled ? Seconds(limit.GetSeconds() * m_dcc.GetIntervalScale()) : limit;
+}
+
+Time EvolutionApplication::GetDeadReckoningInterval(){
+    return m_dcc_enabled ? Seconds(DR_CHECK_INTERVAL * m_dcc.GetIntervalScale()) : Seconds(DR_CHECK_INTERVAL);
+}
+
+Vector EvolutionApplication::PredictPosition(const NeighborInformation& ni){
+    Time elapsed = Min(Now() - ni.last_beacon, GetTimeLimit());
+    return ExtrapolatePosition(ni.pos, ni.velocity, ni.acceleration, elapsed.GetSeconds());
+}
+
+DeadReckoning& EvolutionApplication::GetDeadReckoning(){
+    return m_dr;
+}
+
+uint64_t EvolutionApplication::GetFailoverMessageCount(){
+    return m_failover_messages;
+}
+
+void EvolutionApplication::SendTransferMessage(const TransferInformation& ti, const vector<Address>& children,
+                                               const vector<Address>& neighbor_leaders, const Address &addr){
+    TransferInformation header = ti;
+    header.n_children = std::min<size_t>(children.size(), 0xff);
+    header.n_neighbor_leaders = std::min<size_t>(neighbor_leaders.size(), 0xff);
+    //周期性的同步消息，复用mac列表的缓冲区
+    m_tx_macs.resize(header.n_children + header.n_neighbor_leaders);
+    for(size_t i = 0; i < header.n_children; i++){
+        AddressToMac(children[i], m_tx_macs[i].mac);
+    }
+    for(size_t i = 0; i < header.n_neighbor_leaders; i++){
+        AddressToMac(neighbor_leaders[i], m_tx_macs[header.n_children + i].mac);
+    }
+
+    //备用leader消息消息头
+    MessageHeader tag = MakeTag(addr);
+    Ptr<Packet> packet = MakeMessage(tag, header, m_tx_macs.empty() ? NULL : &m_tx_macs[0], m_tx_macs.size(), &m_group_pool);
+
+    m_failover_messages++;
+    SendToDevice (packet, addr);
+}
+
+void EvolutionApplication::HandleTransferMessage(const uint8_t* buffer, uint32_t size, const Address &sender){
+    TransferInformation ti = TransferInformation();
+    if(!ReadMessage(buffer, size, ti) || MessageItemCount<TransferInformation>(size) < ti.n_children + ti.n_neighbor_leaders){
+        NS_LOG_ERROR("TRANSFER_MESSAGE长度错误");
+        return;
+    }
+    Address old_leader = MacToAddress(ti.old_leader);
+
+    switch(ti.op){
+        case TRANSFER_SYNC:{
+            if(sender != m_parent.mac || !isMember()){
+                return;
+            }
+            m_standby_children.clear();
+            m_standby_neighbor_leaders.clear();
+            for(uint32_t i = 0; i < ti.n_children; i++){
+                m_standby_children.push_back(MacToAddress(ReadMessageItem<TransferInformation>(buffer, i).mac));
+            }
+            for(uint32_t i = 0; i < ti.n_neighbor_leaders; i++){
+                m_standby_neighbor_leaders.push_back(MacToAddress(ReadMessageItem<TransferInformation>(buffer, ti.n_children + i).mac));
+            }
+            m_standby_leader = sender;
+            m_standby_sync_time = Now();
+            break;
+        }
+        case TRANSFER_TAKEOVER:{
+            //已经不在原leader下面（例如另一个备用leader先接替），让发送者删除自己
+            if(!isMember() || m_parent.mac != old_leader){
+                AdjustInformation leave = AdjustInformation();
+                leave.op = ADJUST_LEAVE;
+                leave.reason = ADJUST_REASON_FAILOVER;
+                SendAdjustMessage(leave, sender);
+                return;
+            }
+            m_router.erase(old_leader);
+            m_standby_sync_time = Seconds(-1);
+            AdjustInformation ai = AdjustInformation();
+            ai.reason = ADJUST_REASON_FAILOVER;
+            ai.start = ti.start;
+            ai.task_id = m_task_id;
+            if(ti.role == TRANSFER_ROLE_MEMBER){
+                m_parent.mac = sender;
+                m_parent.last_beacon = Now();
+                m_leader.mac = sender;
+                m_leader.last_beacon = Now();
+                m_level = 2;
+                AnnounceSubtree();
+            }
+            else{
+                m_state = LEADER_STATE;
+                m_level = 1;
+                m_leader.mac = GetAddress();
+                m_leader.pos = GetLocation();
+                m_leader.last_beacon = Now();
+                m_parent.mac = Address();
+                m_pending_routes.clear();
+                Simulator::Cancel(m_route_update_event);
+                NeighborInformation ni;
+                ni.mac = sender;
+                ni.last_beacon = Now();
+                m_neighbor_leaders.push_back(ni);
+                m_router[sender] = sender;
+            }
+            LatencyStats::Get()->RecordFlow("failover_reparent", Now() - NanoSeconds(ti.start));
+            //子树的级数不变，只更新leader
+            RelevelChildren(ai);
+            break;
+        }
+        case TRANSFER_ANNOUNCE:
+            if(!isLeader()){
+                return;
+            }
+            for(vector<NeighborInformation>::iterator iter=m_neighbor_leaders.begin();iter!=m_neighbor_leaders.end();iter++){
+                if(iter->mac == old_leader){
+                    iter->mac = sender;
+                    iter->last_beacon = Now();
+                    std::map<Address,Address>::iterator route = m_router.find(old_leader);
+                    if(route != m_router.end() && !IsChild(route->second)){
+                        m_router.erase(route);
+                    }
+                    m_router[sender] = sender;
+                    break;
+                }
+            }
+            break;
+        default:
+            NS_LOG_ERROR("unknown transfer op");
+            break;
+    }
+}
+
+bool EvolutionApplication::SendGroupCommand(uint8_t type, const uint8_t* payload, uint32_t size){
+    PROFILE_SCOPE("EvolutionApplication::SendGroupCommand");
+    if(!isLeader()){
+        NS_LOG_ERROR("只有Leader可以向车群发送命令");
+        return false;
+    }
+    if(m_next.empty()){
+        return false;
+    }
+    //同一个命令还在确认中时不重复发送，例如多个成员报告同一个障碍物
+    for(std::map<GroupCommandKey, GroupCommandState>::iterator iter = m_group_commands.begin();
+        iter != m_group_commands.end(); iter++){
+        GroupCommandState& state = iter->second;
+        if(iter->first.first == GetAddress() && !state.acked && state.type == type
+           && state.payload.size() == sizeof(GroupCommandInformation) + size
+           && (size == 0 || memcmp(&state.payload[sizeof(GroupCommandInformation)], payload, size) == 0)){
+            return false;
+        }
+    }
+
+    GroupCommandInformation gci = GroupCommandInformation();
+    gci.deadline = (Now() + m_group_command_deadline).GetNanoSeconds();
+    gci.seq = m_next_group_seq++;
+    AddressToMac(GetAddress(), gci.origin);
+    GroupCommandKey key(GetAddress(), gci.seq);
+
+    GroupCommandState& state = m_group_commands[key];
+    state.type = type;
+    state.payload.resize(sizeof(gci) + size);
+    memcpy(&state.payload[0], &gci, sizeof(gci));
+    if(size > 0){
+        memcpy(&state.payload[sizeof(gci)], payload, size);
+    }
+    state.parent = GetAddress();
+    state.timestamp = Now();
+    state.hops = 0;
+    state.deadline = NanoSeconds(gci.deadline);
+    state.ack_deadline = state.deadline;
+    state.confirmed = 0;//leader自己不计入
+    state.retries = 0;
+    state.acked = false;
+    for(vector<NeighborInformation>::iterator iter = m_next.begin(); iter != m_next.end(); iter++){
+        state.waiting.push_back(iter->mac);
+        ForwardGroupCommand(state, iter->mac);
+    }
+    m_group_commands_sent++;
+    EVENT_LOG_INFO(EVENT_GROUP_COMMAND_SENT, GetNode()->GetId(), gci.seq, type, state.waiting.size());
+
+    state.ack_event = Simulator::Schedule(state.ack_deadline - Now(), &EvolutionApplication::FinishGroupCommand, this, key);
+    ScheduleGroupRetransmit(key, state);
+    return true;
+}
+
+void EvolutionApplication::HandleGroupCommandMessage(uint8_t type, const uint8_t* buffer, uint32_t size, const Address &sender,
+                                                     Time timestamp, uint8_t hops){
+    GroupCommandInformation gci = GroupCommandInformation();
+    if(!ReadRecord(buffer, size, 0, gci)){
+        NS_LOG_ERROR("车群命令长度错误");
+        return;
+    }
+    GroupCommandKey key(MacToAddress(gci.origin), gci.seq);
+    std::map<GroupCommandKey, GroupCommandState>::iterator found = m_group_commands.find(key);
+    if(found != m_group_commands.end()){
+        //重传的命令：已经确认过说明确认丢了，再发一次；还在等待子节点时忽略
+        if(found->second.acked){
+            SendGroupAck(key, found->second);
+        }
+        return;
+    }
+
+    ExecuteGroupCommand(type, buffer + sizeof(gci), size - sizeof(gci), sender);
+
+    GroupCommandState& state = m_group_commands[key];
+    state.type = type;
+    state.payload.assign(buffer, buffer + size);
+    state.parent = sender;
+    state.timestamp = timestamp;
+    state.hops = hops;
+    state.deadline = NanoSeconds(gci.deadline);
+    //越深的节点越早确认，给确认消息逐级向上留出时间
+    state.ack_deadline = state.deadline - m_group_ack_slack * (m_level > 1 ? m_level - 1 : 1);
+    if(state.ack_deadline < Now()){
+        state.ack_deadline = Now();
+    }
+    state.confirmed = 1;
+    state.retries = 0;
+    state.acked = false;
+    for(vector<NeighborInformation>::iterator iter = m_next.begin(); iter != m_next.end(); iter++){
+        state.waiting.push_back(iter->mac);
+        ForwardGroupCommand(state, iter->mac);
+    }
+    if(state.waiting.empty()){
+        FinishGroupCommand(key);
+        return;
+    }
+    state.ack_event = Simulator::Schedule(state.ack_deadline - Now(), &EvolutionApplication::FinishGroupCommand, this, key);
+    ScheduleGroupRetransmit(key, state);
+}
+
+void EvolutionApplication::HandleGroupAckMessage(const uint8_t* buffer, uint32_t size, const Address &sender){
+    GroupAckInformation gai = GroupAckInformation();
+    if(!ReadMessage(buffer, size, gai) || MessageItemCount<GroupAckInformation>(size) < gai.n_missing){
+        NS_LOG_ERROR("车群命令确认长度错误");
+        return;
+    }
+    GroupCommandKey key(MacToAddress(gai.origin), gai.seq);
+    std::map<GroupCommandKey, GroupCommandState>::iterator found = m_group_commands.find(key);
+    //已经向上确认后迟到的确认不再计入
+    if(found == m_group_commands.end() || found->second.acked){
+        return;
+    }
+    GroupCommandState& state = found->second;
+    std::vector<Address>::iterator child = std::find(state.waiting.begin(), state.waiting.end(), sender);
+    if(child == state.waiting.end()){
+        return;
+    }
+    state.waiting.erase(child);
+    state.confirmed += gai.confirmed;
+    for(uint16_t i = 0; i < gai.n_missing; i++){
+        state.missing.push_back(MacToAddress(ReadMessageItem<GroupAckInformation>(buffer, i).mac));
+    }
+    if(state.waiting.empty()){
+        FinishGroupCommand(key);
+    }
+}
+
+uint64_t EvolutionApplication::GetGroupCommandCount(){
+    return m_group_commands_sent;
+}
+
+uint64_t EvolutionApplication::GetGroupCommandIncompleteCount(){
+    return m_group_commands_incomplete;
+}
+
+uint64_t EvolutionApplication::GetGroupRetransmitCount(){
+    return m_group_retransmissions;
+}
+
+uint64_t EvolutionApplication::GetGroupAckCount(){
+    return m_group_acks;
+}
+
+void EvolutionApplication::ForwardGroupCommand(const GroupCommandState& state, const Address &child){
+    //时间戳和跳数沿用leader发出时的值，统计的是端到端时延
+    MessageHeader tag;
+    tag.SetType(state.type | GROUP_MESSAGE);
+    tag.SetTimestamp(state.timestamp);
+    tag.SetHopCount(state.hops);
+    tag.SetPayloadSize(state.payload.size());
+    tag.SetDesAddr(child);
+    tag.SetSrcAddr(m_device->GetAddress());
+    Ptr<Packet> packet = m_group_pool.Get(tag, &state.payload[0], state.payload.size());
+    EVENT_LOG_DEBUG(EVENT_GROUP_FORWARD, GetNode()->GetId(), EventLog::AddressToArg(child), tag.GetType());
+    SendToDevice (packet, child);
+}
+
+void EvolutionApplication::ScheduleGroupRetransmit(const GroupCommandKey& key, GroupCommandState& state){
+    //重传后还要留出子节点回复的时间
+    if(state.retries >= m_group_max_retries || Now() + m_group_retransmit_interval >= state.ack_deadline){
+        return;
+    }
+    state.retransmit_event = Simulator::Schedule(m_group_retransmit_interval, &EvolutionApplication::RetransmitGroupCommand, this, key);
+}
+
+void EvolutionApplication::RetransmitGroupCommand(GroupCommandKey key){
+    PROFILE_SCOPE("EvolutionApplication::RetransmitGroupCommand");
+    std::map<GroupCommandKey, GroupCommandState>::iterator found = m_group_commands.find(key);
+    if(found == m_group_commands.end() || found->second.acked){
+        return;
+    }
+    GroupCommandState& state = found->second;
+    state.retries++;
+    //只重传给没有确认的子节点，已经离开的子节点在确认时计为未收到
+    for(std::vector<Address>::iterator iter = state.waiting.begin(); iter != state.waiting.end(); iter++){
+        if(IsChild(*iter)){
+            ForwardGroupCommand(state, *iter);
+            m_group_retransmissions++;
+        }
+    }
+    ScheduleGroupRetransmit(key, state);
+}
+
+void EvolutionApplication::FinishGroupCommand(GroupCommandKey key){
+    PROFILE_SCOPE("EvolutionApplication::FinishGroupCommand");
+    std::map<GroupCommandKey, GroupCommandState>::iterator found = m_group_commands.find(key);
+    if(found == m_group_commands.end() || found->second.acked){
+        return;
+    }
+    GroupCommandState& state = found->second;
+    Simulator::Cancel(state.retransmit_event);
+    Simulator::Cancel(state.ack_event);
+    //没有确认的子节点和经过它的整个子树都计为未收到
+    for(std::vector<Address>::iterator child = state.waiting.begin(); child != state.waiting.end(); child++){
+        state.missing.push_back(*child);
+        for(std::map<Address,Address>::iterator route = m_router.begin(); route != m_router.end(); route++){
+            if(route->second == *child && route->first != *child){
+                state.missing.push_back(route->first);
+            }
+        }
+    }
+    state.waiting.clear();
+    state.acked = true;
+
+    if(key.first == GetAddress()){
+        LatencyStats::Get()->RecordFlow(state.missing.empty() ? "group_command_confirmed" : "group_command_partial",
+                                        Now() - state.timestamp);
+        if(!state.missing.empty()){
+            m_group_commands_incomplete++;
+        }
+        EVENT_LOG_INFO(EVENT_GROUP_COMMAND_DONE, GetNode()->GetId(), key.second, state.confirmed, state.missing.size());
+    }
+    else{
+        SendGroupAck(key, state);
+    }
+    //保留到leader的截止时间之后，用于回复重传的命令
+    Time keep = state.deadline - Now() + m_group_command_deadline;
+    Simulator::Schedule(keep.IsPositive() ? keep : m_group_command_deadline, &EvolutionApplication::ExpireGroupCommand, this, key);
+}
+
+void EvolutionApplication::SendGroupAck(const GroupCommandKey& key, const GroupCommandState& state){
+    size_t n_missing = std::min<size_t>(state.missing.size(), 0xffff);
+    GroupAckInformation gai = GroupAckInformation();
+    gai.seq = key.second;
+    AddressToMac(key.first, gai.origin);
+    gai.confirmed = state.confirmed;
+    gai.n_missing = n_missing;
+    m_tx_macs.resize(n_missing);
+    for(size_t i = 0; i < n_missing; i++){
+        AddressToMac(state.missing[i], m_tx_macs[i].mac);
+    }
+
+    //车群命令确认消息消息头
+    MessageHeader tag = MakeTag(state.parent);
+    Ptr<Packet> packet = MakeMessage(tag, gai, n_missing > 0 ? &m_tx_macs[0] : NULL, n_missing, &m_group_pool);
+
+    m_group_acks++;
+    EVENT_LOG_DEBUG(EVENT_GROUP_ACK_SENT, GetNode()->GetId(), EventLog::AddressToArg(state.parent), key.second,
+                    state.confirmed, n_missing);
+    SendToDevice (packet, state.parent);
+}
+
+void EvolutionApplication::HandleObstacleMessage(const ObstacleInformation& oi, const Address &sender){
+    // 如果是leader接到，则可靠地发给整个车群
+    // 如果是普通节点，则执行避障命令
+    if (isLeader()) {
+        HazardStats::Get()->RecordWarned(oi.hazard, GetNode()->GetId());
+        if (SendGroupCommand(oi)) {
+            EVENT_LOG_INFO(EVENT_OBSTACLE_RELAY, GetNode()->GetId(), m_next.size());
+        }
+    } else {
+        AvoidHazard(oi.hazard, sender);
+    }
+}
+
+void EvolutionApplication::ExecuteGroupCommand(uint8_t type, const uint8_t* buffer, uint32_t size, const Address &sender){
+    switch(type){
+        case OBSTACLE_MESSAGE:{
+            ObstacleInformation oi = ObstacleInformation();
+            if(Decode(buffer, size, oi)){
+                AvoidHazard(oi.hazard, sender);
+            }
+            break;
+        }
+        default:
+            NS_LOG_ERROR("unknown group command type");
+            break;
+    }
+}
+
+void EvolutionApplication::ExpireGroupCommand(GroupCommandKey key){
+    PROFILE_SCOPE("EvolutionApplication::ExpireGroupCommand");
+    m_group_commands.erase(key);
+}
+
+void EvolutionApplication::AvoidHazard(const Vector& hazard, const Address &sender){
+    // 模拟执行避障动作
+    EVENT_LOG_INFO(EVENT_OBSTACLE_AVOID, GetNode()->GetId(), EventLog::AddressToArg(sender));
+    HazardStats::Get()->RecordWarned(hazard, GetNode()->GetId());
+}
+
+void EvolutionApplication::RecordHazardTransmission(Ptr<const Packet> packet, MessageHeader& tag){
+    //地理广播和单播的避障消息以危险位置开头（ObstacleInformation），组播的避障命令前面还有GroupCommandInformation
+    uint32_t offset = (tag.GetType() & GROUP_MESSAGE) ? sizeof(GroupCommandInformation) : 0;
+    uint8_t buffer[sizeof(GroupCommandInformation) + sizeof(ObstacleInformation)];
+    uint32_t size = packet->CopyData(buffer, std::min<uint32_t>(tag.GetPayloadSize(), sizeof(buffer)));
+    ObstacleInformation oi = ObstacleInformation();
+    if(ReadRecord(buffer, size, offset, oi)){
+        HazardStats::Get()->RecordTransmission(oi.hazard);
+    }
+}
+
+void EvolutionApplication::StartGeocast(const Vector& hazard){
+    HazardKey key = MakeHazardKey(hazard);
+    if(m_geocasts.find(key) != m_geocasts.end()){
+        return;//已经收到过别的车辆发出的警告
+    }
+    GeocastState& state = m_geocasts[key];
+    state.hazard = hazard;
+    state.radius = m_geocast_radius;
+    state.timestamp = Now();
+    state.hops = 0;
+    state.forwarders.push_back(GetLocation());
+    state.expire_event = Simulator::Schedule(Seconds(GEOCAST_LIFETIME), &EvolutionApplication::ExpireGeocast, this, key);
+    SendGeocast(state);
+}
+
+void EvolutionApplication::SendGeocast(const GeocastState& state){
+    GeocastInformation gi = GeocastInformation();
+    gi.hazard = state.hazard;
+    gi.forwarder = GetLocation();
+    gi.radius = state.radius;
+
+    //时间戳为发现危险的时间，转发时不变
+    MessageHeader tag = MakeTag(Mac48Address::GetBroadcast());
+    tag.SetTimestamp(state.timestamp);
+    tag.SetHopCount(state.hops);
+    Ptr<Packet> packet = MakeMessage(tag, gi, &m_obstacle_pool);
+
+    m_geocast_sent++;
+    BroadcastInformation(packet);
+}
+
+void EvolutionApplication::HandleGeocastMessage(const GeocastInformation& gi, Time timestamp, uint8_t hops, const Address &sender){
+    UpdateNeighbor(sender, gi.forwarder);
+    HazardKey key = MakeHazardKey(gi.hazard);
+    std::map<HazardKey, GeocastState>::iterator found = m_geocasts.find(key);
+    if(found != m_geocasts.end()){
+        //重复收到：记下这个发送者的位置，等待转发时据此判断自己的广播还能不能覆盖新的车辆
+        found->second.forwarders.push_back(gi.forwarder);
+        return;
+    }
+
+    GeocastState& state = m_geocasts[key];
+    state.hazard = gi.hazard;
+    state.radius = gi.radius;
+    state.timestamp = timestamp;
+    state.hops = hops;
+    state.forwarders.push_back(gi.forwarder);
+    state.expire_event = Simulator::Schedule(Seconds(GEOCAST_LIFETIME), &EvolutionApplication::ExpireGeocast, this, key);
+
+    //目标区域外的车辆不需要避障，也不转发
+    Vector pos = GetLocation();
+    if(CalculateDistance(pos, gi.hazard) > gi.radius){
+        return;
+    }
+    AvoidHazard(gi.hazard, sender);
+    if(hops >= GEOCAST_MAX_HOPS){
+        return;
+    }
+    //基于竞争的转发：离上一个发送者越远等待越短，最远的车辆最先转发，其它车辆听到后可能取消
+    double distance = std::min(CalculateDistance(pos, gi.forwarder), GEOCAST_MAX_DISTANCE);
+    Time timeout = Seconds(GEOCAST_MAX_TIMEOUT - (GEOCAST_MAX_TIMEOUT - GEOCAST_MIN_TIMEOUT) * distance / GEOCAST_MAX_DISTANCE);
+    state.forward_event = Simulator::Schedule(timeout, &EvolutionApplication::ForwardGeocast, this, key);
+}
+
+void EvolutionApplication::ForwardGeocast(HazardKey key){
+    PROFILE_SCOPE("EvolutionApplication::ForwardGeocast");
+    std::map<HazardKey, GeocastState>::iterator found = m_geocasts.find(key);
+    if(found == m_geocasts.end()){
+        return;
+    }
+    if(!GeocastReachesUncovered(found->second)){
+        m_geocast_suppressed++;
+        return;
+    }
+    SendGeocast(found->second);
+}
+
+bool EvolutionApplication::GeocastReachesUncovered(const GeocastState& state){
+    //等待期间没有听到其它转发者，一定转发
+    if(state.forwarders.size() <= 1){
+        return true;
+    }
+    //已知位置的邻居中，还有在目标区域内但不在任何已听到的发送者通信范围内的，才需要转发
+    //邻居表包括听到过的所有带位置的发送者，车群树上的父节点、leader、子节点和邻近leader另外记录，也一并检查
+    //不知道任何邻居的位置时与一般的基于竞争的转发相同，听到其它转发者就取消
+    for(std::map<Address, NeighborInformation>::iterator iter = m_neighbors.begin(); iter != m_neighbors.end(); iter++){
+        if(GeocastNeighborUncovered(state, iter->second)){
+            return true;
+        }
+    }
+    for(vector<NeighborInformation>::iterator iter = m_next.begin(); iter != m_next.end(); iter++){
+        if(GeocastNeighborUncovered(state, *iter)){
+            return true;
+        }
+    }
+    for(vector<NeighborInformation>::iterator iter = m_neighbor_leaders.begin(); iter != m_neighbor_leaders.end(); iter++){
+        if(GeocastNeighborUncovered(state, *iter)){
+            return true;
+        }
+    }
+    return GeocastNeighborUncovered(state, m_parent) || GeocastNeighborUncovered(state, m_leader);
+}
+
+bool EvolutionApplication::GeocastNeighborUncovered(const GeocastState& state, const NeighborInformation& ni){
+    //没有这个邻居（如leader的父节点）、就是本节点或位置已过时的不算
+    if(ni.mac.IsInvalid() || ni.mac == GetAddress() || Now() - ni.last_beacon >= GetTimeLimit()){
+        return false;
+    }
+    Vector pos = PredictPosition(ni);
+    if(CalculateDistance(pos, state.hazard) > state.radius){
+        return false;
+    }
+    for(size_t i = 0; i < state.forwarders.size(); i++){
+        if(CalculateDistance(pos, state.forwarders[i]) <= GEOCAST_MAX_DISTANCE){
+            return false;
+        }
+    }
+    return true;
+}
+
+void EvolutionApplication::ExpireGeocast(HazardKey key){
+    PROFILE_SCOPE("EvolutionApplication::ExpireGeocast");
+    std::map<HazardKey, GeocastState>::iterator found = m_geocasts.find(key);
+    if(found != m_geocasts.end()){
+        Simulator::Cancel(found->second.forward_event);
+        m_geocasts.erase(found);
+    }
+}
+
+uint64_t EvolutionApplication::GetGeocastSentCount(){
+    return m_geocast_sent;
+}
+
+uint64_t EvolutionApplication::GetGeocastSuppressedCount(){
+    return m_geocast_suppressed;
+}
@@ -3,7 +3,15 @@
 #include "ns3/application.h"
 #include "ns3/wave-net-device.h"
 #include "ns3/wifi-phy.h"
+#include "ns3/wifi-phy-state.h"
 #include "ns3/vector.h"
+#include "ns3/event-id.h"
+#include "MemoryAccounting.h"
+#include "PacketPool.h"
+#include "MessageSchema.h"
+#include "DccController.h"
+#include "DeadReckoning.h"
+#include "HazardStats.h"
 #include <vector>
 #include <map>
 
@@ -14,11 +22,32 @@ typedef struct
 {
     Address mac;
     Time last_beacon;
-    Vector pos;
+    Vector pos;//last_beacon时的位置，当前位置用PredictPosition外推
+    Vector velocity;
+    Vector acceleration;
 } NeighborInformation;
 
+//线上的邻居信息，NeighborInformation中的Address和Time不能按字节复制
+typedef struct{
+    uint8_t mac[6];
+    uint8_t reserved[2];
+    int64_t last_beacon;//单位ns
+    Vector pos;
+    Vector velocity;
+    Vector acceleration;
+} NeighborRecord;
+
+static_assert(sizeof(NeighborRecord) == FieldsSize<NeighborRecord>(&NeighborRecord::mac, &NeighborRecord::reserved,
+              &NeighborRecord::last_beacon, &NeighborRecord::pos, &NeighborRecord::velocity, &NeighborRecord::acceleration),
+              "NeighborRecord中不能有填充字节");
+
+NeighborRecord ToNeighborRecord(const NeighborInformation& ni);
+NeighborInformation FromNeighborRecord(const NeighborRecord& record);
+
 typedef struct{
     Vector pos;
+    Vector velocity;
+    Vector acceleration;
 } HelloInformation;
 
 typedef struct{
@@ -28,6 +57,7 @@ typedef struct{
 typedef struct{
     Vector pos;
     uint32_t task_id;
+    uint32_t reserved;
 } ConstructInformation;
 
 typedef struct {
@@ -37,11 +67,174 @@ typedef struct {
 typedef struct{
     uint8_t accept;// 0为不接受，1为接受
     uint8_t level;//子结点的层数
-    NeighborInformation leader;
-    NeighborInformation parent;
+    uint8_t reserved[6];
+    NeighborRecord leader;
+    NeighborRecord parent;
     
 }ConstructConfirmInformation;
 
+//ROUTE_UPDATE_MESSAGE没有头部，载荷由若干个RouteDelta组成
+typedef struct{
+} RouteUpdateInformation;
+
+//增量路由更新中的一项
+typedef struct{
+    uint8_t op;//ROUTE_ADD或ROUTE_REMOVE
+    uint8_t mac[6];//目的节点的mac地址
+} RouteDelta;
+
+const uint8_t ROUTE_REMOVE = 0;
+const uint8_t ROUTE_ADD = 1;
+
+//车群合并与分裂，ADJUST_MESSAGE的载荷
+typedef struct{
+    uint32_t task_id;
+    uint16_t group_size;//PROBE：发送者车群的节点数
+    uint8_t op;//ADJUST_PROBE等
+    uint8_t reason;//ADJUST_REASON_MERGE或ADJUST_REASON_SPLIT，用于统计消息数
+    uint8_t level;//GRAFT_ACCEPT、RELEVEL：接收者的新级数
+    uint8_t reserved[7];
+    Vector pos;//PROBE：发送者的位置；GRAFT：要接入的leader的位置
+    int64_t start;//这次合并或分裂开始的时间(ns)，用于统计完成时间
+    NeighborRecord leader;//GRAFT_ACCEPT、RELEVEL：新的leader
+    NeighborRecord candidate;//GRAFT：要接入的车群的leader
+} AdjustInformation;
+
+const uint8_t ADJUST_PROBE = 0;//leader向邻近leader通告自己的任务、位置和车群大小
+const uint8_t ADJUST_GRAFT = 1;//沿吸收方的车群向下寻找有空位的接入点
+const uint8_t ADJUST_GRAFT_ACCEPT = 2;//接入点通知被吸收的leader成为它的子节点
+const uint8_t ADJUST_RELEVEL = 3;//父节点通知子节点新的级数和leader
+const uint8_t ADJUST_DETACH = 4;//超过最大级数，子树离开车群重新建立
+const uint8_t ADJUST_LEAVE = 5;//子节点通知父节点自己已经离开
+const uint8_t ADJUST_SPLIT = 6;//leader让距离过远的子节点带着子树成为新的车群
+const uint8_t ADJUST_OP_COUNT = 7;
+
+const uint8_t ADJUST_REASON_MERGE = 0;
+const uint8_t ADJUST_REASON_SPLIT = 1;
+const uint8_t ADJUST_REASON_FAILOVER = 2;
+
+//备用leader与leader切换，TRANSFER_MESSAGE的载荷，后面跟着n_children个子节点和n_neighbor_leaders个邻近leader的MacRecord
+typedef struct{
+    uint8_t op;//TRANSFER_SYNC等
+    uint8_t role;//TAKEOVER：TRANSFER_ROLE_MEMBER或TRANSFER_ROLE_LEADER
+    uint8_t n_children;//SYNC、TAKEOVER：leader的其它二级节点数，不含备用leader
+    uint8_t n_neighbor_leaders;//SYNC：邻近leader数
+    uint32_t task_id;
+    int64_t start;//TAKEOVER、ANNOUNCE：原leader最后一次心跳的时间(ns)，用于统计恢复时间
+    uint8_t old_leader[6];//TAKEOVER、ANNOUNCE：失联的leader
+    uint8_t reserved[2];
+} TransferInformation;
+
+const uint8_t TRANSFER_SYNC = 0;//leader把邻近leader和其它二级节点同步给备用leader
+const uint8_t TRANSFER_TAKEOVER = 1;//备用leader通知其它二级节点改为接到自己下面
+const uint8_t TRANSFER_ANNOUNCE = 2;//备用leader通知邻近leader自己接替了原leader
+
+const uint8_t TRANSFER_ROLE_MEMBER = 0;//成为备用leader的子节点
+const uint8_t TRANSFER_ROLE_LEADER = 1;//备用leader的子节点已满，成为新车群的leader
+
+//可靠的车群命令，组播消息（带GROUP_MESSAGE）的载荷以它开头，后面是命令本身的载荷
+typedef struct{
+    int64_t deadline;//leader需要知道哪些成员收到的时间(ns)
+    uint16_t seq;//leader分配的序号
+    uint8_t origin[6];//发出命令的leader
+} GroupCommandInformation;
+
+static_assert(sizeof(GroupCommandInformation) == FieldsSize<GroupCommandInformation>(&GroupCommandInformation::deadline,
+              &GroupCommandInformation::seq, &GroupCommandInformation::origin),
+              "GroupCommandInformation中不能有填充字节");
+
+//车群命令的汇总确认，RECEIVE_MESSAGE的载荷，每个节点只向父节点发一个，
+//后面跟着n_missing个发送者子树中没有确认的节点的MacRecord
+typedef struct{
+    uint16_t seq;
+    uint8_t origin[6];
+    uint16_t confirmed;//发送者子树中确认收到的节点数，包括发送者
+    uint16_t n_missing;
+} GroupAckInformation;
+
+//发出命令的leader和序号
+typedef std::pair<Address, uint16_t> GroupCommandKey;
+
+//一条车群命令在本节点的状态
+typedef struct{
+    uint8_t type;//命令的消息类型，不含GROUP_MESSAGE
+    std::vector<uint8_t> payload;//GroupCommandInformation加上命令的载荷，用于转发和重传
+    Address parent;//从这里收到命令，确认发给它；leader为自己
+    Time timestamp;//leader发出命令的时间
+    uint8_t hops;//leader到本节点的跳数
+    Time deadline;//leader的截止时间
+    Time ack_deadline;//本节点最晚在这个时间向父节点确认
+    std::vector<Address> waiting;//还没有确认的子节点
+    uint16_t confirmed;
+    std::vector<Address> missing;
+    uint8_t retries;
+    bool acked;//已经向父节点确认（leader：已经得到结果）
+    EventId retransmit_event;
+    EventId ack_event;
+} GroupCommandState;
+
+//地理广播的避障警告，GEOCAST_MESSAGE的载荷；消息头的时间戳为发现危险的时间，转发时不变
+typedef struct{
+    Vector hazard;//危险的位置，也是目标区域的圆心
+    Vector forwarder;//发送这一帧的车辆（发现者或转发者）的位置
+    double radius;//目标区域的半径 单位m
+} GeocastInformation;
+
+//避障消息OBSTACLE_MESSAGE的载荷，组播时在GroupCommandInformation之后
+typedef struct{
+    Vector hazard;//障碍物的位置
+} ObstacleInformation;
+
+//载荷结构与消息类型的绑定，长度为所列字段的长度之和，漏列字段或有填充字节时编译失败，见MessageSchema.h
+MESSAGE_SCHEMA(HelloInformation, HELLO,
+               FieldsSize<HelloInformation>(&HelloInformation::pos, &HelloInformation::velocity,
+                                            &HelloInformation::acceleration));
+MESSAGE_SCHEMA(HelloRInformation, HELLO_R, FieldsSize<HelloRInformation>());
+MESSAGE_SCHEMA(ConstructInformation, CONSTRUCT_MESSAGE,
+               FieldsSize<ConstructInformation>(&ConstructInformation::pos, &ConstructInformation::task_id,
+                                                &ConstructInformation::reserved));
+MESSAGE_SCHEMA(ConstructReplyInformation, CONSTRUCT_REPLY_MESSAGE,
+               FieldsSize<ConstructReplyInformation>(&ConstructReplyInformation::pos));
+MESSAGE_SCHEMA(ConstructConfirmInformation, CONSTRUCT_CONFIRM_MESSAGE,
+               FieldsSize<ConstructConfirmInformation>(&ConstructConfirmInformation::accept, &ConstructConfirmInformation::level,
+                                                       &ConstructConfirmInformation::reserved, &ConstructConfirmInformation::leader,
+                                                       &ConstructConfirmInformation::parent));
+MESSAGE_SCHEMA_ITEMS(RouteUpdateInformation, ROUTE_UPDATE_MESSAGE, FieldsSize<RouteUpdateInformation>(),
+                     RouteDelta, FieldsSize<RouteDelta>(&RouteDelta::op, &RouteDelta::mac));
+MESSAGE_SCHEMA(AdjustInformation, ADJUST_MESSAGE,
+               FieldsSize<AdjustInformation>(&AdjustInformation::task_id, &AdjustInformation::group_size,
+                                             &AdjustInformation::op, &AdjustInformation::reason, &AdjustInformation::level,
+                                             &AdjustInformation::reserved, &AdjustInformation::pos, &AdjustInformation::start,
+                                             &AdjustInformation::leader, &AdjustInformation::candidate));
+MESSAGE_SCHEMA_ITEMS(TransferInformation, TRANSFER_MESSAGE,
+                     FieldsSize<TransferInformation>(&TransferInformation::op, &TransferInformation::role,
+                                                     &TransferInformation::n_children, &TransferInformation::n_neighbor_leaders,
+                                                     &TransferInformation::task_id, &TransferInformation::start,
+                                                     &TransferInformation::old_leader, &TransferInformation::reserved),
+                     MacRecord, FieldsSize<MacRecord>(&MacRecord::mac));
+MESSAGE_SCHEMA_ITEMS(GroupAckInformation, RECEIVE_MESSAGE,
+                     FieldsSize<GroupAckInformation>(&GroupAckInformation::seq, &GroupAckInformation::origin,
+                                                     &GroupAckInformation::confirmed, &GroupAckInformation::n_missing),
+                     MacRecord, FieldsSize<MacRecord>(&MacRecord::mac));
+MESSAGE_SCHEMA(ObstacleInformation, OBSTACLE_MESSAGE, FieldsSize<ObstacleInformation>(&ObstacleInformation::hazard));
+MESSAGE_SCHEMA(GeocastInformation, GEOCAST_MESSAGE,
+               FieldsSize<GeocastInformation>(&GeocastInformation::hazard, &GeocastInformation::forwarder,
+                                              &GeocastInformation::radius));
+
+//统计避障消息的发送次数时，避障消息和地理广播都从载荷开头取出危险位置
+static_assert(offsetof(GeocastInformation, hazard) == offsetof(ObstacleInformation, hazard), "地理广播的载荷必须以危险位置开头");
+
+//一个危险的地理广播在本节点的状态，同一个危险只转发一次
+typedef struct{
+    Vector hazard;
+    double radius;
+    Time timestamp;//发现危险的时间
+    uint8_t hops;//从发现者到本节点的跳数
+    std::vector<Vector> forwarders;//听到过的发送者的位置，第一个为第一次收到时的发送者
+    EventId forward_event;
+    EventId expire_event;
+} GeocastState;
+
 typedef uint16_t NodeState;
 
 const double HELLO_INTERVAL = 0.5; //心跳包发送间隔 单位s
@@ -52,6 +245,22 @@ const double WAIT_CONSTRUCT_TIME = 5;//等待车群建立消息的时间
 const double CONSTRUCT_INTERVAL = 2;//发送车群建立消息的时间间隔
 const uint8_t MAX_LEVEL = 8;
 const uint8_t MAX_SUBNODES = 5;
+const double ROUTE_UPDATE_INTERVAL = 0.1;//合并增量路由更新的周期 单位s
+const uint32_t MAX_ROUTE_DELTAS = 128;//一个路由更新消息最多的项数
+const double ADJUST_INTERVAL = 1.0;//leader检查合并与分裂的周期 单位s
+const double MERGE_DISTANCE = 100;//相同任务的两个leader距离小于这个值时合并 单位m
+const double SPLIT_DISTANCE = 300;//子节点与leader距离大于这个值时分裂，需要大于MERGE_DISTANCE 单位m
+const double STANDBY_SWITCH_RATIO = 0.8;//新的候选比当前备用leader近这么多倍时才更换，避免频繁切换
+const double GROUP_COMMAND_DEADLINE = 0.5;//leader发出车群命令后需要知道哪些成员收到的时间 单位s
+const double GROUP_ACK_SLACK = 0.02;//每深一级提前确认的时间，留给确认消息向上传递 单位s
+const double GROUP_RETRANSMIT_INTERVAL = 0.05;//没有收到子节点确认时重传的间隔 单位s
+const uint8_t GROUP_MAX_RETRIES = 3;//每个节点对每条命令最多的重传次数
+const double GEOCAST_RADIUS = 300;//避障警告的目标区域半径 单位m
+const double GEOCAST_MAX_DISTANCE = 250;//基于竞争的转发中认为能收到的最远距离，约为通信距离 单位m
+const double GEOCAST_MIN_TIMEOUT = 0.001;//离上一个发送者GEOCAST_MAX_DISTANCE及以上时的转发等待时间 单位s
+const double GEOCAST_MAX_TIMEOUT = 0.1;//紧挨着上一个发送者时的转发等待时间 单位s
+const double GEOCAST_LIFETIME = 5;//收到地理广播后保留状态、忽略重复的时间 单位s
+const uint8_t GEOCAST_MAX_HOPS = 10;
 
 //节点基本状态标记
 const NodeState INITIAL_STATE = 0x0001;
@@ -81,6 +290,33 @@ public:
     
     //判断自己是否是member
     bool isMember();
+    
+    //交给设备发送成功的数据包数
+    uint64_t GetSentCount();
+    
+    //收到的本协议数据包数
+    uint64_t GetReceivedCount();
+
+    //按逻辑信道（见MessageChannel）统计的发送成功包数和收到的载荷字节数，单信道时也按消息类型归类，作为对比基线
+    uint64_t GetChannelSentCount(uint8_t channel);
+    uint64_t GetChannelReceivedBytes(uint8_t channel);
+
+    //发送的心跳包数和收到的心跳回复数，回复率反映信标链路的投递率
+    uint64_t GetHelloSentCount();
+    uint64_t GetHelloReplyCount();
+
+    //拥塞控制的状态，没有启用Dcc时不采样
+    DccController& GetDccController();
+
+    //航位推算的状态，统计心跳包刷新前父节点的位置误差
+    DeadReckoning& GetDeadReckoning();
+
+    //各消息包池重用包和新建包的次数之和
+    uint64_t GetPacketPoolReusedCount();
+    uint64_t GetPacketPoolAllocatedCount();
+
+    //把本节点协议数据结构占用的内存加到usage中
+    void GetMemoryUsage(MemoryUsage& usage);
 
     // 获取自己的mac地址，debug用
     Address GetAddress();
@@ -109,14 +345,30 @@ public:
     //分配任务编号
     void AssignTask(uint32_t task_id);
     
-    //在time时间为校车分配任务
+    //在time时间为校车分配任务，应用还没有启动时推迟到启动时分配
     void AssignTaskAtTime(uint32_t task_id, Time t);
+
+    //修改心跳包间隔，已经安排的下一次心跳包按新的间隔重新安排，见ScenarioHelper::ApplyPerturbation
+    void SetHelloInterval(Time interval);
+
+    //节点失联：立即停止应用，取消所有定时器，不再发送消息，见ScenarioHelper::ScheduleMissing
+    void SetMissing();
+
+    //检查点：车群建立相关定时器的剩余时间，没有等待中的定时器时为负
+    void GetTimerState(Time& construct_delay, Time& wait_construct_delay);
+
+    //从检查点恢复：t及之前的任务分配已经包含在检查点中，不再执行
+    void SetRestoreTime(Time t);
+
+    //从检查点恢复后按剩余时间重新启动定时器，为负则不启动
+    void RestoreTimers(Time construct_delay, Time wait_construct_delay);
     
     //分配编号后，一段时间没有收到建立消息，自己成为Leader
     void ConvertFromWaitConstructToLeader();
 
-    //收到数据包后更新邻居节点
-    void UpdateNeighbor (Address addr);
+    //收到带发送者位置的数据包后更新一跳邻居表
+    void UpdateNeighbor (const Address& addr, const Vector& pos, const Vector& velocity = Vector(),
+                         const Vector& acceleration = Vector());
     
     //移除长时间未通信节点
     void RemoveOldNeighbors ();
@@ -124,57 +376,323 @@ public:
     //
     void SetWifiMode (WifiMode mode);
     
-    //发送心跳包
+    //心跳包的定时器：周期发送，启用航位推算时每DR_CHECK_INTERVAL检查一次，偏离预测或太久没有发送时才发送
     void SendHello();
+
+    //按本车当前的运动状态发送一个心跳包
+    void TransmitHello();
+
+    //按最近一次心跳包的位置、速度和加速度外推邻居当前的位置，最多外推GetTimeLimit()
+    Vector PredictPosition(const NeighborInformation& ni);
     
     //处理HELLO消息
-    void HandleHelloMessage(uint8_t *buffer, const Address &sender, Time timestamp);
+    void HandleHelloMessage(const HelloInformation& hi, const Address &sender, Time timestamp);
     
     //发送心跳包的回复
     void SendHelloR(const Address &addr);
     
     //处理HELLO_R消息
-    void HandleHelloRMessage(uint8_t *buffer, const Address &sender, Time timestamp);
+    void HandleHelloRMessage(const HelloRInformation& hri, const Address &sender, Time timestamp);
     
     //发送建立消息
     void SendConstructMessage();
     
     //处理建立消息
-    void HandleConstructMessage(uint8_t *buffer, const Address &sender);
+    void HandleConstructMessage(const ConstructInformation& ci, const Address &sender);
     
     //发送建立回复消息
     void SendConstructReplyMessage(const Address &addr);
     
     //处理建立回复消息
-    void HandleConstructReplyMessage(uint8_t* buffer, const Address &sender, Time timestamp);
+    void HandleConstructReplyMessage(const ConstructReplyInformation& cri, const Address &sender, Time timestamp);
     
     //发送建立确认消息
     void SendConstructConfirmMessage(const ConstructConfirmInformation& cci, const Address &addr);
     
     //处理建立确认消息
-    void HandleConstructConfirmMessage(uint8_t* buffer);
+    void HandleConstructConfirmMessage(const ConstructConfirmInformation& cci);
+
+    //子节点加入：添加到它的路由，并向leader方向通告
+    void AddChildRoute(const Address &child);
+
+    //子节点离开：删除这个子节点和经过它的所有路由，并向leader方向通告
+    void RemoveChild(const Address &child);
+
+    //加入新的父节点后，向它通告自己子树中的所有节点
+    void AnnounceSubtree();
+
+    //把合并后的路由变化发给父节点
+    void SendRouteUpdate();
+
+    //处理子节点发来的路由更新消息
+    void HandleRouteUpdateMessage(const uint8_t* buffer, uint32_t size, const Address &sender);
+
+    //leader周期性地向邻近leader发送PROBE，并让距离过远的子节点分裂出去
+    void CheckAdjust();
+
+    //处理合并与分裂消息
+    void HandleAdjustMessage(const AdjustInformation& ai, const Address &sender);
+
+    //本车群（leader）或子树（成员）的节点数，包括自己
+    uint32_t GetGroupSize();
+
+    //合并与分裂发送的消息数
+    uint64_t GetMergeMessageCount();
+    uint64_t GetSplitMessageCount();
     
     // 查看附近是否有障碍物
     bool CheckObstacle();
 
-    // 查看是否有节点失联
+    // 周期性检查是否有节点失联：leader移除失联的子节点、选择并同步备用leader；
+    // 成员的父节点失联时，备用leader接替leader，其它节点离开车群重新建立
     bool CheckMissing();
 
+    // 备用leader接替失联的leader，把其它二级节点一次接到自己下面
+    void SwitchLeader();
+
+    //处理备用leader相关的消息
+    void HandleTransferMessage(const uint8_t* buffer, uint32_t size, const Address &sender);
+
+    //备用leader切换发送的消息数
+    uint64_t GetFailoverMessageCount();
+
+    //leader可靠地向整个车群发送命令：沿车群树逐级转发，每个节点汇总子树的确认后向父节点发一个确认，
+    //只向没有确认的子节点重传，leader在m_group_command_deadline内知道哪些成员收到了命令
+    //同一个命令还在确认中或者没有子节点时不发送，返回false
+    bool SendGroupCommand(uint8_t type, const uint8_t* payload, uint32_t size);
+
+    //定长的命令，消息类型和长度由MessageSchema决定
+    template <class Msg>
+    bool SendGroupCommand(const Msg& command);
+
+    //处理组播的车群命令：执行命令，转发给子节点，没有子节点时立即确认
+    void HandleGroupCommandMessage(uint8_t type, const uint8_t* buffer, uint32_t size, const Address &sender,
+                                   Time timestamp, uint8_t hops);
+
+    //处理子节点的汇总确认
+    void HandleGroupAckMessage(const uint8_t* buffer, uint32_t size, const Address &sender);
+
+    //处理单播的避障消息：leader可靠地转发给整个车群，成员执行避障
+    void HandleObstacleMessage(const ObstacleInformation& oi, const Address &sender);
+
+    //处理地理广播的避障警告：目标区域内的车辆执行避障，并按与上一个发送者的距离竞争转发
+    void HandleGeocastMessage(const GeocastInformation& gi, Time timestamp, uint8_t hops, const Address &sender);
+
+    //发出和转发的地理广播数，以及听到其它转发者后取消的转发数
+    uint64_t GetGeocastSentCount();
+    uint64_t GetGeocastSuppressedCount();
+
+    //leader发出的车群命令数、截止时间内没有全部确认的命令数，以及重传数和确认消息数
+    uint64_t GetGroupCommandCount();
+    uint64_t GetGroupCommandIncompleteCount();
+    uint64_t GetGroupRetransmitCount();
+    uint64_t GetGroupAckCount();
+
     // for debug
     void PrintRouter();
+    //把路由表写入事件日志（DEBUG级别）
+    void LogRouter();
 private:
     //StartApplication函数是应用启动后第一个调用的函数
     void StartApplication();
+    
+    //所有发送最终都经过这里交给设备，并记录trace
+    bool SendToDevice(Ptr<Packet> packet, const Address &next_hop);
+
+    //消息头的默认值：时间戳为现在，本节点发给dest
+    MessageHeader MakeTag(const Address &dest);
+
+    //按MessageSchema填写tag的消息类型和载荷长度，取得载荷为msg的包；pool为NULL时创建不入池的包
+    template <class Msg>
+    Ptr<Packet> MakeMessage(MessageHeader& tag, const Msg& msg, PacketPool* pool);
+
+    //变长消息：msg后面跟着n个项，在m_tx_buffer中组装
+    template <class Msg>
+    Ptr<Packet> MakeMessage(MessageHeader& tag, const Msg& msg, const typename MessageSchema<Msg>::ItemType* items,
+                            uint32_t n, PacketPool* pool);
+
+    //向一跳邻居直接发送定长消息，dest为广播地址时广播
+    template <class Msg>
+    void Send(const Msg& msg, const Address &dest, PacketPool* pool = NULL);
+
+    //按MessageSchema检查长度并取出载荷，长度不符时记录错误并返回false
+    template <class Msg>
+    bool Decode(const uint8_t* buffer, uint32_t size, Msg& msg);
+
+    //按消息类型TYPE绑定的载荷结构取出定长载荷，交给处理函数，后面的参数原样传给处理函数
+    //处理函数的第一个参数必须是TYPE的载荷结构，与MessageSchema的绑定不一致时编译失败；长度不符时不调用，返回false
+    template <uint8_t TYPE, class... Params, class... Args>
+    bool Dispatch(const uint8_t* buffer, uint32_t size,
+                  void (EvolutionApplication::*handler)(const typename MessageOfType<TYPE>::type&, Params...),
+                  Args&&... args);
+    
+    //向TraceRecorder记录一条收发记录
+    void TracePacket(Ptr<const Packet> packet, const Address &src, const Address &dst, uint8_t outcome);
+    
+    //应用停止时取消所有周期性事件，车辆离开trace后不再占用调度器
+    void StopApplication();
+
+    //记录一个要通告给父节点的路由变化，同一目的节点只保留最后一次变化，leader不再向上通告
+    void QueueRouteDelta(const Address &dest, uint8_t op);
+
+    //addr是否是本节点的子节点
+    bool IsChild(const Address &addr);
+
+    //拥塞控制：订阅发送信标的设备的PHY状态，抽象链路层设备直接读取信道忙的时间
+    void ConnectChannelBusy();
+    void RecordPhyState(Time start, Time duration, WifiPhyState state);
+
+    //每DCC_SAMPLE_INTERVAL计算一次信道忙比例并更新DCC状态
+    void SampleChannelBusy();
+
+    //DCC调整后的心跳和建立广播间隔；判断失联的时间限制随心跳间隔一起放大，
+    //邻近车辆的信道忙比例相近，父节点按自己的DCC状态估计子节点的心跳间隔
+    Time GetHelloInterval();
+    Time GetConstructInterval();
+    Time GetTimeLimit();
+
+    //航位推算时检查是否发送心跳包的周期，也随DCC放大
+    Time GetDeadReckoningInterval();
+
+    void SendAdjustMessage(const AdjustInformation& ai, const Address &addr);
+
+    //吸收方：在本节点接入candidate，没有空位时交给离它最近的子节点
+    void GraftOrForward(const AdjustInformation& ai);
+
+    //把新的级数和leader通知子节点，超过最大级数的子树离开车群，合并和分裂的代价只与这个子树有关
+    void RelevelChildren(const AdjustInformation& ai);
+
+    //子树离开车群，重新等待建立
+    void Detach(const AdjustInformation& ai);
+
+    //成为成员后不再维护邻近leader
+    void ClearNeighborLeaders();
+
+    //把车群命令发给一个子节点
+    void ForwardGroupCommand(const GroupCommandState& state, const Address &child);
+
+    //时间允许时安排下一次重传
+    void ScheduleGroupRetransmit(const GroupCommandKey& key, GroupCommandState& state);
+    void RetransmitGroupCommand(GroupCommandKey key);
+
+    //子节点都已确认或到了确认时间：没有确认的子节点连同子树计为未收到，向父节点确认，leader记录结果
+    void FinishGroupCommand(GroupCommandKey key);
+
+    void SendGroupAck(const GroupCommandKey& key, const GroupCommandState& state);
+
+    //执行收到的车群命令
+    void ExecuteGroupCommand(uint8_t type, const uint8_t* buffer, uint32_t size, const Address &sender);
+
+    //截止时间过后删除命令的状态
+    void ExpireGroupCommand(GroupCommandKey key);
+
+    //执行避障并记录本车收到了这个危险的警告
+    void AvoidHazard(const Vector& hazard, const Address &sender);
+
+    //避障消息交给设备时按载荷中的危险位置计入HazardStats
+    void RecordHazardTransmission(Ptr<const Packet> packet, MessageHeader& tag);
+
+    //发现危险的车辆向目标区域地理广播警告
+    void StartGeocast(const Vector& hazard);
+
+    //以本车的位置广播一帧地理广播
+    void SendGeocast(const GeocastState& state);
+
+    //竞争转发的等待时间到：听到过其它转发者且它们已经覆盖了已知位置的邻居时不再转发
+    void ForwardGeocast(HazardKey key);
+    bool GeocastReachesUncovered(const GeocastState& state);
+    bool GeocastNeighborUncovered(const GeocastState& state, const NeighborInformation& ni);
+
+    void ExpireGeocast(HazardKey key);
+
+    //成员没有在发送心跳包时开始发送，父节点的心跳从现在开始计时
+    void StartHelloIfMember();
+
+    //leader按链路稳定性（最近的位置与leader的距离）选择二级节点作为备用leader，并把车群信息同步给它
+    void SyncStandby();
+
+    void SendTransferMessage(const TransferInformation& ti, const vector<Address>& children,
+                             const vector<Address>& neighbor_leaders, const Address &addr);
+    
+    EventId m_hello_event;
+    EventId m_construct_event;
+    EventId m_wait_construct_event;
+    EventId m_remove_neighbors_event;
+    EventId m_check_obstacle_event;
+    EventId m_route_update_event;
+    EventId m_adjust_event;
+    EventId m_check_missing_event;
+    EventId m_assign_task_event;
+    int64_t m_pending_task;//应用启动前分配的任务，为负表示没有
+    
+    uint64_t m_sent_count;
+    uint64_t m_received_count;
+    uint64_t m_channel_sent[MESSAGE_CHANNEL_COUNT];
+    uint64_t m_channel_received_bytes[MESSAGE_CHANNEL_COUNT];
+    Time m_construct_reply_time;//发送建立回复消息的时间，用于统计建立的往返时延
+    Time m_restore_time;//从检查点恢复的时间，为负表示不是从检查点恢复
+    std::map<Address,uint8_t> m_pending_routes;//还没有通告给父节点的路由变化，目的节点 -> ROUTE_ADD/ROUTE_REMOVE
+    uint64_t m_merge_messages;
+    uint64_t m_split_messages;
+    uint64_t m_failover_messages;
+
+    //备用leader
+    Address m_standby;//leader：当前的备用leader
+    Time m_standby_sync_time;//备用leader：最后一次收到同步的时间，为负表示不是备用leader
+    Address m_standby_leader;//备用leader：发送同步的leader
+    std::vector<Address> m_standby_children;//备用leader：leader的其它二级节点
+    std::vector<Address> m_standby_neighbor_leaders;//备用leader：leader的邻近leader
+
+    //发送热点消息复用的包，见PacketPool
+    PacketPool m_hello_pool;
+    PacketPool m_hello_r_pool;
+    PacketPool m_obstacle_pool;
+    PacketPool m_group_pool;//车群管理命令：组播的避障、合并分裂、备用leader同步
+    std::vector<uint8_t> m_rx_buffer;//接收时复制载荷的缓冲区
+    std::vector<uint8_t> m_tx_buffer;//构造变长载荷的缓冲区
+    std::vector<MacRecord> m_tx_macs;//构造变长载荷中地址列表的缓冲区
+
+    //可靠的车群命令
+    std::map<GroupCommandKey, GroupCommandState> m_group_commands;
+    uint16_t m_next_group_seq;
+    uint64_t m_group_commands_sent;
+    uint64_t m_group_commands_incomplete;
+    uint64_t m_group_retransmissions;
+    uint64_t m_group_acks;
+
+    //地理广播
+    std::map<HazardKey, GeocastState> m_geocasts;
+    uint64_t m_geocast_sent;
+    uint64_t m_geocast_suppressed;
+
+    //拥塞控制
+    DccController m_dcc;
+    EventId m_dcc_event;
+    Time m_phy_busy_time;//PHY处于接收、发送或CCA忙的累计时间
+    Time m_dcc_last_busy;//上一次采样时信道忙的累计时间
+    Time m_dcc_last_sample;
+    uint64_t m_hello_sent;
+    uint64_t m_hello_replies;
+
+    //航位推算
+    DeadReckoning m_dr;
+    Address m_dr_parent;//上一次心跳包发给的父节点，父节点改变后新的父节点没有本车的预测
    
 public:
     //初始化固定的参数
     uint8_t m_max_level;//车群最大级数
     uint8_t m_max_subnodes;//最大子结点数
     NodeState m_state;//当前车辆的状态
-    Ptr<WifiNetDevice> m_wifiDevice; //车辆的WAVE设备
+    Ptr<NetDevice> m_device; //车辆的WAVE设备(WifiNetDevice/WaveNetDevice)或抽象链路层设备(AbstractNetDevice)
+    Ptr<WaveNetDevice> m_wave_device; //CCH/SCH交替接入时为m_device，按消息类型选择信道发送
+    Ptr<NetDevice> m_sch_device; //双射频连续接入时服务信道上的第二个WifiNetDevice，与m_device地址相同
     Time m_time_limit; //移除超过m_time_limit未通信的节点
     Time m_check_missing_interval;//检查丢失节点的周期
-    Time m_hello_interval; //发送心跳包的间隔
+    Time m_hello_interval; //发送心跳包的间隔，启用DCC时为最小间隔
+    bool m_dcc_enabled; //按信道忙比例调整心跳和建立广播的间隔，见DccController
+    bool m_dead_reckoning; //心跳包只在位置偏离共享预测时发送，见DeadReckoning
+    double m_position_threshold; //单位：m，航位推算触发心跳包的位置误差
+    Time m_dr_max_interval; //航位推算时两次心跳包的最大间隔，失联的时间限制至少为它的两倍
     WifiMode m_mode; //wifi的模式
     
     uint8_t m_level;//节点的级数，leader节点为1
@@ -183,7 +701,9 @@ public:
     NeighborInformation m_parent; //节点的父节点
     NeighborInformation m_leader; //车群的leader信息
     std::vector<NeighborInformation> m_neighbor_leaders;//其它邻近leader信息，只有车群的leader维护这个表
+    std::map<Address, NeighborInformation> m_neighbors;//一跳邻居表：从带发送者位置的消息得知，不论是否在同一车群
     std::map<Address,Address> m_router; //路由信息router[mac]即为发送到mac消息下一跳要发送的节点
+    Time m_route_update_interval;//合并增量路由更新的周期
     
     
     //心跳包相关
@@ -199,10 +719,68 @@ public:
     Vector m_obstacle; // 障碍物信息，单障碍物，初始化时设置
     int m_safe_avoid_obstacle_distance; // 单位：m, 与障碍物之间的安全距离，超过则发避障消息
     Time m_check_obstacle_interval; // 检查丢失节点的周期
+    bool m_geocast_obstacle; // 避障警告向障碍物周围的区域地理广播，而不是沿车群树传递
+    double m_geocast_radius; // 单位：m，目标区域的半径，树模式下也用于统计覆盖率
+
+    // ------------ 可靠的车群命令 -------------
+    Time m_group_command_deadline;
+    Time m_group_ack_slack;
+    Time m_group_retransmit_interval;
+    uint8_t m_group_max_retries;
 
     // ------------ 节点失联相关 -------------
-    bool m_is_simulate_node_missing; // 是否仿真节点失联
+    bool m_is_simulate_node_missing; // 是否仿真节点失联，开启后成员周期性发送心跳包，并启用备用leader
+    bool m_is_simulate_beacon; // 成员周期性发送心跳包但不检查失联，用于增加信标负载
+
+    // ------------ 合并与分裂相关 -------------
+    bool m_is_simulate_adjust; // 是否仿真车群合并与分裂，开启后成员周期性发送心跳包更新位置
+    Time m_adjust_interval; // leader检查合并与分裂的周期
+    double m_merge_distance; // 单位：m
+    double m_split_distance; // 单位：m
 
 };
 
+template <class Msg>
+Ptr<Packet> EvolutionApplication::MakeMessage(MessageHeader& tag, const Msg& msg, PacketPool* pool)
+{
+    static_assert(MessageSchema<Msg>::ItemSize() == 0, "变长消息需要传入后面的项");
+    return MakeMessage(tag, msg, NULL, 0, pool);
+}
+
+template <class Msg>
+Ptr<Packet> EvolutionApplication::MakeMessage(MessageHeader& tag, const Msg& msg,
+                                              const typename MessageSchema<Msg>::ItemType* items, uint32_t n, PacketPool* pool)
+{
+    uint32_t size = MessageSchema<Msg>::Size(n);
+    tag.SetType(MessageSchema<Msg>::Type());
+    tag.SetPayloadSize(size);
+    //定长消息直接从msg复制，不经过发送缓冲区
+    const uint8_t* payload = (const uint8_t*)&msg;
+    if(n > 0){
+        m_tx_buffer.resize(size);
+        WriteMessage(&m_tx_buffer[0], msg, items, n);
+        payload = &m_tx_buffer[0];
+    }
+    if(pool){
+        return pool->Get(tag, payload, size);
+    }
+    Ptr<Packet> packet = Create<Packet>(payload, size);
+    packet->AddPacketTag(tag);
+    return packet;
+}
+
+template <class Msg>
+bool EvolutionApplication::SendGroupCommand(const Msg& command)
+{
+    static_assert(MessageSchema<Msg>::ItemSize() == 0, "车群命令只能是定长消息");
+    return SendGroupCommand(MessageSchema<Msg>::Type(), (const uint8_t*)&command, MessageSchema<Msg>::Size(0));
+}
+
+template <class Msg>
+void EvolutionApplication::Send(const Msg& msg, const Address &dest, PacketPool* pool)
+{
+    MessageHeader tag = MakeTag(dest);
+    SendToDevice(MakeMessage(tag, msg, pool), dest);
+}
+
 #endif
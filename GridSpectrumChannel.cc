@@ -0,0 +1,299 @@
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/node.h"
+#include "ns3/mobility-model.h"
+#include "ns3/constant-position-mobility-model.h"
+#include "ns3/spectrum-value.h"
+#include "ns3/antenna-model.h"
+#include "ns3/angles.h"
+#include "ns3/double.h"
+#include "GridSpectrumChannel.h"
+#include <algorithm>
+#include <cmath>
+
+NS_LOG_COMPONENT_DEFINE("GridSpectrumChannel");
+NS_OBJECT_ENSURE_REGISTERED(GridSpectrumChannel);
+
+//超过这个距离就认为传播损耗模型没有限制通信距离，退化为发给所有PHY
+const double UNLIMITED_RANGE = 1e6;
+
+TypeId GridSpectrumChannel::GetTypeId()
+{
+    static TypeId tid = TypeId("ns3::GridSpectrumChannel")
+                .SetParent <SpectrumChannel> ()
+                .AddConstructor<GridSpectrumChannel> ()
+                .AddAttribute ("CellSize", "网格边长 单位m",
+                      DoubleValue (250),
+                      MakeDoubleAccessor (&GridSpectrumChannel::m_cell_size),
+                      MakeDoubleChecker<double> (1.0)
+                      )
+                .AddAttribute ("MinRxPowerDbm", "接收功率低于该值的信号直接丢弃，应远低于噪声底，默认值的依据见GridSpectrumChannel.h",
+                      DoubleValue (-130),
+                      MakeDoubleAccessor (&GridSpectrumChannel::m_min_rx_power_dbm),
+                      MakeDoubleChecker<double> ()
+                      )
+                .AddAttribute ("MarginDb", "计算最大通信距离时额外的功率余量",
+                      DoubleValue (3),
+                      MakeDoubleAccessor (&GridSpectrumChannel::m_margin_db),
+                      MakeDoubleChecker<double> (0.0)
+                      )
+                .AddAttribute ("MaxLossDb", "路径损耗超过该值的信号直接丢弃",
+                      DoubleValue (1.0e9),
+                      MakeDoubleAccessor (&GridSpectrumChannel::m_max_loss_db),
+                      MakeDoubleChecker<double> ()
+                      )
+                .AddAttribute ("MaxSpeed", "车辆最大速度 单位m/s",
+                      DoubleValue (70),
+                      MakeDoubleAccessor (&GridSpectrumChannel::m_max_speed),
+                      MakeDoubleChecker<double> (0.0)
+                      )
+                .AddAttribute ("UpdateInterval", "根据移动模型更新网格的周期",
+                      TimeValue (Seconds (1)),
+                      MakeTimeAccessor (&GridSpectrumChannel::m_update_interval),
+                      MakeTimeChecker ()
+                      )
+                      ;
+    return tid;
+}
+
+GridSpectrumChannel::GridSpectrumChannel()
+{
+    m_tx_count = 0;
+    m_rx_event_count = 0;
+}
+
+GridSpectrumChannel::~GridSpectrumChannel()
+{
+
+}
+
+void GridSpectrumChannel::DoDispose()
+{
+    Simulator::Cancel(m_update_event);
+    m_phyList.clear();
+    m_pending.clear();
+    m_grid.Clear();
+    m_propagationLoss = 0;
+    m_spectrumPropagationLoss = 0;
+    m_propagationDelay = 0;
+    SpectrumChannel::DoDispose();
+}
+
+void GridSpectrumChannel::AddPropagationLossModel (Ptr<PropagationLossModel> loss)
+{
+    if (m_propagationLoss) {
+        loss->SetNext(m_propagationLoss);
+    }
+    m_propagationLoss = loss;
+    m_rangeCache.clear();
+}
+
+void GridSpectrumChannel::AddSpectrumPropagationLossModel (Ptr<SpectrumPropagationLossModel> loss)
+{
+    //频谱相关的损耗只能让信号更弱，不影响最大通信距离的上界
+    if (m_spectrumPropagationLoss) {
+        loss->SetNext(m_spectrumPropagationLoss);
+    }
+    m_spectrumPropagationLoss = loss;
+}
+
+void GridSpectrumChannel::SetPropagationDelayModel (Ptr<PropagationDelayModel> delay)
+{
+    m_propagationDelay = delay;
+}
+
+Ptr<SpectrumPropagationLossModel> GridSpectrumChannel::GetSpectrumPropagationLossModel (void)
+{
+    return m_spectrumPropagationLoss;
+}
+
+std::size_t GridSpectrumChannel::GetNDevices (void) const
+{
+    return m_phyList.size();
+}
+
+Ptr<NetDevice> GridSpectrumChannel::GetDevice (std::size_t i) const
+{
+    return m_phyList.at(i)->GetDevice();
+}
+
+uint64_t GridSpectrumChannel::GetTxCount()
+{
+    return m_tx_count;
+}
+
+uint64_t GridSpectrumChannel::GetRxEventCount()
+{
+    return m_rx_event_count;
+}
+
+uint64_t GridSpectrumChannel::GetMemoryBytes()
+{
+    return VectorBytes(m_phyList) + VectorBytes(m_pending) + m_grid.GetMemoryBytes() + MapBytes(m_rangeCache);
+}
+
+void GridSpectrumChannel::AddRx (Ptr<SpectrumPhy> phy)
+{
+    m_phyList.push_back(phy);
+    //加入信道时PHY可能还没有设置移动模型，第一次发送或更新网格时再放入网格
+    m_pending.push_back(phy);
+    if (!m_update_event.IsRunning()) {
+        m_update_event = Simulator::Schedule(m_update_interval, &GridSpectrumChannel::UpdateGrid, this);
+    }
+}
+
+void GridSpectrumChannel::RemoveDevice(Ptr<NetDevice> dev)
+{
+    for (vector< Ptr<SpectrumPhy> >::iterator iter = m_phyList.begin(); iter != m_phyList.end(); iter++) {
+        if ((*iter)->GetDevice() == dev) {
+            Ptr<SpectrumPhy> phy = *iter;
+            m_phyList.erase(iter);
+            m_pending.erase(std::remove(m_pending.begin(), m_pending.end(), phy), m_pending.end());
+            m_grid.Remove(phy);
+            return;
+        }
+    }
+}
+
+void GridSpectrumChannel::PlacePending()
+{
+    vector< Ptr<SpectrumPhy> > pending;
+    pending.swap(m_pending);
+    for (vector< Ptr<SpectrumPhy> >::iterator iter = pending.begin(); iter != pending.end(); iter++) {
+        Ptr<MobilityModel> mobility = (*iter)->GetMobility();
+        if (mobility) {
+            m_grid.Update(*iter, mobility->GetPosition());
+        } else {
+            m_pending.push_back(*iter);
+        }
+    }
+}
+
+void GridSpectrumChannel::UpdateGrid()
+{
+    //网格边长在放入第一个PHY之前确定
+    m_grid.SetCellSize(m_cell_size);
+    PlacePending();
+    for (vector< Ptr<SpectrumPhy> >::iterator iter = m_phyList.begin(); iter != m_phyList.end(); iter++) {
+        if (m_grid.Contains(*iter)) {
+            m_grid.Update(*iter, (*iter)->GetMobility()->GetPosition());
+        }
+    }
+    m_update_event = Simulator::Schedule(m_update_interval, &GridSpectrumChannel::UpdateGrid, this);
+}
+
+double GridSpectrumChannel::CalcMaxRange(double txPowerDbm)
+{
+    if (!m_propagationLoss) {
+        return UNLIMITED_RANGE;
+    }
+    int64_t key = (int64_t)std::floor(txPowerDbm * 100);
+    map< int64_t, double >::iterator iter = m_rangeCache.find(key);
+    if (iter != m_rangeCache.end()) {
+        return iter->second;
+    }
+
+    //缓存按0.01dBm取整，用区间上界计算保证距离偏大
+    double power = (key + 1) / 100.0 + m_margin_db;
+    Ptr<ConstantPositionMobilityModel> a = CreateObject<ConstantPositionMobilityModel>();
+    Ptr<ConstantPositionMobilityModel> b = CreateObject<ConstantPositionMobilityModel>();
+    a->SetPosition(Vector(0, 0, 0));
+
+    //先倍增找到上界，再二分，要求损耗模型随距离单调
+    double lo = 0;
+    double hi = 1;
+    b->SetPosition(Vector(hi, 0, 0));
+    while (m_propagationLoss->CalcRxPower(power, a, b) >= m_min_rx_power_dbm) {
+        lo = hi;
+        hi *= 2;
+        if (hi >= UNLIMITED_RANGE) {
+            m_rangeCache[key] = UNLIMITED_RANGE;
+            return UNLIMITED_RANGE;
+        }
+        b->SetPosition(Vector(hi, 0, 0));
+    }
+    while (hi - lo > 1) {
+        double mid = (lo + hi) / 2;
+        b->SetPosition(Vector(mid, 0, 0));
+        if (m_propagationLoss->CalcRxPower(power, a, b) >= m_min_rx_power_dbm) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    NS_LOG_INFO("发射功率 " << txPowerDbm << "dBm 的最大通信距离为 " << hi << "m");
+    m_rangeCache[key] = hi;
+    return hi;
+}
+
+void GridSpectrumChannel::StartTx (Ptr<SpectrumSignalParameters> txParams)
+{
+    NS_ASSERT_MSG (txParams->psd, "NULL txPsd");
+    NS_ASSERT_MSG (txParams->txPhy, "NULL txPhy");
+    m_tx_count++;
+
+    if (!m_pending.empty()) {
+        m_grid.SetCellSize(m_cell_size);
+        PlacePending();
+    }
+
+    Ptr<MobilityModel> senderMobility = txParams->txPhy->GetMobility();
+    double txPowerDbm = 10 * std::log10(Integral(*txParams->psd)) + 30;
+    double range = CalcMaxRange(txPowerDbm);
+
+    //收集候选接收者：没有位置信息的PHY总是候选
+    vector< Ptr<SpectrumPhy> > receivers(m_pending);
+    if (!senderMobility || range >= UNLIMITED_RANGE) {
+        receivers = m_phyList;
+    } else {
+        //两次网格更新之间收发双方都可能移动
+        double radius = range + 2 * m_max_speed * m_update_interval.GetSeconds();
+        m_grid.GetItemsInRange(senderMobility->GetPosition(), radius, receivers);
+    }
+
+    //以下与SingleModelSpectrumChannel::StartTx相同
+    for (vector< Ptr<SpectrumPhy> >::iterator rxPhyIterator = receivers.begin(); rxPhyIterator != receivers.end(); rxPhyIterator++) {
+        if ((*rxPhyIterator) == txParams->txPhy) {
+            continue;
+        }
+        Time delay = MicroSeconds (0);
+        Ptr<SpectrumSignalParameters> rxParams = txParams->Copy ();
+        Ptr<MobilityModel> receiverMobility = (*rxPhyIterator)->GetMobility ();
+
+        if (senderMobility && receiverMobility) {
+            double pathLossDb = 0;
+            if (txParams->txAntenna != 0) {
+                Angles txAngles (receiverMobility->GetPosition (), senderMobility->GetPosition ());
+                pathLossDb -= txParams->txAntenna->GetGainDb (txAngles);
+            }
+            Ptr<AntennaModel> rxAntenna = (*rxPhyIterator)->GetRxAntenna ();
+            if (rxAntenna != 0) {
+                Angles rxAngles (senderMobility->GetPosition (), receiverMobility->GetPosition ());
+                pathLossDb -= rxAntenna->GetGainDb (rxAngles);
+            }
+            if (m_propagationLoss) {
+                pathLossDb -= m_propagationLoss->CalcRxPower (0, senderMobility, receiverMobility);
+            }
+            if (pathLossDb > m_max_loss_db || txPowerDbm - pathLossDb < m_min_rx_power_dbm) {
+                continue;
+            }
+            *(rxParams->psd) *= std::pow (10.0, (-pathLossDb) / 10.0);
+            if (m_spectrumPropagationLoss) {
+                rxParams->psd = m_spectrumPropagationLoss->CalcRxPowerSpectralDensity (rxParams->psd, senderMobility, receiverMobility);
+            }
+            if (m_propagationDelay) {
+                delay = m_propagationDelay->GetDelay (senderMobility, receiverMobility);
+            }
+        }
+
+        Ptr<NetDevice> netDev = (*rxPhyIterator)->GetDevice ();
+        uint32_t dstNode = netDev ? netDev->GetNode ()->GetId () : 0xffffffff;
+        m_rx_event_count++;
+        Simulator::ScheduleWithContext (dstNode, delay, &GridSpectrumChannel::StartRx, this, rxParams, *rxPhyIterator);
+    }
+}
+
+void GridSpectrumChannel::StartRx (Ptr<SpectrumSignalParameters> params, Ptr<SpectrumPhy> receiver)
+{
+    receiver->StartRx (params);
+}
@@ -0,0 +1,96 @@
+#ifndef GRID_SPECTRUM_CHANNEL_H
+#define GRID_SPECTRUM_CHANNEL_H
+
+#include "ns3/spectrum-channel.h"
+#include "ns3/spectrum-phy.h"
+#include "ns3/propagation-loss-model.h"
+#include "ns3/propagation-delay-model.h"
+#include "ns3/spectrum-propagation-loss-model.h"
+#include "ns3/event-id.h"
+#include "SpatialGrid.h"
+#include <vector>
+#include <map>
+
+using namespace ns3;
+using namespace std;
+
+/*
+ * 按均匀网格划分空间的信道
+ * YansWifiChannel和SingleModelSpectrumChannel每次发送都会给信道上的所有PHY调度接收事件，
+ * 这里只把信号发给最大通信距离内所在网格的PHY，每次发送的事件数只与局部车辆密度有关
+ * 最大通信距离由发射功率和传播损耗模型计算，接收功率低于MinRxPowerDbm的信号才会被丢弃，
+ * MinRxPowerDbm设为很小的值（例如-1e9）时不丢弃任何信号，仿真结果与SingleModelSpectrumChannel相同（见TestGridChannel）
+ * YansWifiChannel::Send不是虚函数，不能替换YansWifiChannel本身；--gridChannel时ScenarioHelper改用SpectrumWifiPhy，
+ * 对照的原生信道是SpectrumWifiPhy使用的SingleModelSpectrumChannel
+ *
+ * MinRxPowerDbm默认-130dBm：
+ * 被丢弃的信号比接收灵敏度（-101dBm）低约30dB，不可能被解码，只影响干扰；单个信号比10MHz信道的噪声底（约-97dBm）低33dB
+ * 对数距离模型（指数3）下，道路上线密度为λ时截断距离R以外所有信号的总功率约为λ·R·P(R)，
+ * 发射功率16dBm（ns-3默认）时R约2.5km，按benchmark默认的3车道、每车道20辆/km（λ=0.06/m）约为-108dBm，比噪声底低11dB，SINR的变化约0.3dB
+ * 车辆更密集或道路为二维路网时总干扰随密度增加，需要调低MinRxPowerDbm，代价是每次发送的接收事件增多
+ */
+class GridSpectrumChannel : public SpectrumChannel
+{
+public:
+    static TypeId GetTypeId (void);
+    GridSpectrumChannel();
+    virtual ~GridSpectrumChannel();
+
+    // SpectrumChannel的接口
+    virtual void AddPropagationLossModel (Ptr<PropagationLossModel> loss);
+    virtual void AddSpectrumPropagationLossModel (Ptr<SpectrumPropagationLossModel> loss);
+    virtual void SetPropagationDelayModel (Ptr<PropagationDelayModel> delay);
+    virtual Ptr<SpectrumPropagationLossModel> GetSpectrumPropagationLossModel (void);
+    virtual void StartTx (Ptr<SpectrumSignalParameters> params);
+    virtual void AddRx (Ptr<SpectrumPhy> phy);
+
+    // Channel的接口
+    virtual std::size_t GetNDevices (void) const;
+    virtual Ptr<NetDevice> GetDevice (std::size_t i) const;
+
+    //把设备的PHY从信道上移除，车辆离开场景后调用
+    void RemoveDevice(Ptr<NetDevice> dev);
+
+    //发射功率为txPowerDbm时，接收功率不低于MinRxPowerDbm的最大距离
+    double CalcMaxRange(double txPowerDbm);
+
+    //统计信息
+    uint64_t GetTxCount();
+    uint64_t GetRxEventCount();
+
+    //信道数据结构（设备列表、网格）占用的内存 单位byte
+    uint64_t GetMemoryBytes();
+
+private:
+    virtual void DoDispose (void);
+
+    void StartRx (Ptr<SpectrumSignalParameters> params, Ptr<SpectrumPhy> receiver);
+
+    //根据当前位置重新放置所有PHY，周期性调用
+    void UpdateGrid();
+
+    //把有位置信息的待放置PHY放入网格
+    void PlacePending();
+
+    Ptr<PropagationLossModel> m_propagationLoss;
+    Ptr<SpectrumPropagationLossModel> m_spectrumPropagationLoss;
+    Ptr<PropagationDelayModel> m_propagationDelay;
+
+    double m_cell_size;//网格边长 单位m
+    double m_min_rx_power_dbm;//低于该接收功率的信号直接丢弃
+    double m_margin_db;//计算最大距离时额外增加的功率余量，覆盖天线增益
+    double m_max_loss_db;//与SingleModelSpectrumChannel的MaxLossDb含义相同
+    double m_max_speed;//车辆最大速度 单位m/s，用于估计两次更新之间的位移
+    Time m_update_interval;//网格更新周期
+    EventId m_update_event;
+
+    vector< Ptr<SpectrumPhy> > m_phyList;//按加入顺序，供GetDevice使用
+    vector< Ptr<SpectrumPhy> > m_pending;//还没有位置信息、尚未放入网格的PHY
+    SpatialGrid< Ptr<SpectrumPhy> > m_grid;
+    map< int64_t, double > m_rangeCache;//发射功率(0.01dBm) -> 最大通信距离
+
+    uint64_t m_tx_count;
+    uint64_t m_rx_event_count;
+};
+
+#endif
@@ -0,0 +1,280 @@
+#include "ns3/log.h"
+#include "ns3/mobility-model.h"
+#include "ns3/constant-velocity-mobility-model.h"
+#include "ns3/mac48-address.h"
+#include "GroupCheckpoint.h"
+#include <fstream>
+#include <sstream>
+
+NS_LOG_COMPONENT_DEFINE("GroupCheckpoint");
+
+//按本机字节序读写定长的值
+template <class T>
+static void WriteValue(ostream& os, T value){
+    os.write((const char*)&value, sizeof(value));
+}
+
+template <class T>
+static bool ReadValue(istream& is, T& value){
+    return (bool)is.read((char*)&value, sizeof(value));
+}
+
+static void WriteVector(ostream& os, const Vector& v){
+    WriteValue(os, v.x);
+    WriteValue(os, v.y);
+    WriteValue(os, v.z);
+}
+
+static bool ReadVector(istream& is, Vector& v){
+    return ReadValue(is, v.x) && ReadValue(is, v.y) && ReadValue(is, v.z);
+}
+
+//mac地址只保存6字节，无效地址保存为全0
+static void WriteMac(ostream& os, const Address& addr){
+    uint8_t mac[6] = {0, 0, 0, 0, 0, 0};
+    if(Mac48Address::IsMatchingType(addr)){
+        Mac48Address::ConvertFrom(addr).CopyTo(mac);
+    }
+    os.write((const char*)mac, sizeof(mac));
+}
+
+static bool ReadMac(istream& is, Address& addr){
+    uint8_t mac[6];
+    if(!is.read((char*)mac, sizeof(mac))){
+        return false;
+    }
+    Mac48Address m;
+    m.CopyFrom(mac);
+    addr = m;
+    return true;
+}
+
+static void WriteNeighbor(ostream& os, const NeighborInformation& ni){
+    WriteMac(os, ni.mac);
+    WriteValue(os, (int64_t)ni.last_beacon.GetNanoSeconds());
+    WriteVector(os, ni.pos);
+    WriteVector(os, ni.velocity);
+    WriteVector(os, ni.acceleration);
+}
+
+static bool ReadNeighbor(istream& is, NeighborInformation& ni){
+    int64_t last_beacon;
+    if(!ReadMac(is, ni.mac) || !ReadValue(is, last_beacon) || !ReadVector(is, ni.pos)
+       || !ReadVector(is, ni.velocity) || !ReadVector(is, ni.acceleration)){
+        return false;
+    }
+    ni.last_beacon = NanoSeconds(last_beacon);
+    return true;
+}
+
+string GroupCheckpoint::GetRankPath(string path){
+    if(Simulator::GetSystemId() == 0){
+        return path;
+    }
+    ostringstream rank_path;
+    rank_path<<path<<".rank"<<Simulator::GetSystemId();
+    return rank_path.str();
+}
+
+NodeCheckpoint GroupCheckpoint::Capture(Ptr<Node> node){
+    Ptr<EvolutionApplication> app = DynamicCast<EvolutionApplication>(node->GetApplication(0));
+    NodeCheckpoint record;
+    record.node_id = node->GetId();
+    record.state = app->m_state;
+    record.level = app->m_level;
+    record.task_id = app->m_task_id;
+    Ptr<MobilityModel> mobility = node->GetObject<MobilityModel>();
+    record.has_mobility = mobility != NULL;
+    if(mobility){
+        record.position = mobility->GetPosition();
+        record.velocity = mobility->GetVelocity();
+    }
+    app->GetTimerState(record.construct_delay, record.wait_construct_delay);
+    record.parent = app->m_parent;
+    record.leader = app->m_leader;
+    record.next = app->m_next;
+    record.neighbor_leaders = app->m_neighbor_leaders;
+    for(map<Address, Address>::iterator iter = app->m_router.begin(); iter != app->m_router.end(); iter++){
+        record.router.push_back(*iter);
+    }
+    return record;
+}
+
+void GroupCheckpoint::WriteRecord(ostream& os, const NodeCheckpoint& record){
+    WriteValue(os, record.node_id);
+    WriteValue(os, record.state);
+    WriteValue(os, record.level);
+    WriteValue(os, (uint8_t)record.has_mobility);
+    WriteValue(os, record.task_id);
+    if(record.has_mobility){
+        WriteVector(os, record.position);
+        WriteVector(os, record.velocity);
+    }
+    WriteValue(os, (int64_t)record.construct_delay.GetNanoSeconds());
+    WriteValue(os, (int64_t)record.wait_construct_delay.GetNanoSeconds());
+    WriteNeighbor(os, record.parent);
+    WriteNeighbor(os, record.leader);
+    WriteValue(os, (uint16_t)record.next.size());
+    for(size_t i = 0; i < record.next.size(); i++){
+        WriteNeighbor(os, record.next[i]);
+    }
+    WriteValue(os, (uint16_t)record.neighbor_leaders.size());
+    for(size_t i = 0; i < record.neighbor_leaders.size(); i++){
+        WriteNeighbor(os, record.neighbor_leaders[i]);
+    }
+    WriteValue(os, (uint32_t)record.router.size());
+    for(size_t i = 0; i < record.router.size(); i++){
+        WriteMac(os, record.router[i].first);
+        WriteMac(os, record.router[i].second);
+    }
+}
+
+bool GroupCheckpoint::ReadRecord(istream& is, NodeCheckpoint& record){
+    uint8_t has_mobility;
+    if(!ReadValue(is, record.node_id) || !ReadValue(is, record.state) || !ReadValue(is, record.level)
+       || !ReadValue(is, has_mobility) || !ReadValue(is, record.task_id)){
+        return false;
+    }
+    record.has_mobility = has_mobility != 0;
+    if(record.has_mobility && (!ReadVector(is, record.position) || !ReadVector(is, record.velocity))){
+        return false;
+    }
+    int64_t construct_delay, wait_construct_delay;
+    if(!ReadValue(is, construct_delay) || !ReadValue(is, wait_construct_delay)){
+        return false;
+    }
+    record.construct_delay = NanoSeconds(construct_delay);
+    record.wait_construct_delay = NanoSeconds(wait_construct_delay);
+    if(!ReadNeighbor(is, record.parent) || !ReadNeighbor(is, record.leader)){
+        return false;
+    }
+    uint16_t n_next, n_neighbor_leaders;
+    if(!ReadValue(is, n_next)){
+        return false;
+    }
+    record.next.resize(n_next);
+    for(uint16_t i = 0; i < n_next; i++){
+        if(!ReadNeighbor(is, record.next[i])){
+            return false;
+        }
+    }
+    if(!ReadValue(is, n_neighbor_leaders)){
+        return false;
+    }
+    record.neighbor_leaders.resize(n_neighbor_leaders);
+    for(uint16_t i = 0; i < n_neighbor_leaders; i++){
+        if(!ReadNeighbor(is, record.neighbor_leaders[i])){
+            return false;
+        }
+    }
+    uint32_t n_router;
+    if(!ReadValue(is, n_router)){
+        return false;
+    }
+    record.router.resize(n_router);
+    for(uint32_t i = 0; i < n_router; i++){
+        if(!ReadMac(is, record.router[i].first) || !ReadMac(is, record.router[i].second)){
+            return false;
+        }
+    }
+    return true;
+}
+
+void GroupCheckpoint::Save(string path, NodeContainer nodes){
+    string rank_path = GetRankPath(path);
+    ofstream file(rank_path.c_str(), ios::binary);
+    if(!file.is_open()){
+        NS_FATAL_ERROR ("GroupCheckpoint::Save 无法打开 " << rank_path);
+    }
+    vector<NodeCheckpoint> records;
+    for(uint32_t i = 0; i < nodes.GetN(); i++){
+        Ptr<Node> node = nodes.Get(i);
+        if(node->GetSystemId() != Simulator::GetSystemId() || node->GetNApplications() == 0
+           || !DynamicCast<EvolutionApplication>(node->GetApplication(0))){
+            continue;
+        }
+        records.push_back(Capture(node));
+    }
+    WriteValue(file, CHECKPOINT_MAGIC);
+    WriteValue(file, CHECKPOINT_VERSION);
+    WriteValue(file, (uint16_t)0);
+    WriteValue(file, (int64_t)Simulator::Now().GetNanoSeconds());
+    WriteValue(file, (uint32_t)records.size());
+    for(size_t i = 0; i < records.size(); i++){
+        WriteRecord(file, records[i]);
+    }
+    NS_LOG_INFO("在" << Simulator::Now().GetSeconds() << "s保存了" << records.size() << "个节点的检查点到" << rank_path);
+}
+
+void GroupCheckpoint::SaveAt(string path, NodeContainer nodes, Time time){
+    Simulator::Schedule(time, &GroupCheckpoint::Save, path, nodes);
+}
+
+Time GroupCheckpoint::Restore(string path, NodeContainer& nodes){
+    string rank_path = GetRankPath(path);
+    ifstream file(rank_path.c_str(), ios::binary);
+    if(!file.is_open()){
+        NS_FATAL_ERROR ("GroupCheckpoint::Restore 无法打开 " << rank_path);
+    }
+    uint32_t magic;
+    uint16_t version, reserved;
+    int64_t time_ns;
+    uint32_t count;
+    if(!ReadValue(file, magic) || magic != CHECKPOINT_MAGIC || !ReadValue(file, version) || !ReadValue(file, reserved)
+       || !ReadValue(file, time_ns) || !ReadValue(file, count)){
+        NS_FATAL_ERROR ("GroupCheckpoint::Restore " << rank_path << " 不是检查点文件");
+    }
+    if(version != CHECKPOINT_VERSION){
+        NS_FATAL_ERROR ("GroupCheckpoint::Restore 检查点版本" << version << "与程序版本" << CHECKPOINT_VERSION << "不一致");
+    }
+    Time time = NanoSeconds(time_ns);
+
+    //节点编号 -> 节点
+    map<uint32_t, Ptr<Node> > id2node;
+    for(uint32_t i = 0; i < nodes.GetN(); i++){
+        id2node[nodes.Get(i)->GetId()] = nodes.Get(i);
+    }
+    for(uint32_t i = 0; i < count; i++){
+        NodeCheckpoint record;
+        if(!ReadRecord(file, record)){
+            NS_FATAL_ERROR ("GroupCheckpoint::Restore " << rank_path << " 在第" << i << "个节点处截断");
+        }
+        map<uint32_t, Ptr<Node> >::iterator iter = id2node.find(record.node_id);
+        if(iter == id2node.end() || iter->second->GetNApplications() == 0){
+            NS_FATAL_ERROR ("GroupCheckpoint::Restore 检查点中的节点" << record.node_id << "在场景中不存在或没有应用");
+        }
+        Ptr<EvolutionApplication> app = DynamicCast<EvolutionApplication>(iter->second->GetApplication(0));
+        if(!app){
+            NS_FATAL_ERROR ("GroupCheckpoint::Restore 节点" << record.node_id << "没有EvolutionApplication");
+        }
+        app->SetRestoreTime(time);
+        Simulator::Schedule(time, &GroupCheckpoint::Apply, iter->second, record);
+    }
+    NS_LOG_INFO("从" << rank_path << "读取了" << count << "个节点的检查点，将在" << time.GetSeconds() << "s恢复");
+    return time;
+}
+
+void GroupCheckpoint::Apply(Ptr<Node> node, NodeCheckpoint record){
+    Ptr<EvolutionApplication> app = DynamicCast<EvolutionApplication>(node->GetApplication(0));
+    app->m_state = record.state;
+    app->m_level = record.level;
+    app->m_task_id = record.task_id;
+    app->m_parent = record.parent;
+    app->m_leader = record.leader;
+    app->m_next = record.next;
+    app->m_neighbor_leaders = record.neighbor_leaders;
+    app->m_router.clear();
+    for(size_t i = 0; i < record.router.size(); i++){
+        app->m_router[record.router[i].first] = record.router[i].second;
+    }
+    app->RestoreTimers(record.construct_delay, record.wait_construct_delay);
+
+    Ptr<MobilityModel> mobility = node->GetObject<MobilityModel>();
+    if(record.has_mobility && mobility){
+        mobility->SetPosition(record.position);
+        Ptr<ConstantVelocityMobilityModel> cv = DynamicCast<ConstantVelocityMobilityModel>(mobility);
+        if(cv){
+            cv->SetVelocity(record.velocity);
+        }
+    }
+}
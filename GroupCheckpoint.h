@@ -0,0 +1,73 @@
+#ifndef GROUP_CHECKPOINT_H
+#define GROUP_CHECKPOINT_H
+
+#include "ns3/core-module.h"
+#include "ns3/node-container.h"
+#include "EvolutionApplication.h"
+#include <string>
+#include <vector>
+#include <istream>
+#include <ostream>
+
+using namespace ns3;
+using namespace std;
+
+const uint32_t CHECKPOINT_MAGIC = 0x4b434756;//"VGCK"
+const uint16_t CHECKPOINT_VERSION = 2;
+
+//一个节点的协议状态
+typedef struct{
+    uint32_t node_id;
+    NodeState state;
+    uint8_t level;
+    uint32_t task_id;
+    bool has_mobility;
+    Vector position;
+    Vector velocity;
+    Time construct_delay;//建立消息定时器的剩余时间，为负表示没有
+    Time wait_construct_delay;//等待建立定时器的剩余时间，为负表示没有
+    NeighborInformation parent;
+    NeighborInformation leader;
+    vector<NeighborInformation> next;
+    vector<NeighborInformation> neighbor_leaders;
+    vector< pair<Address, Address> > router;
+} NodeCheckpoint;
+
+/*
+ * 车群协议状态的检查点，用于跳过车群建立阶段
+ * 保存各节点EvolutionApplication的状态、级数、任务、父节点、leader、子节点、邻近leader、路由表、
+ * 建立相关定时器的剩余时间以及移动模型的位置和速度
+ * 文件为本机字节序的二进制格式：文件头（magic、版本、检查点时间、节点数）后面是各节点的变长记录，
+ * mac地址只保存6字节
+ *
+ * 恢复时仿真仍从0开始，移动trace照常执行，在检查点时间把状态写回各节点并重新启动定时器，
+ * 检查点时间及之前安排的任务分配被忽略，所以检查点之前没有协议消息，只需要仿真之后的阶段
+ * 恢复的场景需要与保存时使用相同的节点数和应用（节点编号一一对应）
+ */
+class GroupCheckpoint{
+public:
+    //保存nodes中本进程节点的当前状态，分布式仿真时进程r(r>0)写到path.rank<r>
+    static void Save(string path, NodeContainer nodes);
+
+    //在time时保存
+    static void SaveAt(string path, NodeContainer nodes, Time time);
+
+    //读取检查点，设置各应用的恢复时间，并安排在检查点时间写回状态，需要在应用添加到节点之后调用
+    //返回检查点时间
+    static Time Restore(string path, NodeContainer& nodes);
+
+private:
+    //收集一个节点的状态
+    static NodeCheckpoint Capture(Ptr<Node> node);
+
+    //把状态写回节点，在检查点时间调用
+    static void Apply(Ptr<Node> node, NodeCheckpoint record);
+
+    static void WriteRecord(ostream& os, const NodeCheckpoint& record);
+    static bool ReadRecord(istream& is, NodeCheckpoint& record);
+
+    //本进程使用的文件名
+    static string GetRankPath(string path);
+};
+
+#endif
@@ -1,16 +1,29 @@
 #include "ns3/log.h"
 #include "GroupInitializer.h"
+#include <algorithm>
+
+GroupInitializer::GroupInitializer(){
+    skipped = 0;
+}
 
 void GroupInitializer::ConstructVehicleGroup(VGTree* root, VGTree* t,VGTree* parent, NodeContainer& nodes, uint32_t task_id, uint8_t level){
     if(!t){
         return;
     }
     
+    //延迟激活时还没有出现的车辆没有设备，连同子树一起跳过，子树中的车辆按普通车辆自行建立或加入车群
+    Ptr<Node> node = nodes.Get(t->node_id);
+    if(!IsActivated(node)){
+        vector<int> ids;
+        CollectNodes(t, ids);
+        skipped += ids.size();
+        return;
+    }
+    
     for(int8_t i=0;i<t->c_num;i++){
         ConstructVehicleGroup(root, t->child[i], t, nodes,task_id,level+1);
     }
     
-    Ptr<Node> node = nodes.Get(t->node_id);
     Ptr<EvolutionApplication> node_app = DynamicCast<EvolutionApplication>(node->GetApplication(0));
     NeighborInformation leader_info;
     node_app->m_level = level;
@@ -47,6 +60,9 @@ void GroupInitializer::ConstructVehicleGroup(VGTree* root, VGTree* t,VGTree* par
     for(int8_t i=0;i<t->c_num;i++){
         //子结点信息
         Ptr<Node> child_node = nodes.Get(t->child[i]->node_id);
+        if(!IsActivated(child_node)){
+            continue;
+        }
         Ptr<NetDevice> child_dev = child_node->GetDevice(0);
         Ptr<EvolutionApplication> child_app = DynamicCast<EvolutionApplication>(child_node->GetApplication(0));
         NeighborInformation child_info;
@@ -69,14 +85,15 @@ void GroupInitializer::ConstructVehicleGroup(VGTree* root, VGTree* t,VGTree* par
         
     }
 
-    // debug
-    std::cout << t->node_id+1 << ":" << std::endl;
-    node_app->PrintRouter();
+    node_app->LogRouter();
 }
 
 void GroupInitializer::ConstructLinkBetweenGroups(NodeContainer& nodes){
     for(map<int,set<int> >::iterator iter = graph.begin(); iter!=graph.end(); iter++){
         Ptr<Node> node = nodes.Get(iter->first);
+        if(!IsActivated(node)){
+            continue;
+        }
         if(!isLeader(iter->first)){
             NS_FATAL_ERROR ("GroupInitializer::ConstructLinkBetweenGroup()节点不是leader");
         }
@@ -84,6 +101,9 @@ void GroupInitializer::ConstructLinkBetweenGroups(NodeContainer& nodes){
         set<int>& other_leader_ids = iter->second;
         for(set<int>::iterator siter=other_leader_ids.begin();siter!=other_leader_ids.end();siter++){
             Ptr<Node> other_leader = nodes.Get(*siter);
+            if(!IsActivated(other_leader)){
+                continue;
+            }
             Ptr<NetDevice> other_leader_dev = other_leader->GetDevice(0);
             if(!isLeader(*siter)){
                 NS_FATAL_ERROR ("GroupInitializer::ConstructLinkBetweenGroup()节点不是leader");
@@ -102,6 +122,14 @@ void GroupInitializer::ConstructLinkBetweenGroups(NodeContainer& nodes){
     }
 }
 
+bool GroupInitializer::IsActivated(Ptr<Node> node){
+    return node->GetNDevices() > 0;
+}
+
+uint32_t GroupInitializer::GetSkippedCount(){
+    return skipped;
+}
+
 bool GroupInitializer::isLeader(int id){
     for(long unsigned int i=0;i<groups.size();i++){
         if(groups[i]->node_id==id){
@@ -122,10 +150,14 @@ void GroupInitializer::AddLink(int a, int b){
 
 void GroupInitializer::Construct(NodeContainer& nodes){
     uint32_t task_id = 0;
+    skipped = 0;
     for(vector<VGTree*>::iterator iter=groups.begin();iter!=groups.end();iter++){
         ConstructVehicleGroup(*iter,*iter,NULL,nodes,task_id++,1);
     }
     ConstructLinkBetweenGroups(nodes);
+    if(skipped > 0){
+        cout<<"GroupInitializer: "<<skipped<<"个节点还没有出现（延迟激活），没有加入预先建立的车群"<<endl;
+    }
 }
 
 void GroupInitializer::PrintGroupStructures(){
@@ -133,3 +165,83 @@ void GroupInitializer::PrintGroupStructures(){
         VGTreeHelper::PrintTree(*iter);
     }
 }
+
+uint64_t GroupInitializer::GetMemoryBytes(){
+    uint64_t bytes = VectorBytes(groups) + MapBytes(graph);
+    for(vector<VGTree*>::iterator iter=groups.begin();iter!=groups.end();iter++){
+        bytes += VGTreeHelper::GetMemoryBytes(*iter);
+    }
+    for(map<int,set<int> >::iterator iter=graph.begin();iter!=graph.end();iter++){
+        bytes += SetBytes(iter->second);
+    }
+    return bytes;
+}
+
+void GroupInitializer::CollectNodes(VGTree* t, vector<int>& ids){
+    if(!t){
+        return;
+    }
+    ids.push_back(t->node_id);
+    for(int i=0;i<t->c_num;i++){
+        CollectNodes(t->child[i], ids);
+    }
+}
+
+vector<uint32_t> GroupInitializer::Partition(uint32_t n_nodes, uint32_t n_ranks, const vector<Vector>& positions){
+    vector<uint32_t> ranks(n_nodes, 0);
+    if(n_ranks <= 1 || n_nodes == 0){
+        return ranks;
+    }
+    
+    //每个车群是一个划分单元，第一个节点是leader
+    vector< vector<int> > units;
+    vector<bool> grouped(n_nodes, false);
+    for(vector<VGTree*>::iterator iter=groups.begin();iter!=groups.end();iter++){
+        vector<int> ids;
+        CollectNodes(*iter, ids);
+        for(size_t i=0;i<ids.size();i++){
+            grouped[ids[i]] = true;
+        }
+        units.push_back(ids);
+    }
+    for(uint32_t i=0;i<n_nodes;i++){
+        if(!grouped[i]){
+            units.push_back(vector<int>(1, i));
+        }
+    }
+    
+    //沿道路方向排序
+    double min_x = 0, max_x = 0, min_y = 0, max_y = 0;
+    for(size_t i=0;i<positions.size();i++){
+        if(i == 0 || positions[i].x < min_x) min_x = positions[i].x;
+        if(i == 0 || positions[i].x > max_x) max_x = positions[i].x;
+        if(i == 0 || positions[i].y < min_y) min_y = positions[i].y;
+        if(i == 0 || positions[i].y > max_y) max_y = positions[i].y;
+    }
+    bool along_x = max_x - min_x >= max_y - min_y;
+    vector< pair<double, size_t> > order;
+    for(size_t i=0;i<units.size();i++){
+        uint32_t leader = units[i][0];
+        double key = 0;
+        if(leader < positions.size()){
+            key = along_x ? positions[leader].x : positions[leader].y;
+        }
+        order.push_back(make_pair(key, i));
+    }
+    sort(order.begin(), order.end());
+    
+    //按单元中点所在的节点序号连续切分
+    uint32_t assigned = 0;
+    for(size_t i=0;i<order.size();i++){
+        vector<int>& ids = units[order[i].second];
+        uint32_t rank = (uint64_t)(assigned + ids.size() / 2) * n_ranks / n_nodes;
+        if(rank >= n_ranks){
+            rank = n_ranks - 1;
+        }
+        for(size_t j=0;j<ids.size();j++){
+            ranks[ids[j]] = rank;
+        }
+        assigned += ids.size();
+    }
+    return ranks;
+}
@@ -11,10 +11,17 @@ class GroupInitializer{
 private:
     vector<VGTree*> groups;
     map<int,set<int> >graph;
+    uint32_t skipped;//上一次Construct跳过的节点数
     void ConstructVehicleGroup(VGTree* root, VGTree* t,VGTree* parent, NodeContainer& nodes, uint32_t task_id, uint8_t level);
     void ConstructLinkBetweenGroups(NodeContainer& nodes);
     bool isLeader(int id);
+    //节点已经安装了设备，延迟激活时还没有出现的车辆没有设备
+    static bool IsActivated(Ptr<Node> node);
+    //收集以t为根的子树中所有节点编号
+    static void CollectNodes(VGTree* t, vector<int>& ids);
 public:
+    GroupInitializer();
+
     //将一颗VGTree添加到Groupnitialer
     void AddGroup(VGTree* root);
     
@@ -22,9 +29,21 @@ public:
     void AddLink(int a,int b);
     
     //根据Group信息和Link信息
+    //需要在ScenarioHelper::Install之后调用，还没有出现的车辆（延迟激活）和它们的子树被跳过
     void Construct(NodeContainer& nodes);
+
+    //上一次Construct跳过的还没有出现的节点数
+    uint32_t GetSkippedCount();
     
     //打印所有group的树状结构
     void PrintGroupStructures();
+
+    //车群树和车群之间的连接占用的内存 单位byte
+    uint64_t GetMemoryBytes();
+    
+    //分布式仿真时把节点划分到n_ranks个进程，返回每个节点所在的进程，需要在创建节点之前调用
+    //同一车群的节点在同一个进程，车群内的通信不跨进程；不在车群中的车辆单独划分
+    //车群按leader沿道路方向（初始位置分布较广的坐标轴）排序后连续切分，相邻路段在同一进程，各进程节点数大致相同
+    vector<uint32_t> Partition(uint32_t n_nodes, uint32_t n_ranks, const vector<Vector>& positions);
 };
 #endif
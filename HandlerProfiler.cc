@@ -0,0 +1,195 @@
+#include "ns3/log.h"
+#include "HandlerProfiler.h"
+#include <fstream>
+
+NS_LOG_COMPONENT_DEFINE("HandlerProfiler");
+
+NS_OBJECT_ENSURE_REGISTERED(ProfilingScheduler);
+
+int64_t HandlerProfiler::s_queue_depth = 0;
+
+TypeId ProfilingScheduler::GetTypeId()
+{
+    static TypeId tid = TypeId("ns3::ProfilingScheduler")
+                .SetParent <MapScheduler> ()
+                .AddConstructor<ProfilingScheduler> ();
+    return tid;
+}
+
+void ProfilingScheduler::Insert(const Scheduler::Event& ev){
+    HandlerProfiler::s_queue_depth++;
+    MapScheduler::Insert(ev);
+}
+
+Scheduler::Event ProfilingScheduler::RemoveNext(){
+    HandlerProfiler::s_queue_depth--;
+    return MapScheduler::RemoveNext();
+}
+
+void ProfilingScheduler::Remove(const Scheduler::Event& ev){
+    HandlerProfiler::s_queue_depth--;
+    MapScheduler::Remove(ev);
+}
+
+HandlerProfiler* HandlerProfiler::Get(){
+    static HandlerProfiler profiler;
+    return &profiler;
+}
+
+HandlerProfiler::HandlerProfiler(){
+    m_enabled = false;
+}
+
+bool HandlerProfiler::Open(string path, Time sample_interval){
+    if(m_enabled){
+        NS_LOG_ERROR("HandlerProfiler已经打开");
+        return false;
+    }
+    m_path = path;
+    m_sample_interval = sample_interval;
+    m_nodes.clear();
+    m_children.clear();
+    m_stack.clear();
+    m_samples.clear();
+
+    StackNode root;
+    root.parent = 0;
+    root.name = "";
+    root.calls = 0;
+    root.total_ns = 0;
+    root.self_ns = 0;
+    m_nodes.push_back(root);
+
+    //替换调度器以统计队列长度，已经调度的事件会转移到新的调度器中
+    s_queue_depth = 0;
+    Simulator::SetScheduler(ObjectFactory("ns3::ProfilingScheduler"));
+    //墙上时间从Simulator::Run开始到Simulator::Destroy为止，不包括建立场景的时间
+    Simulator::ScheduleNow(&HandlerProfiler::Start, this);
+    Simulator::ScheduleDestroy(&HandlerProfiler::Finish, this);
+
+    m_open_time = Clock::now();
+    m_close_time = m_open_time;
+    m_finished = false;
+    m_enabled = true;
+    return true;
+}
+
+void HandlerProfiler::Enter(const char* name){
+    uint32_t parent = m_stack.empty() ? 0 : m_stack.back().node;
+    pair<uint32_t, const char*> key(parent, name);
+    map< pair<uint32_t, const char*>, uint32_t >::iterator iter = m_children.find(key);
+    uint32_t node;
+    if(iter == m_children.end()){
+        StackNode n;
+        n.parent = parent;
+        n.name = name;
+        n.calls = 0;
+        n.total_ns = 0;
+        n.self_ns = 0;
+        node = m_nodes.size();
+        m_nodes.push_back(n);
+        m_children[key] = node;
+    }
+    else{
+        node = iter->second;
+    }
+    Frame frame;
+    frame.node = node;
+    frame.child_ns = 0;
+    frame.start = Clock::now();
+    m_stack.push_back(frame);
+}
+
+void HandlerProfiler::Leave(){
+    if(m_stack.empty()){
+        return;
+    }
+    Frame& frame = m_stack.back();
+    int64_t elapsed = chrono::duration_cast<chrono::nanoseconds>(Clock::now() - frame.start).count();
+    StackNode& node = m_nodes[frame.node];
+    node.calls++;
+    node.total_ns += elapsed;
+    node.self_ns += elapsed - frame.child_ns;
+    m_stack.pop_back();
+    if(!m_stack.empty()){
+        m_stack.back().child_ns += elapsed;
+    }
+}
+
+void HandlerProfiler::Start(){
+    m_open_time = Clock::now();
+    if(m_sample_interval.IsStrictlyPositive()){
+        SampleQueue();
+    }
+}
+
+void HandlerProfiler::Finish(){
+    m_close_time = Clock::now();
+    m_finished = true;
+}
+
+void HandlerProfiler::SampleQueue(){
+    if(!m_enabled){
+        return;
+    }
+    QueueSample sample;
+    sample.sim_time_s = Simulator::Now().GetSeconds();
+    sample.queue_depth = s_queue_depth;
+    sample.events = Simulator::GetEventCount();
+    sample.wall_s = chrono::duration<double>(Clock::now() - m_open_time).count();
+    m_samples.push_back(sample);
+    Simulator::Schedule(m_sample_interval, &HandlerProfiler::SampleQueue, this);
+}
+
+string HandlerProfiler::GetStackName(uint32_t node){
+    string name;
+    while(node != 0){
+        name = m_nodes[node].name + (name.empty() ? "" : ";" + name);
+        node = m_nodes[node].parent;
+    }
+    return name;
+}
+
+void HandlerProfiler::Close(){
+    if(!m_enabled){
+        return;
+    }
+    m_enabled = false;
+    if(!m_finished){
+        Finish();
+    }
+    int64_t wall_ns = chrono::duration_cast<chrono::nanoseconds>(m_close_time - m_open_time).count();
+
+    //没有放在任何作用域里的时间
+    int64_t attributed = 0;
+    for(uint32_t i = 1; i < m_nodes.size(); i++){
+        if(m_nodes[i].parent == 0){
+            attributed += m_nodes[i].total_ns;
+        }
+    }
+
+    ofstream folded(m_path.c_str());
+    ofstream summary((m_path + ".summary").c_str());
+    ofstream queue((m_path + ".queue").c_str());
+    if(!folded.is_open() || !summary.is_open() || !queue.is_open()){
+        NS_LOG_ERROR("无法写入 " << m_path);
+        return;
+    }
+    summary<<"stack\tcalls\ttotal_us\tself_us"<<endl;
+    for(uint32_t i = 1; i < m_nodes.size(); i++){
+        string name = GetStackName(i);
+        if(m_nodes[i].self_ns >= 1000){
+            folded<<name<<" "<<m_nodes[i].self_ns / 1000<<endl;
+        }
+        summary<<name<<"\t"<<m_nodes[i].calls<<"\t"<<m_nodes[i].total_ns / 1000<<"\t"<<m_nodes[i].self_ns / 1000<<endl;
+    }
+    if(wall_ns > attributed){
+        folded<<"[other] "<<(wall_ns - attributed) / 1000<<endl;
+        summary<<"[other]\t0\t"<<(wall_ns - attributed) / 1000<<"\t"<<(wall_ns - attributed) / 1000<<endl;
+    }
+
+    queue<<"sim_time_s\tqueue_depth\tevents\twall_s"<<endl;
+    for(size_t i = 0; i < m_samples.size(); i++){
+        queue<<m_samples[i].sim_time_s<<"\t"<<m_samples[i].queue_depth<<"\t"<<m_samples[i].events<<"\t"<<m_samples[i].wall_s<<endl;
+    }
+}
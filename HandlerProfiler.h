@@ -0,0 +1,148 @@
+#ifndef HANDLER_PROFILER_H
+#define HANDLER_PROFILER_H
+
+#include "ns3/core-module.h"
+#include "ns3/map-scheduler.h"
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+
+using namespace ns3;
+using namespace std;
+
+/*
+ * 事件处理函数的性能分析，统计仿真的墙上时间花在哪些协议处理函数上
+ * 在处理函数开头放PROFILE_SCOPE("名字")，嵌套的作用域组成调用栈，
+ * 每个栈记录调用次数和自身时间（不含子作用域），没有放在任何作用域里的时间（PHY、信道、移动模型、调度器）记为"[other]"
+ * 另外按仿真时间周期性采样事件队列的长度
+ * 输出：
+ *   <path>         折叠栈格式，每行"a;b;c 自身时间us"，可以直接用flamegraph.pl画火焰图
+ *   <path>.summary 每个栈的调用次数、总时间和自身时间
+ *   <path>.queue   仿真时间、事件队列长度、已执行的事件数、墙上时间
+ * 没有打开时每个作用域只有一次分支判断
+ */
+class HandlerProfiler{
+public:
+    //全局唯一的实例
+    static HandlerProfiler* Get();
+
+    //开始分析，需要在Simulator::Run之前调用，sample_interval为队列长度的采样周期（仿真时间）
+    bool Open(string path, Time sample_interval);
+
+    //写出结果，仿真结束后调用
+    void Close();
+
+    bool IsEnabled(){
+        return m_enabled;
+    }
+
+    //输出文件的路径，没有打开时为空
+    string GetPath(){
+        return m_enabled ? m_path : "";
+    }
+
+    //修改输出文件的路径，在Close时生效，用于fork出的分支写自己的结果
+    void SetPath(string path){
+        m_path = path;
+    }
+
+    //进入一个作用域，name需要在整个仿真期间有效（字符串常量或MessageTypeName的返回值）
+    void Enter(const char* name);
+
+    //离开当前作用域
+    void Leave();
+
+    //事件队列长度，由ProfilingScheduler维护
+    static int64_t s_queue_depth;
+
+private:
+    typedef chrono::steady_clock Clock;
+
+    //调用栈树的一个节点，节点0为根
+    typedef struct{
+        uint32_t parent;
+        const char* name;
+        uint64_t calls;
+        int64_t total_ns;
+        int64_t self_ns;
+    } StackNode;
+
+    //当前调用栈中的一层
+    typedef struct{
+        uint32_t node;
+        Clock::time_point start;
+        int64_t child_ns;//子作用域的总时间
+    } Frame;
+
+    //队列长度的一次采样
+    typedef struct{
+        double sim_time_s;
+        int64_t queue_depth;
+        uint64_t events;
+        double wall_s;
+    } QueueSample;
+
+    HandlerProfiler();
+
+    //Simulator::Run开始时调用，开始计时和采样
+    void Start();
+
+    //Simulator::Destroy时调用，停止计时
+    void Finish();
+
+    void SampleQueue();
+
+    //从根到node的名字，用";"连接
+    string GetStackName(uint32_t node);
+
+    bool m_enabled;
+    string m_path;
+    Time m_sample_interval;
+    Clock::time_point m_open_time;
+    Clock::time_point m_close_time;
+    bool m_finished;
+
+    vector<StackNode> m_nodes;
+    map< pair<uint32_t, const char*>, uint32_t > m_children;//(父节点, 名字) -> 子节点
+    vector<Frame> m_stack;
+    vector<QueueSample> m_samples;
+};
+
+//在作用域结束时自动调用Leave
+class ProfileScope{
+public:
+    ProfileScope(const char* name){
+        m_active = HandlerProfiler::Get()->IsEnabled();
+        if(m_active){
+            HandlerProfiler::Get()->Enter(name);
+        }
+    }
+    ~ProfileScope(){
+        if(m_active){
+            HandlerProfiler::Get()->Leave();
+        }
+    }
+private:
+    bool m_active;
+};
+
+#define PROFILE_SCOPE_CONCAT2(a, b) a##b
+#define PROFILE_SCOPE_CONCAT(a, b) PROFILE_SCOPE_CONCAT2(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_SCOPE_CONCAT(profile_scope_, __LINE__)(name)
+
+/*
+ * 在默认的MapScheduler上统计事件队列的长度
+ * Cancel的事件在执行时间到达前仍在队列中，也计入长度
+ */
+class ProfilingScheduler : public MapScheduler{
+public:
+    static TypeId GetTypeId();
+
+    virtual void Insert(const Scheduler::Event& ev);
+    virtual Scheduler::Event RemoveNext();
+    virtual void Remove(const Scheduler::Event& ev);
+};
+
+#endif
@@ -0,0 +1,111 @@
+#include "ns3/node-list.h"
+#include "ns3/node.h"
+#include "ns3/mobility-model.h"
+#include "ns3/simulator.h"
+#include "HazardStats.h"
+#include "LatencyStats.h"
+#include "MemoryAccounting.h"
+#include <cmath>
+
+HazardKey MakeHazardKey(const Vector& pos){
+    return make_pair((int64_t)floor(pos.x + 0.5), (int64_t)floor(pos.y + 0.5));
+}
+
+HazardStats* HazardStats::Get(){
+    static HazardStats stats;
+    return &stats;
+}
+
+HazardStats::HazardStats(){
+}
+
+void HazardStats::StartHazard(const Vector& pos, double radius, uint32_t node_id){
+    HazardKey key = MakeHazardKey(pos);
+    if(m_hazards.find(key) == m_hazards.end()){
+        HazardRecord& record = m_hazards[key];
+        record.pos = pos;
+        record.radius = radius;
+        record.start = Simulator::Now();
+        record.transmissions = 0;
+        //还没有出现（没有设备）的车辆和分布式仿真时其它进程的车辆不计入
+        for(NodeList::Iterator iter = NodeList::Begin(); iter != NodeList::End(); iter++){
+            Ptr<Node> node = *iter;
+            Ptr<MobilityModel> mobility = node->GetObject<MobilityModel>();
+            if(!mobility || node->GetNDevices() == 0 || node->GetNApplications() == 0
+               || node->GetSystemId() != Simulator::GetSystemId()){
+                continue;
+            }
+            if(CalculateDistance(mobility->GetPosition(), pos) <= radius){
+                record.eligible.insert(node->GetId());
+            }
+        }
+    }
+    RecordWarned(pos, node_id);
+}
+
+void HazardStats::RecordWarned(const Vector& pos, uint32_t node_id){
+    map<HazardKey, HazardRecord>::iterator iter = m_hazards.find(MakeHazardKey(pos));
+    if(iter == m_hazards.end()){
+        return;
+    }
+    if(iter->second.warned.insert(node_id).second){
+        LatencyStats::Get()->RecordFlow("hazard_warning", Simulator::Now() - iter->second.start);
+    }
+}
+
+void HazardStats::RecordTransmission(const Vector& pos){
+    map<HazardKey, HazardRecord>::iterator iter = m_hazards.find(MakeHazardKey(pos));
+    if(iter != m_hazards.end()){
+        iter->second.transmissions++;
+    }
+}
+
+double HazardStats::GetCoverage(const HazardRecord& record){
+    if(record.eligible.empty()){
+        return 1;
+    }
+    uint32_t covered = 0;
+    for(set<uint32_t>::const_iterator iter = record.eligible.begin(); iter != record.eligible.end(); iter++){
+        covered += record.warned.count(*iter);
+    }
+    return (double)covered / record.eligible.size();
+}
+
+void HazardStats::Print(ostream& os){
+    if(m_hazards.empty()){
+        return;
+    }
+    os<<"避障警告: 位置 发现时间(s) 区域内车辆 覆盖率 收到警告的车辆 帧数"<<endl;
+    for(map<HazardKey, HazardRecord>::iterator iter = m_hazards.begin(); iter != m_hazards.end(); iter++){
+        const HazardRecord& record = iter->second;
+        os<<"  ("<<iter->first.first<<","<<iter->first.second<<") "<<record.start.GetSeconds()<<" "
+          <<record.eligible.size()<<" "<<GetCoverage(record)<<" "<<record.warned.size()<<" "<<record.transmissions<<endl;
+    }
+}
+
+void HazardStats::GetMetrics(vector< pair<string, double> >& metrics){
+    if(m_hazards.empty()){
+        return;
+    }
+    double coverage_sum = 0;
+    double coverage_min = 1;
+    double tx_sum = 0;
+    for(map<HazardKey, HazardRecord>::iterator iter = m_hazards.begin(); iter != m_hazards.end(); iter++){
+        double coverage = GetCoverage(iter->second);
+        coverage_sum += coverage;
+        coverage_min = min(coverage_min, coverage);
+        tx_sum += iter->second.transmissions;
+    }
+    metrics.push_back(make_pair("hazards", (double)m_hazards.size()));
+    metrics.push_back(make_pair("hazard_coverage_mean", coverage_sum / m_hazards.size()));
+    metrics.push_back(make_pair("hazard_coverage_min", coverage_min));
+    metrics.push_back(make_pair("hazard_tx_mean", tx_sum / m_hazards.size()));
+}
+
+uint64_t HazardStats::GetMemoryBytes(){
+    uint64_t bytes = MapBytes(m_hazards);
+    for(map<HazardKey, HazardRecord>::iterator iter = m_hazards.begin(); iter != m_hazards.end(); iter++){
+        bytes += SetBytes(iter->second.eligible) + SetBytes(iter->second.warned);
+    }
+    return bytes;
+}
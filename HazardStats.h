@@ -0,0 +1,66 @@
+#ifndef HAZARD_STATS_H
+#define HAZARD_STATS_H
+
+#include "ns3/nstime.h"
+#include "ns3/vector.h"
+#include <stdint.h>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include <ostream>
+
+using namespace ns3;
+using namespace std;
+
+//危险按位置（取整到1m）区分，同一个障碍物被多辆车发现时是同一个危险
+typedef pair<int64_t, int64_t> HazardKey;
+
+HazardKey MakeHazardKey(const Vector& pos);
+
+//一个危险的传播情况
+typedef struct{
+    Vector pos;
+    double radius;//目标区域的半径 单位m
+    Time start;//第一次被发现的时间
+    set<uint32_t> eligible;//发现时在目标区域内的车辆（已经安装设备的本进程节点）
+    set<uint32_t> warned;//收到警告（或自己发现）的车辆，可以在目标区域外
+    uint64_t transmissions;//交给设备的携带这个危险的帧数，树模式下包括转发和重传，不含确认
+} HazardRecord;
+
+/*
+ * 统计避障警告的覆盖率和开销，与传播方式（沿车群树或地理广播）无关，用于比较两种方式
+ * 覆盖率为发现时在目标区域内的车辆中收到警告的比例，之后才进入区域的车辆不计入
+ * 收到警告的时延（从第一次发现开始）记为LatencyStats的"hazard_warning"
+ */
+class HazardStats{
+public:
+    static HazardStats* Get();
+
+    //发现一个危险，已经记录过的危险只把发现者记为收到警告
+    void StartHazard(const Vector& pos, double radius, uint32_t node_id);
+
+    //车辆收到一个危险的警告，每辆车只记录第一次
+    void RecordWarned(const Vector& pos, uint32_t node_id);
+
+    //一帧携带这个危险的消息交给了设备
+    void RecordTransmission(const Vector& pos);
+
+    //每个危险一行：位置、目标区域内车辆数、覆盖率、帧数
+    void Print(ostream& os);
+
+    //输出hazards、hazard_coverage_mean/min和hazard_tx_mean，供ScenarioHelper::WriteMetrics写出
+    void GetMetrics(vector< pair<string, double> >& metrics);
+
+    uint64_t GetMemoryBytes();
+
+private:
+    HazardStats();
+
+    //目标区域内收到警告的比例，区域内没有车辆时为1
+    static double GetCoverage(const HazardRecord& record);
+
+    map<HazardKey, HazardRecord> m_hazards;
+};
+
+#endif
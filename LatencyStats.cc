@@ -0,0 +1,204 @@
+#include "LatencyStats.h"
+#include "MessageHeader.h"
+#include <cstring>
+#include <sstream>
+#include <algorithm>
+
+LatencyHistogram::LatencyHistogram(){
+    memset(m_counts, 0, sizeof(m_counts));
+    m_total = 0;
+    m_min = 0;
+    m_max = 0;
+}
+
+uint32_t LatencyHistogram::GetIndex(int64_t ns){
+    if(ns < 0){
+        ns = 0;
+    }
+    if(ns >= ((int64_t)1 << LATENCY_MAX_BITS)){
+        ns = ((int64_t)1 << LATENCY_MAX_BITS) - 1;
+    }
+    if(ns < LATENCY_SUB_BUCKETS){
+        return ns;
+    }
+    //最高位的位置决定区间，右移后保留LATENCY_SUB_BITS位
+    uint32_t msb = 63 - __builtin_clzll(ns);
+    uint32_t shift = msb - LATENCY_SUB_BITS + 1;
+    return shift * (LATENCY_SUB_BUCKETS / 2) + (ns >> shift);
+}
+
+int64_t LatencyHistogram::GetUpperBound(uint32_t index){
+    if(index < LATENCY_SUB_BUCKETS){
+        return index;
+    }
+    uint32_t shift = index / (LATENCY_SUB_BUCKETS / 2) - 1;
+    int64_t sub = index - shift * (LATENCY_SUB_BUCKETS / 2);
+    return ((sub + 1) << shift) - 1;
+}
+
+void LatencyHistogram::Record(int64_t ns){
+    m_counts[GetIndex(ns)]++;
+    if(m_total == 0 || ns < m_min){
+        m_min = ns;
+    }
+    if(m_total == 0 || ns > m_max){
+        m_max = ns;
+    }
+    m_total++;
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram& other){
+    if(other.m_total == 0){
+        return;
+    }
+    for(uint32_t i = 0; i < LATENCY_BUCKETS; i++){
+        m_counts[i] += other.m_counts[i];
+    }
+    if(m_total == 0 || other.m_min < m_min){
+        m_min = other.m_min;
+    }
+    if(m_total == 0 || other.m_max > m_max){
+        m_max = other.m_max;
+    }
+    m_total += other.m_total;
+}
+
+uint64_t LatencyHistogram::GetCount() const{
+    return m_total;
+}
+
+int64_t LatencyHistogram::GetMin() const{
+    return m_min;
+}
+
+int64_t LatencyHistogram::GetMax() const{
+    return m_max;
+}
+
+int64_t LatencyHistogram::GetPercentile(double p) const{
+    if(m_total == 0){
+        return 0;
+    }
+    //第rank个值所在的区间，rank从1开始
+    uint64_t rank = (uint64_t)(p * m_total + 0.5);
+    if(rank < 1){
+        rank = 1;
+    }
+    uint64_t seen = 0;
+    for(uint32_t i = 0; i < LATENCY_BUCKETS; i++){
+        seen += m_counts[i];
+        if(seen >= rank){
+            return min(GetUpperBound(i), m_max);
+        }
+    }
+    return m_max;
+}
+
+LatencyStats* LatencyStats::Get(){
+    static LatencyStats stats;
+    return &stats;
+}
+
+LatencyStats::LatencyStats(){
+    memset(m_delivery, 0, sizeof(m_delivery));
+}
+
+void LatencyStats::RecordDelivery(uint8_t type, uint8_t hops, Time latency){
+    type &= ~GROUP_MESSAGE;
+    if(type >= LATENCY_MAX_TYPES){
+        return;
+    }
+    if(hops < 1){
+        hops = 1;
+    }
+    if(hops > LATENCY_MAX_HOPS){
+        hops = LATENCY_MAX_HOPS;
+    }
+    LatencyHistogram*& h = m_delivery[type][hops - 1];
+    if(!h){
+        h = new LatencyHistogram();
+    }
+    h->Record(latency.GetNanoSeconds());
+}
+
+void LatencyStats::RecordFlow(string name, Time latency){
+    LatencyHistogram*& h = m_flows[name];
+    if(!h){
+        h = new LatencyHistogram();
+    }
+    h->Record(latency.GetNanoSeconds());
+}
+
+void LatencyStats::RecordQueueDelay(Ptr<const Packet> packet, Time delay){
+    static const string names[MESSAGE_CLASS_COUNT] = {"queue_safety", "queue_control", "queue_beacon"};
+    MessageHeader tag;
+    if(!packet->PeekPacketTag(tag)){
+        return;
+    }
+    uint8_t cls = MessageClass(tag.GetType() & ~GROUP_MESSAGE);
+    if(cls < MESSAGE_CLASS_COUNT){
+        RecordFlow(names[cls], delay);
+    }
+}
+
+void LatencyStats::Collect(vector< pair<string, const LatencyHistogram*> >& out){
+    m_merged.clear();
+    for(uint8_t type = 0; type < LATENCY_MAX_TYPES; type++){
+        uint32_t used = 0;
+        LatencyHistogram* all = NULL;
+        for(uint8_t hop = 0; hop < LATENCY_MAX_HOPS; hop++){
+            if(!m_delivery[type][hop]){
+                continue;
+            }
+            ostringstream name;
+            name<<MessageTypeName(type)<<"_hop"<<(int)(hop + 1);
+            if(hop + 1 == LATENCY_MAX_HOPS){
+                name<<"+";
+            }
+            out.push_back(make_pair(name.str(), m_delivery[type][hop]));
+            //所有跳数合并后的直方图
+            if(!all){
+                all = &m_merged[string(MessageTypeName(type)) + "_all"];
+            }
+            all->Merge(*m_delivery[type][hop]);
+            used++;
+        }
+        if(used == 1){
+            m_merged.erase(string(MessageTypeName(type)) + "_all");
+        }
+    }
+    for(map<string, LatencyHistogram>::iterator iter = m_merged.begin(); iter != m_merged.end(); iter++){
+        out.push_back(make_pair(iter->first, &iter->second));
+    }
+    for(map<string, LatencyHistogram*>::iterator iter = m_flows.begin(); iter != m_flows.end(); iter++){
+        out.push_back(make_pair(iter->first, iter->second));
+    }
+    sort(out.begin(), out.end());
+}
+
+void LatencyStats::Print(ostream& os){
+    vector< pair<string, const LatencyHistogram*> > hists;
+    Collect(hists);
+    if(hists.empty()){
+        return;
+    }
+    os<<"消息时延(us): 名称 次数 最小 p50 p99 p999 最大"<<endl;
+    for(size_t i = 0; i < hists.size(); i++){
+        const LatencyHistogram* h = hists[i].second;
+        os<<"  "<<hists[i].first<<" "<<h->GetCount()<<" "<<h->GetMin() / 1e3<<" "<<h->GetPercentile(0.5) / 1e3
+          <<" "<<h->GetPercentile(0.99) / 1e3<<" "<<h->GetPercentile(0.999) / 1e3<<" "<<h->GetMax() / 1e3<<endl;
+    }
+}
+
+void LatencyStats::GetMetrics(vector< pair<string, double> >& metrics){
+    vector< pair<string, const LatencyHistogram*> > hists;
+    Collect(hists);
+    for(size_t i = 0; i < hists.size(); i++){
+        string prefix = "latency_" + hists[i].first;
+        const LatencyHistogram* h = hists[i].second;
+        metrics.push_back(make_pair(prefix + "_count", (double)h->GetCount()));
+        metrics.push_back(make_pair(prefix + "_p50_us", h->GetPercentile(0.5) / 1e3));
+        metrics.push_back(make_pair(prefix + "_p99_us", h->GetPercentile(0.99) / 1e3));
+        metrics.push_back(make_pair(prefix + "_p999_us", h->GetPercentile(0.999) / 1e3));
+    }
+}
@@ -0,0 +1,90 @@
+#ifndef LATENCY_STATS_H
+#define LATENCY_STATS_H
+
+#include "ns3/nstime.h"
+#include "ns3/packet.h"
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <ostream>
+
+using namespace ns3;
+using namespace std;
+
+/*
+ * 定长内存的对数-线性直方图（HDR风格），记录单位为ns
+ * 每个2的幂区间再等分为LATENCY_SUB_BUCKETS/2个子区间，相对误差不超过2/LATENCY_SUB_BUCKETS
+ * 不同节点、不同进程的直方图可以直接相加合并
+ */
+const uint32_t LATENCY_SUB_BITS = 7;//子区间数为2^7，相对误差约1.6%
+const uint32_t LATENCY_SUB_BUCKETS = 1 << LATENCY_SUB_BITS;
+const uint32_t LATENCY_MAX_BITS = 42;//最大约73分钟，更大的值记在最后一个区间
+const uint32_t LATENCY_BUCKETS = (LATENCY_MAX_BITS - LATENCY_SUB_BITS + 2) * (LATENCY_SUB_BUCKETS / 2);
+
+class LatencyHistogram{
+public:
+    LatencyHistogram();
+
+    void Record(int64_t ns);
+
+    //把另一个直方图的计数加到本直方图上
+    void Merge(const LatencyHistogram& other);
+
+    uint64_t GetCount() const;
+    int64_t GetMin() const;
+    int64_t GetMax() const;
+
+    //第p分位数（0<p<=1），返回所在区间的上界 单位ns
+    int64_t GetPercentile(double p) const;
+
+private:
+    static uint32_t GetIndex(int64_t ns);
+    //区间index中最大的值
+    static int64_t GetUpperBound(uint32_t index);
+
+    uint64_t m_counts[LATENCY_BUCKETS];
+    uint64_t m_total;
+    int64_t m_min;
+    int64_t m_max;
+};
+
+const uint8_t LATENCY_MAX_HOPS = 16;//跳数大于等于16的记在一起
+const uint8_t LATENCY_MAX_TYPES = 32;//统计的消息类型数，类型编号不能超过这个值
+
+/*
+ * 协议消息的时延统计，所有节点记录到同一组直方图中
+ * 单程时延按消息类型和跳数分别统计，时延为收到时间减去消息头的时间戳（消息产生的时间，转发时不变）
+ * 往返时延等流程时延按名字统计
+ */
+class LatencyStats{
+public:
+    static LatencyStats* Get();
+
+    //收到一条消息，type不含GROUP_MESSAGE标志，hops为经过的跳数（至少为1）
+    void RecordDelivery(uint8_t type, uint8_t hops, Time latency);
+
+    //记录一次流程时延，例如"construct_round_trip"
+    void RecordFlow(string name, Time latency);
+
+    //记录一帧在设备发送队列中的时延，按帧中MessageHeader的消息类别记为"queue_safety"等，没有MessageHeader的帧不记录
+    void RecordQueueDelay(Ptr<const Packet> packet, Time delay);
+
+    //打印各直方图的p50/p99/p999
+    void Print(ostream& os);
+
+    //输出形如"latency_OBSTACLE_MESSAGE_hop2_p99_us"的指标，供ScenarioHelper::WriteMetrics写出
+    void GetMetrics(vector< pair<string, double> >& metrics);
+
+private:
+    LatencyStats();
+
+    //名字和直方图，按名字排序
+    void Collect(vector< pair<string, const LatencyHistogram*> >& out);
+
+    LatencyHistogram* m_delivery[LATENCY_MAX_TYPES][LATENCY_MAX_HOPS];//[消息类型][跳数-1]，用到时才分配
+    map<string, LatencyHistogram*> m_flows;
+    map<string, LatencyHistogram> m_merged;//各消息类型所有跳数合并后的直方图，输出时生成
+};
+
+#endif
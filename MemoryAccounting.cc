@@ -0,0 +1,141 @@
+#include "MemoryAccounting.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+//替换全局的operator new/delete以统计分配次数，TraceRecorder的后台线程也会分配，所以用原子变量
+static std::atomic<uint64_t> g_heap_allocations(0);
+
+static void* CountedAllocate(size_t size){
+    g_heap_allocations.fetch_add(1, std::memory_order_relaxed);
+    return malloc(size > 0 ? size : 1);
+}
+
+void* operator new(size_t size){
+    void* p = CountedAllocate(size);
+    if(p == NULL){
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void* operator new[](size_t size){
+    void* p = CountedAllocate(size);
+    if(p == NULL){
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept{
+    return CountedAllocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept{
+    return CountedAllocate(size);
+}
+
+void operator delete(void* p) noexcept{
+    free(p);
+}
+
+void operator delete[](void* p) noexcept{
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept{
+    free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept{
+    free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept{
+    free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept{
+    free(p);
+}
+
+uint64_t GetHeapAllocationCount(){
+    return g_heap_allocations.load(std::memory_order_relaxed);
+}
+
+MemoryReport::MemoryReport(){
+    m_nodes = 0;
+    m_node_total = 0;
+    m_node_max = 0;
+}
+
+void MemoryReport::AddNode(const MemoryUsage& usage){
+    uint64_t node_bytes = 0;
+    for(MemoryUsage::const_iterator iter = usage.begin(); iter != usage.end(); iter++){
+        StructureStats& stats = m_structures[iter->first];//新的元素初始化为0
+        stats.total += iter->second;
+        if(iter->second > stats.max){
+            stats.max = iter->second;
+        }
+        node_bytes += iter->second;
+    }
+    m_nodes++;
+    m_node_total += node_bytes;
+    if(node_bytes > m_node_max){
+        m_node_max = node_bytes;
+    }
+}
+
+void MemoryReport::AddShared(string name, uint64_t bytes){
+    m_shared[name] += bytes;
+}
+
+uint32_t MemoryReport::GetNodeCount(){
+    return m_nodes;
+}
+
+uint64_t MemoryReport::GetTotalBytes(){
+    uint64_t total = m_node_total;
+    for(map<string, uint64_t>::iterator iter = m_shared.begin(); iter != m_shared.end(); iter++){
+        total += iter->second;
+    }
+    return total;
+}
+
+double MemoryReport::GetMeanNodeBytes(){
+    return m_nodes > 0 ? (double)m_node_total / m_nodes : 0;
+}
+
+uint64_t MemoryReport::GetMaxNodeBytes(){
+    return m_node_max;
+}
+
+void MemoryReport::Print(ostream& os){
+    if(m_nodes == 0 && m_shared.empty()){
+        return;
+    }
+    os<<"协议内存(byte): 数据结构 每节点平均 每节点最大 总量"<<endl;
+    for(map<string, StructureStats>::iterator iter = m_structures.begin(); iter != m_structures.end(); iter++){
+        os<<"  "<<iter->first<<" "<<(uint64_t)((double)iter->second.total / m_nodes + 0.5)
+          <<" "<<iter->second.max<<" "<<iter->second.total<<endl;
+    }
+    os<<"  [节点合计] "<<(uint64_t)(GetMeanNodeBytes() + 0.5)<<" "<<m_node_max<<" "<<m_node_total<<endl;
+    for(map<string, uint64_t>::iterator iter = m_shared.begin(); iter != m_shared.end(); iter++){
+        os<<"  "<<iter->first<<"(共享) - - "<<iter->second<<endl;
+    }
+    os<<"  总计 "<<GetTotalBytes()<<" byte，"<<m_nodes<<" 个节点"<<endl;
+}
+
+void MemoryReport::GetMetrics(vector< pair<string, double> >& metrics){
+    for(map<string, StructureStats>::iterator iter = m_structures.begin(); iter != m_structures.end(); iter++){
+        string prefix = "mem_" + iter->first;
+        metrics.push_back(make_pair(prefix + "_mean_bytes", m_nodes > 0 ? (double)iter->second.total / m_nodes : 0));
+        metrics.push_back(make_pair(prefix + "_max_bytes", (double)iter->second.max));
+    }
+    for(map<string, uint64_t>::iterator iter = m_shared.begin(); iter != m_shared.end(); iter++){
+        metrics.push_back(make_pair("mem_" + iter->first + "_bytes", (double)iter->second));
+    }
+    metrics.push_back(make_pair("mem_node_mean_bytes", GetMeanNodeBytes()));
+    metrics.push_back(make_pair("mem_node_max_bytes", (double)m_node_max));
+    metrics.push_back(make_pair("mem_total_bytes", (double)GetTotalBytes()));
+}
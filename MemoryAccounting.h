@@ -0,0 +1,92 @@
+#ifndef MEMORY_ACCOUNTING_H
+#define MEMORY_ACCOUNTING_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <deque>
+#include <ostream>
+
+using namespace std;
+
+/*
+ * 协议数据结构的内存统计
+ * 各个类按数据结构报告占用的字节数（估计值：容器元素大小加上标准库的节点开销，不含malloc的对齐开销），
+ * 由ScenarioHelper汇总为每个节点的平均值、最大值和总量
+ */
+
+//数据结构名 -> 字节数
+typedef map<string, uint64_t> MemoryUsage;
+
+//libstdc++中map/set每个红黑树节点除元素外的开销（颜色、父节点、左右子节点）
+const uint64_t TREE_NODE_OVERHEAD = 32;
+//libstdc++中unordered_map每个元素除元素外的开销（next指针、缓存的hash），以及每个桶一个指针
+const uint64_t HASH_NODE_OVERHEAD = 16;
+
+//进程启动以来operator new（包括new[]）的调用次数，ns-3库中的分配也计入，直接调用malloc的分配不计入
+//用于统计稳态下每个节点每秒仿真时间的堆分配次数
+uint64_t GetHeapAllocationCount();
+
+template <class T>
+uint64_t VectorBytes(const vector<T>& v){
+    return v.capacity() * sizeof(T);
+}
+
+template <class T>
+uint64_t DequeBytes(const deque<T>& d){
+    return d.size() * sizeof(T);
+}
+
+template <class K, class V>
+uint64_t MapBytes(const map<K, V>& m){
+    return m.size() * (sizeof(typename map<K, V>::value_type) + TREE_NODE_OVERHEAD);
+}
+
+template <class T>
+uint64_t SetBytes(const set<T>& s){
+    return s.size() * (sizeof(T) + TREE_NODE_OVERHEAD);
+}
+
+//汇总所有节点的内存使用
+class MemoryReport{
+public:
+    MemoryReport();
+
+    //加入一个节点的内存使用
+    void AddNode(const MemoryUsage& usage);
+
+    //加入一个不属于某个节点的共享结构（例如信道、GroupInitializer）
+    void AddShared(string name, uint64_t bytes);
+
+    uint32_t GetNodeCount();
+
+    //所有节点和共享结构的总字节数
+    uint64_t GetTotalBytes();
+
+    //每个节点的平均字节数和最大字节数（所有数据结构之和）
+    double GetMeanNodeBytes();
+    uint64_t GetMaxNodeBytes();
+
+    //按数据结构打印每个节点的平均值、最大值和总量
+    void Print(ostream& os);
+
+    //输出形如"mem_router_mean_bytes"的指标，供ScenarioHelper::WriteMetrics写出
+    void GetMetrics(vector< pair<string, double> >& metrics);
+
+private:
+    //一个数据结构在所有节点上的统计
+    typedef struct{
+        uint64_t total;
+        uint64_t max;
+    } StructureStats;
+
+    uint32_t m_nodes;
+    map<string, StructureStats> m_structures;
+    uint64_t m_node_total;//所有节点的字节数之和
+    uint64_t m_node_max;//单个节点字节数的最大值
+    map<string, uint64_t> m_shared;
+};
+
+#endif
@@ -1,17 +1,123 @@
 #include "MessageHeader.h"
 #include "ns3/log.h"
 #include "ns3/simulator.h"
+#include <cstring>
+#include <cstdlib>
+#include <sstream>
+
+//消息类型数，MessageTypeName和信道分配表的大小
+static const uint8_t MESSAGE_TYPE_COUNT = GEOCAST_MESSAGE + 1;
+const char* MessageTypeName(uint8_t type){
+    static const char* names[] = {
+        "HELLO", "HELLO_R", "CONSTRUCT_MESSAGE", "REPLY_MESSAGE", "COMFIRM_MESSAGE",
+        "ERROR_MESSAGE", "RETURN_MESSAGE", "RECEIVE_MESSAGE", "MISSING_MESSAGE", "SEARCH_MESSAGE",
+        "TRANSFER_MESSAGE", "OBSTACLE_MESSAGE", "ADJUST_MESSAGE", "AVOID_MESSAGE",
+        "CONSTRUCT_REPLY_MESSAGE", "CONSTRUCT_CONFIRM_MESSAGE", "ROUTE_UPDATE_MESSAGE", "GEOCAST_MESSAGE"
+    };
+    if(type < sizeof(names) / sizeof(names[0])){
+        return names[type];
+    }
+    return "UNKNOWN";
+}
+
+uint8_t MessageClass(uint8_t type){
+    switch(type){
+        case OBSTACLE_MESSAGE:
+        case GEOCAST_MESSAGE:
+        case AVOID_MESSAGE:
+        case RECEIVE_MESSAGE://车群命令的确认，目前只有避障命令
+            return MESSAGE_CLASS_SAFETY;
+        case HELLO:
+        case HELLO_R:
+        case CONSTRUCT_MESSAGE:
+            return MESSAGE_CLASS_BEACON;
+        default:
+            return MESSAGE_CLASS_CONTROL;
+    }
+}
+
+const char* MessageClassName(uint8_t cls){
+    static const char* names[] = {"safety", "control", "beacon"};
+    if(cls < MESSAGE_CLASS_COUNT){
+        return names[cls];
+    }
+    return "unknown";
+}
+
+uint8_t MessageClassPriority(uint8_t cls){
+    static const uint8_t priorities[] = {6, 5, 0};
+    if(cls < MESSAGE_CLASS_COUNT){
+        return priorities[cls];
+    }
+    return 0;
+}
+
+//默认心跳、建立广播和地理广播在控制信道，由SetControlChannelMessages修改
+static uint8_t s_message_channels[MESSAGE_TYPE_COUNT] = {
+    MESSAGE_CHANNEL_CCH, MESSAGE_CHANNEL_CCH, MESSAGE_CHANNEL_CCH, MESSAGE_CHANNEL_SCH, MESSAGE_CHANNEL_SCH,
+    MESSAGE_CHANNEL_SCH, MESSAGE_CHANNEL_SCH, MESSAGE_CHANNEL_SCH, MESSAGE_CHANNEL_SCH, MESSAGE_CHANNEL_SCH,
+    MESSAGE_CHANNEL_SCH, MESSAGE_CHANNEL_SCH, MESSAGE_CHANNEL_SCH, MESSAGE_CHANNEL_SCH,
+    MESSAGE_CHANNEL_SCH, MESSAGE_CHANNEL_SCH, MESSAGE_CHANNEL_SCH, MESSAGE_CHANNEL_CCH
+};
+
+uint8_t MessageChannel(uint8_t type){
+    if(type < MESSAGE_TYPE_COUNT){
+        return s_message_channels[type];
+    }
+    return MESSAGE_CHANNEL_SCH;
+}
+
+bool SetControlChannelMessages(const std::string& names){
+    uint8_t channels[MESSAGE_TYPE_COUNT];
+    memset(channels, MESSAGE_CHANNEL_SCH, sizeof(channels));
+    std::istringstream in(names);
+    std::string name;
+    while(std::getline(in, name, ',')){
+        if(name.empty()){
+            continue;
+        }
+        uint8_t type = MESSAGE_TYPE_COUNT;
+        for(uint8_t t = 0; t < MESSAGE_TYPE_COUNT; t++){
+            if(name == MessageTypeName(t)){
+                type = t;
+                break;
+            }
+        }
+        if(type == MESSAGE_TYPE_COUNT){
+            char* end = NULL;
+            long value = strtol(name.c_str(), &end, 10);
+            if(*end != '\0' || value < 0 || value >= MESSAGE_TYPE_COUNT){
+                return false;
+            }
+            type = (uint8_t)value;
+        }
+        channels[type] = MESSAGE_CHANNEL_CCH;
+    }
+    memcpy(s_message_channels, channels, sizeof(channels));
+    return true;
+}
+
+const char* MessageChannelName(uint8_t channel){
+    static const char* names[] = {"cch", "sch"};
+    if(channel < MESSAGE_CHANNEL_COUNT){
+        return names[channel];
+    }
+    return "unknown";
+}
+
 namespace ns3 {
 
 NS_LOG_COMPONENT_DEFINE("MessageHeader");
 NS_OBJECT_ENSURE_REGISTERED (MessageHeader);
 
 MessageHeader::MessageHeader() {
+	memset(m_reserve, 0, sizeof(m_reserve));
 	m_timestamp = Simulator::Now();
 	m_payloadSize = 0;
 }
 
 MessageHeader::MessageHeader(uint8_t type, Address des, Address src) {
+	memset(m_reserve, 0, sizeof(m_reserve));
 	m_type = type;
 	m_timestamp = Simulator::Now();
 	m_payloadSize = 0;
@@ -123,6 +229,14 @@ Address MessageHeader::GetSrcAddr(){
     return m_src;
 }
 
+uint8_t MessageHeader::GetHopCount(){
+    return m_reserve[0];
+}
+
+void MessageHeader::SetHopCount(uint8_t hops){
+    m_reserve[0] = hops;
+}
+
 void MessageHeader::SetType (uint8_t type){
     m_type = type;
 }
@@ -5,6 +5,7 @@
 #include "ns3/vector.h"
 #include "ns3/nstime.h"
 #include "ns3/mac48-address.h"
+#include <string>
 //message type
 const uint8_t HELLO = 0; 
 const uint8_t HELLO_R = 1; 
@@ -22,8 +23,46 @@ const uint8_t ADJUST_MESSAGE = 12;
 const uint8_t AVOID_MESSAGE = 13;
 const uint8_t CONSTRUCT_REPLY_MESSAGE = 14;
 const uint8_t CONSTRUCT_CONFIRM_MESSAGE = 15;
+const uint8_t ROUTE_UPDATE_MESSAGE = 16;
+const uint8_t GEOCAST_MESSAGE = 17;//避障警告的地理广播模式，向危险周围的区域广播，不经过车群树
 const uint8_t GROUP_MESSAGE = 0x80;
 
+//消息类型的名字，用于统计输出，type不含GROUP_MESSAGE标志
+const char* MessageTypeName(uint8_t type);
+
+//消息的优先级类别：安全消息优先于车群控制消息，车群控制消息优先于信标（心跳、建立广播）
+const uint8_t MESSAGE_CLASS_SAFETY = 0;
+const uint8_t MESSAGE_CLASS_CONTROL = 1;
+const uint8_t MESSAGE_CLASS_BEACON = 2;
+const uint8_t MESSAGE_CLASS_COUNT = 3;
+
+//消息类型所属的类别，type不含GROUP_MESSAGE标志
+uint8_t MessageClass(uint8_t type);
+
+//类别的名字，用于统计输出
+const char* MessageClassName(uint8_t cls);
+
+//类别对应的802.11e用户优先级(UP)，由QoS MAC映射到接入类别：安全AC_VO，车群控制AC_VI，信标AC_BE
+uint8_t MessageClassPriority(uint8_t cls);
+
+//多信道模式下消息使用的逻辑信道：信标、建立广播和地理广播在控制信道，组播命令和leader之间的消息在服务信道
+const uint8_t MESSAGE_CHANNEL_CCH = 0;
+const uint8_t MESSAGE_CHANNEL_SCH = 1;
+const uint8_t MESSAGE_CHANNEL_COUNT = 2;
+
+//逻辑信道对应的IEEE 1609.4信道号：CCH为178，SCH使用SCH1(172)
+const uint32_t MESSAGE_CHANNEL_NUMBERS[MESSAGE_CHANNEL_COUNT] = {178, 172};
+
+//消息类型使用的逻辑信道，type不含GROUP_MESSAGE标志
+uint8_t MessageChannel(uint8_t type);
+
+//设置使用控制信道的消息类型，names为","分隔的消息类型名字（见MessageTypeName）或编号，
+//其它类型使用服务信道；有不认识的名字时返回false，信道分配不变
+bool SetControlChannelMessages(const std::string& names);
+
+//逻辑信道的名字，用于统计输出
+const char* MessageChannelName(uint8_t channel);
+
 namespace ns3
 {
 class MessageHeader : public Tag {
@@ -43,19 +82,21 @@ public:
 	uint32_t GetPayloadSize();
 	Address GetDesAddr();
 	Address GetSrcAddr();
+	uint8_t GetHopCount();
 
 	void SetType (uint8_t type);
 	void SetTimestamp (Time t);
 	void SetPayloadSize(uint32_t payloadSize);
 	void SetDesAddr(Address des);
 	void SetSrcAddr(Address src);
+	void SetHopCount(uint8_t hops);
 
 	MessageHeader();
 	MessageHeader(uint8_t type, Address des, Address src);
 	virtual ~MessageHeader();
 private:
 
-	uint8_t m_reserve[3];//保留字段
+	uint8_t m_reserve[3];//保留字段，m_reserve[0]为已经转发的次数
     uint8_t m_type;//消息类型
     Time m_timestamp;//时间戳
     uint32_t m_payloadSize;//载荷大小
@@ -0,0 +1,22 @@
+#include "ns3/mac48-address.h"
+#include "MessageSchema.h"
+
+void AddressToMac(const Address& addr, uint8_t* mac)
+{
+    if(addr.IsInvalid()){
+        memset(mac, 0, sizeof(MacRecord));
+        return;
+    }
+    Mac48Address::ConvertFrom(addr).CopyTo(mac);
+}
+
+Address MacToAddress(const uint8_t* mac)
+{
+    static const uint8_t zero[sizeof(MacRecord)] = {0};
+    if(memcmp(mac, zero, sizeof(zero)) == 0){
+        return Address();
+    }
+    Mac48Address m;
+    m.CopyFrom(mac);
+    return m;
+}
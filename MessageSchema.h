@@ -0,0 +1,155 @@
+#ifndef MESSAGE_SCHEMA_H
+#define MESSAGE_SCHEMA_H
+
+#include "ns3/address.h"
+#include "MessageHeader.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <type_traits>
+
+using namespace ns3;
+
+/*
+ * 消息载荷的编译期描述
+ * 每种载荷结构用MESSAGE_SCHEMA与它的消息类型绑定一次，消息类型、载荷长度都由结构决定，
+ * 发送（EvolutionApplication::MakeMessage）和接收（ReadMessage）不再各自填写和检查长度
+ * 载荷结构和变长部分的项都按字节复制，必须是平凡可复制的标准布局结构：只能包含整数、double、Vector和字节数组，
+ * Address和Time不能按字节复制，线上分别用6字节的mac（AddressToMac）和纳秒数
+ * 没有绑定的结构用于发送或接收、一个类型绑定两种结构时都编译失败
+ * 结构中不能有填充字节，否则未初始化的字节会被发送出去：绑定时用FieldsSize列出结构的全部字段，
+ * 各字段长度之和与sizeof不符（有填充或漏列了字段）时编译失败，对齐产生的空隙用reserved字段补齐；发送前载荷结构都要值初始化（Msg msg = Msg()），reserved为0
+ * 接收缓冲区不保证对齐，载荷按memcpy复制到调用者的结构中，不直接转换指针
+ */
+
+//线上的mac地址，变长载荷中的地址列表由它组成
+typedef struct{
+    uint8_t mac[6];
+} MacRecord;
+
+static_assert(sizeof(MacRecord) == 6, "MacRecord的大小必须为6字节");
+
+//Address与6字节mac的转换，无效的Address为全0
+void AddressToMac(const Address& addr, uint8_t* mac);
+Address MacToAddress(const uint8_t* mac);
+
+//没有变长部分的消息
+struct NoItem{
+};
+
+//结构中所列字段的长度之和，字段用成员指针给出：FieldsSize<Msg>(&Msg::a, &Msg::b)，不列字段时为0
+template <class C>
+constexpr uint32_t FieldsSize(){
+    return 0;
+}
+
+template <class C, class T, class... Rest>
+constexpr uint32_t FieldsSize(T C::*, Rest... rest){
+    return sizeof(T) + FieldsSize<C>(rest...);
+}
+
+//载荷结构Msg绑定到消息类型TYPE，后面可以跟着若干个Item
+//SIZE和ITEM_SIZE为FieldsSize得到的各字段长度之和，载荷中含有double，不能用std::has_unique_object_representations检查填充
+template <class Msg, uint8_t TYPE, uint32_t SIZE, class Item, uint32_t ITEM_SIZE>
+struct MessageLayout{
+    static_assert(std::is_trivially_copyable<Msg>::value && std::is_standard_layout<Msg>::value,
+                  "载荷结构必须能按字节复制，Address和Time换成MacRecord和纳秒数");
+    static_assert(std::is_trivially_copyable<Item>::value && std::is_standard_layout<Item>::value,
+                  "变长部分的项必须能按字节复制");
+    static_assert((TYPE & GROUP_MESSAGE) == 0, "消息类型不能含GROUP_MESSAGE标志");
+    static_assert(std::is_empty<Msg>::value ? SIZE == 0 : sizeof(Msg) == SIZE,
+                  "载荷结构中有填充字节（用reserved字段补齐）或漏列了字段");
+    static_assert(std::is_empty<Item>::value ? ITEM_SIZE == 0 : sizeof(Item) == ITEM_SIZE,
+                  "变长部分的项中有填充字节（用reserved字段补齐）或漏列了字段");
+
+    typedef Item ItemType;
+
+    static constexpr uint8_t Type(){
+        return TYPE;
+    }
+
+    //空结构的sizeof为1，线上长度为0
+    static constexpr uint32_t HeaderSize(){
+        return std::is_empty<Msg>::value ? 0 : sizeof(Msg);
+    }
+
+    static constexpr uint32_t ItemSize(){
+        return std::is_empty<Item>::value ? 0 : sizeof(Item);
+    }
+
+    //带有items项时的载荷长度
+    static constexpr uint32_t Size(uint32_t items){
+        return HeaderSize() + items * ItemSize();
+    }
+};
+
+template <class Msg>
+struct MessageSchema;
+
+//消息类型到载荷结构，保证每个类型只绑定一种结构
+template <uint8_t TYPE>
+struct MessageOfType;
+
+#define MESSAGE_SCHEMA_ITEMS(Msg, TYPE, SIZE, Item, ITEM_SIZE) \
+    template <> struct MessageSchema<Msg> : public MessageLayout<Msg, TYPE, SIZE, Item, ITEM_SIZE>{}; \
+    template <> struct MessageOfType<TYPE>{ typedef Msg type; }
+
+#define MESSAGE_SCHEMA(Msg, TYPE, SIZE) MESSAGE_SCHEMA_ITEMS(Msg, TYPE, SIZE, NoItem, 0)
+
+//载荷中除头部外的项数，长度不是头部加整数个项时返回-1
+template <class Msg>
+int64_t MessageItemCount(uint32_t size){
+    typedef MessageSchema<Msg> Schema;
+    if(size < Schema::HeaderSize()){
+        return -1;
+    }
+    uint32_t rest = size - Schema::HeaderSize();
+    if(Schema::ItemSize() == 0){
+        return rest == 0 ? 0 : -1;
+    }
+    return rest % Schema::ItemSize() == 0 ? rest / Schema::ItemSize() : -1;
+}
+
+//从接收缓冲区取出载荷的头部，长度与MessageSchema不符时返回false
+template <class Msg>
+bool ReadMessage(const uint8_t* buffer, uint32_t size, Msg& msg){
+    if(MessageItemCount<Msg>(size) < 0){
+        return false;
+    }
+    if(MessageSchema<Msg>::HeaderSize() > 0){
+        memcpy(&msg, buffer, MessageSchema<Msg>::HeaderSize());
+    }
+    return true;
+}
+
+//取出变长部分的第i项，调用者用MessageItemCount检查过长度
+template <class Msg>
+typename MessageSchema<Msg>::ItemType ReadMessageItem(const uint8_t* buffer, uint32_t i){
+    typename MessageSchema<Msg>::ItemType item;
+    memcpy(&item, buffer + MessageSchema<Msg>::Size(i), MessageSchema<Msg>::ItemSize());
+    return item;
+}
+
+//把载荷（头部和n个项）写入buffer，buffer至少有MessageSchema<Msg>::Size(n)字节
+template <class Msg>
+void WriteMessage(uint8_t* buffer, const Msg& msg, const typename MessageSchema<Msg>::ItemType* items, uint32_t n){
+    if(MessageSchema<Msg>::HeaderSize() > 0){
+        memcpy(buffer, &msg, MessageSchema<Msg>::HeaderSize());
+    }
+    if(n > 0){
+        memcpy(buffer + MessageSchema<Msg>::HeaderSize(), items, n * MessageSchema<Msg>::ItemSize());
+    }
+}
+
+//不单独成为消息的定长记录（例如车群命令前的GroupCommandInformation），从offset处按字节复制
+template <class T>
+bool ReadRecord(const uint8_t* buffer, uint32_t size, uint32_t offset, T& record){
+    static_assert(std::is_trivially_copyable<T>::value, "记录必须能按字节复制");
+    if(size < offset || size - offset < sizeof(T)){
+        return false;
+    }
+    memcpy(&record, buffer + offset, sizeof(T));
+    return true;
+}
+
+#endif
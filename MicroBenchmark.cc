@@ -0,0 +1,108 @@
+#include "ns3/log.h"
+#include "MicroBenchmark.h"
+#include <chrono>
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+
+NS_LOG_COMPONENT_DEFINE("MicroBenchmark");
+
+MicroBenchmarkOptions g_microbench_options = {
+    "",//filter
+    "",//json_file
+    2,//warmup
+    10,//repetitions
+    0.05,//min_time
+    100000,//max_nodes
+};
+
+static volatile uint64_t g_sink = 0;
+
+void MicroBenchmark::DoNotOptimize(uint64_t value){
+    g_sink += value;
+}
+
+MicroBenchmark::MicroBenchmark(const MicroBenchmarkOptions& options){
+    m_options = options;
+    if(m_options.repetitions == 0){
+        m_options.repetitions = 1;
+    }
+}
+
+void MicroBenchmark::Add(const MicroBenchmarkCase& c){
+    m_cases.push_back(c);
+}
+
+double MicroBenchmark::RunOnce(const MicroBenchmarkCase& c, uint64_t iterations){
+    if(c.setup){
+        c.setup();
+    }
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    c.body(iterations);
+    return chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+}
+
+void MicroBenchmark::Run(){
+    cout<<"名称 规模 迭代次数 最小(ns/次) 中位数(ns/次) 平均(ns/次)"<<endl;
+    for(size_t i = 0; i < m_cases.size(); i++){
+        const MicroBenchmarkCase& c = m_cases[i];
+        if(!m_options.filter.empty() && c.name.find(m_options.filter) == string::npos){
+            continue;
+        }
+
+        //每次迭代次数翻倍，直到一次重复至少运行min_time
+        uint64_t iterations = 1;
+        if(!c.single_iteration){
+            while(RunOnce(c, iterations) < m_options.min_time * 1e9 && iterations < ((uint64_t)1 << 40)){
+                iterations *= 2;
+            }
+        }
+        for(uint32_t w = 0; w < m_options.warmup; w++){
+            RunOnce(c, iterations);
+        }
+        vector<double> samples;
+        for(uint32_t r = 0; r < m_options.repetitions; r++){
+            samples.push_back(RunOnce(c, iterations) / iterations);
+        }
+        sort(samples.begin(), samples.end());
+
+        Result result;
+        result.name = c.name;
+        result.size = c.size;
+        result.iterations = iterations;
+        result.repetitions = samples.size();
+        result.min_ns = samples.front();
+        result.median_ns = samples.size() % 2 ? samples[samples.size() / 2]
+                         : (samples[samples.size() / 2 - 1] + samples[samples.size() / 2]) / 2;
+        result.mean_ns = 0;
+        for(size_t s = 0; s < samples.size(); s++){
+            result.mean_ns += samples[s] / samples.size();
+        }
+        m_results.push_back(result);
+        cout<<result.name<<" "<<result.size<<" "<<result.iterations<<" "<<result.min_ns<<" "
+            <<result.median_ns<<" "<<result.mean_ns<<endl;
+    }
+    if(!m_options.json_file.empty()){
+        WriteJson();
+    }
+}
+
+void MicroBenchmark::WriteJson(){
+    ofstream file(m_options.json_file.c_str());
+    if(!file.is_open()){
+        NS_FATAL_ERROR ("MicroBenchmark::WriteJson 无法打开 " << m_options.json_file);
+    }
+    file<<"{"<<endl;
+    file<<"  \"warmup\": "<<m_options.warmup<<","<<endl;
+    file<<"  \"min_time_s\": "<<m_options.min_time<<","<<endl;
+    file<<"  \"benchmarks\": ["<<endl;
+    for(size_t i = 0; i < m_results.size(); i++){
+        const Result& r = m_results[i];
+        //用例名只包含字母、数字和下划线，不需要转义
+        file<<"    {\"name\": \""<<r.name<<"\", \"size\": "<<r.size<<", \"iterations\": "<<r.iterations
+            <<", \"repetitions\": "<<r.repetitions<<", \"min_ns\": "<<r.min_ns<<", \"median_ns\": "<<r.median_ns
+            <<", \"mean_ns\": "<<r.mean_ns<<"}"<<(i + 1 < m_results.size() ? "," : "")<<endl;
+    }
+    file<<"  ]"<<endl;
+    file<<"}"<<endl;
+}
@@ -0,0 +1,70 @@
+#ifndef MICRO_BENCHMARK_H
+#define MICRO_BENCHMARK_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <functional>
+
+using namespace std;
+
+//微基准测试的参数，在example-main.cc中解析
+typedef struct{
+    string filter;//只运行名字包含这个字符串的用例，为空则全部运行
+    string json_file;//结果写到这个JSON文件，为空则只打印
+    uint32_t warmup;//预热的次数，不计入结果
+    uint32_t repetitions;//计时的重复次数
+    double min_time;//每次重复至少运行的时间 单位s，不足时增加迭代次数
+    uint32_t max_nodes;//GroupInitializer::Construct等用例的最大节点数
+} MicroBenchmarkOptions;
+
+extern MicroBenchmarkOptions g_microbench_options;
+
+//一个微基准测试用例
+typedef struct{
+    string name;
+    uint64_t size;//问题规模，例如路由表大小、节点数
+    function<void()> setup;//每次重复之前调用，不计时，可以为空
+    function<void(uint64_t)> body;//执行n次被测操作
+    bool single_iteration;//body每次重复只能执行1次（例如会修改状态、需要setup恢复的操作）
+} MicroBenchmarkCase;
+
+/*
+ * 不运行仿真的微基准测试，用于单独比较协议数据结构的改动
+ * 每个用例先确定迭代次数使一次重复至少运行min_time，预热后重复repetitions次，
+ * 报告每次操作的最小值、中位数和平均值 单位ns
+ */
+class MicroBenchmark{
+public:
+    MicroBenchmark(const MicroBenchmarkOptions& options);
+
+    void Add(const MicroBenchmarkCase& c);
+
+    //运行所有匹配filter的用例，打印结果，并按options写JSON
+    void Run();
+
+    //防止编译器把被测操作的结果优化掉
+    static void DoNotOptimize(uint64_t value);
+
+private:
+    typedef struct{
+        string name;
+        uint64_t size;
+        uint64_t iterations;//每次重复的迭代次数
+        uint32_t repetitions;
+        double min_ns;//每次操作的时间
+        double median_ns;
+        double mean_ns;
+    } Result;
+
+    //运行一次重复，返回总时间 单位ns
+    static double RunOnce(const MicroBenchmarkCase& c, uint64_t iterations);
+
+    void WriteJson();
+
+    MicroBenchmarkOptions m_options;
+    vector<MicroBenchmarkCase> m_cases;
+    vector<Result> m_results;
+};
+
+#endif
@@ -0,0 +1,134 @@
+#include "ns3/log.h"
+#include "ns3/socket.h"
+#include "PacketPool.h"
+
+NS_LOG_COMPONENT_DEFINE("PacketPool");
+NS_OBJECT_ENSURE_REGISTERED(PayloadHeader);
+
+PayloadHeader::PayloadHeader()
+{
+    m_data = NULL;
+    m_size = 0;
+}
+
+PayloadHeader::PayloadHeader(const uint8_t* data, uint32_t size)
+{
+    m_data = data;
+    m_size = size;
+}
+
+TypeId PayloadHeader::GetTypeId()
+{
+    static TypeId tid = TypeId("ns3::PayloadHeader")
+                .SetParent <Header> ()
+                .AddConstructor<PayloadHeader> ()
+                ;
+    return tid;
+}
+
+TypeId PayloadHeader::GetInstanceTypeId() const
+{
+    return GetTypeId();
+}
+
+uint32_t PayloadHeader::GetSerializedSize() const
+{
+    return m_size;
+}
+
+void PayloadHeader::Serialize(Buffer::Iterator start) const
+{
+    if(m_size > 0){
+        start.Write(m_data, m_size);
+    }
+}
+
+uint32_t PayloadHeader::Deserialize(Buffer::Iterator start)
+{
+    //载荷的结构由消息类型决定，这里不解析
+    return 0;
+}
+
+void PayloadHeader::Print(std::ostream &os) const
+{
+    os << "payload=" << m_size;
+}
+
+PacketPool::PacketPool()
+{
+    m_next = 0;
+    m_reused = 0;
+    m_allocated = 0;
+}
+
+Ptr<Packet> PacketPool::Get(MessageHeader& tag, const uint8_t* payload, uint32_t size)
+{
+    for(uint32_t k = 0; k < m_packets.size(); k++){
+        uint32_t i = (m_next + k) % m_packets.size();
+        if(m_packets[i]->GetReferenceCount() == 1){
+            m_next = (i + 1) % m_packets.size();
+            m_reused++;
+            Reset(m_packets[i], tag, payload, size);
+            return m_packets[i];
+        }
+    }
+
+    m_allocated++;
+    Ptr<Packet> packet = Create<Packet>(payload, size);
+    packet->AddPacketTag(tag);
+    if(m_packets.size() < PACKET_POOL_SIZE){
+        m_packets.push_back(packet);
+    }
+    else{
+        NS_LOG_LOGIC("包池已满，创建不入池的包");
+    }
+    return packet;
+}
+
+void PacketPool::Reset(Ptr<Packet> packet, MessageHeader& tag, const uint8_t* payload, uint32_t size)
+{
+    //RemoveAtStart只移动缓冲区的起点，AddHeader在原来的空间里写入
+    packet->RemoveAtStart(packet->GetSize());
+    packet->AddHeader(PayloadHeader(payload, size));
+    packet->RemoveAllByteTags();
+
+    //只有MessageHeader和SendToDevice加的优先级tag时原地替换，否则（设备加了其它tag）全部清除后重新添加
+    PacketTagIterator tags = packet->GetPacketTagIterator();
+    bool has_message_header = false;
+    bool only_known = true;
+    while(tags.HasNext()){
+        TypeId tid = tags.Next().GetTypeId();
+        if(tid == MessageHeader::GetTypeId()){
+            has_message_header = true;
+        }
+        else if(tid != SocketPriorityTag::GetTypeId()){
+            only_known = false;
+        }
+    }
+    if(has_message_header && only_known){
+        packet->ReplacePacketTag(tag);
+    }
+    else{
+        packet->RemoveAllPacketTags();
+        packet->AddPacketTag(tag);
+    }
+}
+
+uint64_t PacketPool::GetReusedCount()
+{
+    return m_reused;
+}
+
+uint64_t PacketPool::GetAllocatedCount()
+{
+    return m_allocated;
+}
+
+uint64_t PacketPool::GetMemoryBytes()
+{
+    uint64_t bytes = VectorBytes(m_packets);
+    for(size_t i = 0; i < m_packets.size(); i++){
+        bytes += sizeof(Packet) + m_packets[i]->GetSize();
+    }
+    return bytes;
+}
@@ -0,0 +1,72 @@
+#ifndef PACKET_POOL_H
+#define PACKET_POOL_H
+
+#include "ns3/packet.h"
+#include "ns3/header.h"
+#include "MessageHeader.h"
+#include "MemoryAccounting.h"
+#include <vector>
+
+using namespace ns3;
+using namespace std;
+
+//每个池最多保留的包数，都在使用中时临时创建不入池的包
+const uint32_t PACKET_POOL_SIZE = 8;
+
+/*
+ * 把载荷作为Header加到包的开头，载荷在Serialize时直接从调用者的结构体复制到包的缓冲区，
+ * 不需要临时的载荷缓冲区；只用于发送，接收方仍按MessageHeader中的载荷大小CopyData
+ */
+class PayloadHeader : public Header
+{
+public:
+    PayloadHeader();
+    PayloadHeader(const uint8_t* data, uint32_t size);
+
+    static TypeId GetTypeId (void);
+    virtual TypeId GetInstanceTypeId (void) const;
+    virtual uint32_t GetSerializedSize (void) const;
+    virtual void Serialize (Buffer::Iterator start) const;
+    virtual uint32_t Deserialize (Buffer::Iterator start);
+    virtual void Print (std::ostream &os) const;
+
+private:
+    const uint8_t* m_data;//不持有，只在AddHeader期间有效
+    uint32_t m_size;
+};
+
+/*
+ * 一种消息的包池，用于心跳、避障等周期性发送的消息
+ * 包被设备队列、信道和接收方引用期间不会被重用，引用计数回到1（只有池自己引用）后，
+ * 清空原来的内容（包括设备加上的LLC等头）再写入新的载荷；包的缓冲区大小不变，
+ * tag只有MessageHeader和优先级tag时原地替换，所以稳态下发送不再分配Packet、缓冲区和tag
+ * 同一种消息的载荷大小相近时效果最好，载荷变大时缓冲区会重新分配一次
+ */
+class PacketPool
+{
+public:
+    PacketPool();
+
+    //取得一个载荷为payload、带有tag的包，size可以为0
+    Ptr<Packet> Get(MessageHeader& tag, const uint8_t* payload, uint32_t size);
+
+    //重用池中包的次数
+    uint64_t GetReusedCount();
+
+    //新创建包的次数（池未满时入池，池满且都在使用中时不入池）
+    uint64_t GetAllocatedCount();
+
+    //池中的包占用的内存（估计值）
+    uint64_t GetMemoryBytes();
+
+private:
+    //清空包的内容并写入新的载荷和tag
+    void Reset(Ptr<Packet> packet, MessageHeader& tag, const uint8_t* payload, uint32_t size);
+
+    vector< Ptr<Packet> > m_packets;
+    uint32_t m_next;//下一次从这里开始查找空闲的包
+    uint64_t m_reused;
+    uint64_t m_allocated;
+};
+
+#endif
@@ -0,0 +1,141 @@
+#include "ns3/log.h"
+#include "ns3/mobility-helper.h"
+#include "ns3/constant-velocity-mobility-model.h"
+#include "ns3/random-variable-stream.h"
+#include "ScenarioGenerator.h"
+#include <cmath>
+
+NS_LOG_COMPONENT_DEFINE("ScenarioGenerator");
+
+const double LANE_WIDTH = 3.5;//车道宽度 单位m
+
+ScenarioGenerator::ScenarioGenerator(const SyntheticScenario& scenario){
+    m_scenario = scenario;
+}
+
+void ScenarioGenerator::Generate(){
+    if(m_scenario.vehicles == 0 || m_scenario.density <= 0){
+        NS_FATAL_ERROR ("ScenarioGenerator 车辆数和密度必须大于0");
+    }
+    m_lanes.clear();
+    if(m_scenario.road == "highway"){
+        BuildHighway();
+    }
+    else if(m_scenario.road == "urban"){
+        BuildUrban();
+    }
+    else{
+        NS_FATAL_ERROR ("ScenarioGenerator 未知的道路类型 " << m_scenario.road);
+    }
+    PlaceVehicles();
+}
+
+void ScenarioGenerator::BuildHighway(){
+    uint32_t lanes = m_scenario.lanes > 0 ? m_scenario.lanes : 1;
+    //每条车道上的车辆数决定道路长度
+    uint32_t per_lane = (m_scenario.vehicles + 2 * lanes - 1) / (2 * lanes);
+    double length = per_lane * 1000.0 / m_scenario.density;
+
+    //y>0为+x方向，y<0为-x方向
+    for(uint32_t k = 0; k < lanes; k++){
+        Lane forward;
+        forward.start = Vector(0, (k + 0.5) * LANE_WIDTH, 0);
+        forward.direction = Vector(1, 0, 0);
+        forward.length = length;
+        m_lanes.push_back(forward);
+
+        Lane backward;
+        backward.start = Vector(length, -(k + 0.5) * LANE_WIDTH, 0);
+        backward.direction = Vector(-1, 0, 0);
+        backward.length = length;
+        m_lanes.push_back(backward);
+    }
+}
+
+void ScenarioGenerator::BuildUrban(){
+    //n*n个街区，横竖各n+1条街道，每条街道两个方向各一条车道，车道长度为n*block_size
+    double block = m_scenario.block_size > 0 ? m_scenario.block_size : 200;
+    double needed = m_scenario.vehicles * 1000.0 / m_scenario.density;
+    uint32_t n = 1;
+    while(4.0 * (n + 1) * n * block < needed){
+        n++;
+    }
+    double length = n * block;
+    for(uint32_t i = 0; i <= n; i++){
+        double offset = i * block;
+        Lane east, west, north, south;
+        east.start = Vector(0, offset - LANE_WIDTH / 2, 0);
+        east.direction = Vector(1, 0, 0);
+        west.start = Vector(length, offset + LANE_WIDTH / 2, 0);
+        west.direction = Vector(-1, 0, 0);
+        north.start = Vector(offset + LANE_WIDTH / 2, 0, 0);
+        north.direction = Vector(0, 1, 0);
+        south.start = Vector(offset - LANE_WIDTH / 2, length, 0);
+        south.direction = Vector(0, -1, 0);
+        east.length = west.length = north.length = south.length = length;
+        m_lanes.push_back(east);
+        m_lanes.push_back(west);
+        m_lanes.push_back(north);
+        m_lanes.push_back(south);
+    }
+}
+
+void ScenarioGenerator::PlaceVehicles(){
+    Ptr<UniformRandomVariable> jitter = CreateObject<UniformRandomVariable>();
+    Ptr<NormalRandomVariable> speed = CreateObject<NormalRandomVariable>();
+    double spacing = 1000.0 / m_scenario.density;
+    double variance = m_scenario.speed_stddev * m_scenario.speed_stddev;
+
+    m_positions.assign(m_scenario.vehicles, Vector());
+    m_velocities.assign(m_scenario.vehicles, Vector());
+    m_lane_vehicles.assign(m_lanes.size(), vector<uint32_t>());
+    for(uint32_t v = 0; v < m_scenario.vehicles; v++){
+        uint32_t lane_id = v % m_lanes.size();
+        uint32_t slot = v / m_lanes.size();
+        Lane& lane = m_lanes[lane_id];
+
+        //slot小的在前面，车道上的车辆按行驶方向从前到后排列
+        double s = lane.length - (slot + 0.5 + jitter->GetValue(-0.25, 0.25)) * spacing;
+        s = fmod(s + lane.length, lane.length);
+        m_positions[v] = Vector(lane.start.x + s * lane.direction.x, lane.start.y + s * lane.direction.y, 0);
+
+        //截断的正态分布，车速不为负也不超过均值的两倍
+        double vel = m_scenario.speed_mean;
+        if(variance > 0){
+            vel = speed->GetValue(m_scenario.speed_mean, variance, 3 * m_scenario.speed_stddev);
+        }
+        vel = vel < 0 ? 0 : (vel > 2 * m_scenario.speed_mean ? 2 * m_scenario.speed_mean : vel);
+        m_velocities[v] = Vector(vel * lane.direction.x, vel * lane.direction.y, 0);
+
+        m_lane_vehicles[lane_id].push_back(v);
+    }
+}
+
+const vector<Vector>& ScenarioGenerator::GetPositions(){
+    return m_positions;
+}
+
+const vector< vector<uint32_t> >& ScenarioGenerator::GetLaneVehicles(){
+    return m_lane_vehicles;
+}
+
+double ScenarioGenerator::GetRoadLength(){
+    return m_lanes.empty() ? 0 : m_lanes[0].length;
+}
+
+void ScenarioGenerator::InstallMobility(NodeContainer& nodes){
+    if(nodes.GetN() != m_positions.size()){
+        NS_FATAL_ERROR ("ScenarioGenerator::InstallMobility 节点数" << nodes.GetN() << "与车辆数" << m_positions.size() << "不一致");
+    }
+    MobilityHelper mobility;
+    Ptr<ListPositionAllocator> positionAlloc = CreateObject<ListPositionAllocator> ();
+    for(uint32_t i = 0; i < m_positions.size(); i++){
+        positionAlloc->Add (m_positions[i]);
+    }
+    mobility.SetPositionAllocator (positionAlloc);
+    mobility.SetMobilityModel ("ns3::ConstantVelocityMobilityModel");
+    mobility.Install (nodes);
+    for(uint32_t i = 0; i < nodes.GetN(); i++){
+        nodes.Get(i)->GetObject<ConstantVelocityMobilityModel>()->SetVelocity(m_velocities[i]);
+    }
+}
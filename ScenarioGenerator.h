@@ -0,0 +1,70 @@
+#ifndef SCENARIO_GENERATOR_H
+#define SCENARIO_GENERATOR_H
+
+#include "ns3/core-module.h"
+#include "ns3/node-container.h"
+#include "ns3/vector.h"
+#include <vector>
+#include <string>
+
+using namespace ns3;
+using namespace std;
+
+//合成场景的参数，benchmark时可以通过命令行修改，在example-main.cc中解析
+typedef struct{
+    string road;//"highway"为多车道双向高速公路，"urban"为方格路网
+    uint32_t vehicles;//车辆数
+    double density;//每条车道每公里的车辆数
+    uint32_t lanes;//高速公路每个方向的车道数
+    double block_size;//方格路网的街区边长 单位m
+    double speed_mean;//车速均值 单位m/s
+    double speed_stddev;//车速标准差 单位m/s
+} SyntheticScenario;
+
+/*
+ * 生成用于规模测试的合成场景，不需要SUMO
+ * 车辆按密度均匀分布在车道上（带少量随机扰动），速度服从截断的正态分布，
+ * 使用ConstantVelocityMobilityModel沿车道匀速行驶，方格路网中不转弯
+ * 随机数来自ns-3的随机数流，不同RngRun得到不同的场景
+ */
+class ScenarioGenerator{
+private:
+    //一条车道
+    typedef struct{
+        Vector start;//车道起点
+        Vector direction;//行驶方向的单位向量
+        double length;//车道长度 单位m
+    } Lane;
+
+    SyntheticScenario m_scenario;
+    vector<Lane> m_lanes;
+    vector<Vector> m_positions;//每辆车的初始位置
+    vector<Vector> m_velocities;//每辆车的速度
+    vector< vector<uint32_t> > m_lane_vehicles;//每条车道上的车辆，按行驶方向从前到后排列
+
+    void BuildHighway();
+    void BuildUrban();
+
+    //把车辆按密度均匀放到各车道上
+    void PlaceVehicles();
+
+public:
+    ScenarioGenerator(const SyntheticScenario& scenario);
+
+    //生成车道、车辆的初始位置和速度
+    void Generate();
+
+    //每辆车的初始位置，可以在创建节点之前用于划分进程
+    const vector<Vector>& GetPositions();
+
+    //每条车道上的车辆编号，按行驶方向从前到后排列
+    const vector< vector<uint32_t> >& GetLaneVehicles();
+
+    //道路（或路网）的长度 单位m
+    double GetRoadLength();
+
+    //为节点安装ConstantVelocityMobilityModel，nodes的大小需要与车辆数一致
+    void InstallMobility(NodeContainer& nodes);
+};
+
+#endif
@@ -0,0 +1,811 @@
+#include "ns3/log.h"
+#include "ns3/ns2-mobility-helper.h"
+#include "ns3/wifi-net-device.h"
+#include "ns3/wifi-phy.h"
+#include "ns3/wifi-mac.h"
+#include "ns3/txop.h"
+#include "ns3/wifi-mac-queue.h"
+#include "ns3/wifi-phy-state-helper.h"
+#include "ns3/wave-net-device.h"
+#include "ns3/channel-scheduler.h"
+#include "ns3/uinteger.h"
+#include "ns3/pointer.h"
+#include "ns3/boolean.h"
+#include "ns3/point-to-point-helper.h"
+#ifdef NS3_MPI
+#include "ns3/mpi-interface.h"
+#endif
+#include "ScenarioHelper.h"
+#include "GroupCheckpoint.h"
+#include "SimulationBranch.h"
+#include "AbstractNetDevice.h"
+#include "EvolutionApplication.h"
+#include "LatencyStats.h"
+#include "HazardStats.h"
+#include <fstream>
+#include <sstream>
+#include <cmath>
+#include <cstdlib>
+#include <unistd.h>
+
+NS_LOG_COMPONENT_DEFINE("ScenarioHelper");
+
+ScenarioOptions g_scenario_options = {
+    true,//lazy_activation
+    false,//grid_channel
+    "wifi",//link_layer
+    false,//pcap
+    "",//metrics_file
+    "",//memory_file
+    1.0,//memory_interval
+    "",//checkpoint_file
+    10.0,//checkpoint_time
+    "",//restore_file
+    -1,//branch_time
+    "",//branch_perturbations
+    true,//qos
+    "single",//channel_mode
+    "HELLO,HELLO_R,CONSTRUCT_MESSAGE,GEOCAST_MESSAGE",//cch_messages
+};
+
+//抽象链路层按发射功率估计通信距离，参数与YansWifiChannelHelper::Default的LogDistancePropagationLossModel一致
+const double LOG_DISTANCE_REFERENCE_LOSS = 46.6777;
+const double LOG_DISTANCE_EXPONENT = 3;
+const double ABSTRACT_RX_THRESHOLD_DBM = -94;//6Mbps在10MHz信道上大致能够接收的功率
+const double ABSTRACT_RELIABLE_MARGIN_DB = 6;//接收功率高出门限这么多时认为一定能收到
+const double DEFAULT_TX_POWER_DBM = 16.0206;//WifiPhy TxPowerStart/End的默认值
+
+//WifiMacQueueItem的时间戳为进入队列的时间
+static void RecordWifiQueueDelay(Ptr<const WifiMacQueueItem> item){
+    LatencyStats::Get()->RecordQueueDelay(item->GetPacket(), Simulator::Now() - item->GetTimeStamp());
+}
+
+//连接一个MAC各接入类别队列的排队时延，非QoS MAC只有一个队列
+static void ConnectQueueDelay(Ptr<WifiMac> mac, bool qos){
+    static const char* txops[] = {"VO_Txop", "VI_Txop", "BE_Txop", "BK_Txop"};
+    uint32_t n = qos ? sizeof(txops) / sizeof(txops[0]) : 1;
+    for(uint32_t j = 0; j < n; j++){
+        PointerValue ptr;
+        mac->GetAttribute(qos ? txops[j] : "Txop", ptr);
+        Ptr<Txop> txop = ptr.Get<Txop>();
+        if(txop){
+            txop->GetWifiMacQueue()->TraceConnectWithoutContext("Dequeue", MakeCallback(&RecordWifiQueueDelay));
+        }
+    }
+}
+
+//PHY的接收结果按帧中消息的逻辑信道归类，不带MessageHeader的帧（MAC ACK等）不统计
+static WifiRxStats* SelectRxStats(WifiRxStats* stats, Ptr<const Packet> packet){
+    MessageHeader tag;
+    if(!packet->PeekPacketTag(tag)){
+        return NULL;
+    }
+    return &stats[MessageChannel(tag.GetType() & ~GROUP_MESSAGE)];
+}
+
+static void CountWifiRxOk(WifiRxStats* stats, Ptr<const Packet> packet, double snr, WifiMode mode, WifiPreamble preamble){
+    WifiRxStats* s = SelectRxStats(stats, packet);
+    if(s){
+        s->rx_ok++;
+    }
+}
+
+static void CountWifiRxError(WifiRxStats* stats, Ptr<const Packet> packet, double snr){
+    WifiRxStats* s = SelectRxStats(stats, packet);
+    if(s){
+        s->rx_error++;
+    }
+}
+
+//交替接入：CCH时隙之外切换到服务信道，需要在设备初始化之后调用
+static void StartServiceChannel(Ptr<WaveNetDevice> device){
+    device->StartSch(SchInfo(MESSAGE_CHANNEL_NUMBERS[MESSAGE_CHANNEL_SCH], false, EXTENDED_ALTERNATING));
+}
+
+//对数距离模型下接收功率等于rxDbm时的距离
+static double LogDistanceRange(double txDbm, double rxDbm){
+    return pow(10.0, (txDbm - LOG_DISTANCE_REFERENCE_LOSS - rxDbm) / (10 * LOG_DISTANCE_EXPONENT));
+}
+
+ScenarioHelper::ScenarioHelper(){
+    m_heap_allocations_start = 0;
+    memset(m_rx_stats, 0, sizeof(m_rx_stats));
+    if(g_scenario_options.grid_channel){
+        //与YansWifiChannelHelper::Default相同的传播模型
+        m_gridChannel = CreateObject<GridSpectrumChannel>();
+        m_gridChannel->AddPropagationLossModel(CreateObject<LogDistancePropagationLossModel>());
+        m_gridChannel->SetPropagationDelayModel(CreateObject<ConstantSpeedPropagationDelayModel>());
+        m_spectrumPhy = SpectrumWifiPhyHelper::Default ();
+        m_spectrumPhy.SetChannel (m_gridChannel);
+        m_phy = &m_spectrumPhy;
+    }
+    else{
+        m_wifiPhy = YansWifiPhyHelper::Default ();
+        YansWifiChannelHelper wifiChannel = YansWifiChannelHelper::Default ();
+        m_channel = wifiChannel.Create ();
+        m_wifiPhy.SetChannel (m_channel);
+        m_phy = &m_wifiPhy;
+    }
+
+    // ns-3 supports generate a pcap trace
+    if(g_scenario_options.pcap){
+        m_phy->SetPcapDataLinkType (WifiPhyHelper::DLT_IEEE802_11);
+    }
+
+    //抽象链路层不使用上面的WAVE设备
+    if(g_scenario_options.link_layer == "abstract"){
+        m_abstractChannel = CreateObject<AbstractChannel>();
+        SetTxPower(DEFAULT_TX_POWER_DBM);
+    }
+    else if(g_scenario_options.link_layer != "wifi"){
+        NS_FATAL_ERROR ("未知的链路层 " << g_scenario_options.link_layer);
+    }
+    m_nqosMac = NqosWaveMacHelper::Default ();
+    m_qosMac = QosWaveMacHelper::Default ();
+    m_mac = g_scenario_options.qos ? (WifiMacHelper*)&m_qosMac : (WifiMacHelper*)&m_nqosMac;
+    m_wifi = Wifi80211pHelper::Default ();
+    m_wifi.SetRemoteStationManager ("ns3::ConstantRateWifiManager",
+                                    "DataMode",StringValue ("OfdmRate6MbpsBW10MHz"),
+                                    "ControlMode",StringValue ("OfdmRate6MbpsBW10MHz"));
+    m_lazy_activation = g_scenario_options.lazy_activation;
+
+    if(!SetControlChannelMessages(g_scenario_options.cch_messages)){
+        NS_FATAL_ERROR ("无法解析控制信道的消息类型 " << g_scenario_options.cch_messages);
+    }
+    if(g_scenario_options.channel_mode != "single"){
+        if(g_scenario_options.channel_mode != "alternating" && g_scenario_options.channel_mode != "continuous"){
+            NS_FATAL_ERROR ("未知的信道模式 " << g_scenario_options.channel_mode);
+        }
+        //网格信道和抽象信道不区分信道号，不能把两个信道的发送隔开
+        if(m_abstractChannel || m_gridChannel){
+            NS_FATAL_ERROR ("多信道只支持--linkLayer=wifi并且不使用--gridChannel");
+        }
+        if(g_scenario_options.channel_mode == "alternating" && !g_scenario_options.qos){
+            NS_FATAL_ERROR ("WaveNetDevice只支持QoS MAC，--channelMode=alternating不能与--qos=false一起使用");
+        }
+    }
+    //交替接入：一个射频，只为CCH和使用的SCH创建MAC
+    m_wave = WaveHelper::Default ();
+    vector<uint32_t> channels(MESSAGE_CHANNEL_NUMBERS, MESSAGE_CHANNEL_NUMBERS + MESSAGE_CHANNEL_COUNT);
+    m_wave.CreateMacForChannel (channels);
+    m_wave.CreatePhys (1);
+    m_wave.SetRemoteStationManager ("ns3::ConstantRateWifiManager",
+                                    "DataMode",StringValue ("OfdmRate6MbpsBW10MHz"),
+                                    "ControlMode",StringValue ("OfdmRate6MbpsBW10MHz"));
+}
+
+uint32_t ScenarioHelper::GetRankCount(){
+#ifdef NS3_MPI
+    return MpiInterface::GetSize();
+#else
+    return 1;
+#endif
+}
+
+vector<Vector> ScenarioHelper::ReadInitialPositions(string tclFilePath, uint32_t n){
+    ifstream file(tclFilePath.c_str());
+    if(!file.is_open()){
+        NS_FATAL_ERROR ("ScenarioHelper::ReadInitialPositions 无法打开 " << tclFilePath);
+    }
+    vector<Vector> positions(n);
+    vector<bool> found(n, false);
+    string line;
+    while(getline(file, line)){
+        size_t node_pos = line.find("$node_(");
+        if(node_pos == string::npos){
+            continue;
+        }
+        uint32_t id = atoi(line.c_str() + node_pos + 7);
+        if(id >= n){
+            continue;
+        }
+        //初始位置：$node_(3) set X_ 5.1
+        if(node_pos == 0){
+            size_t set_pos = line.find(" set ");
+            if(set_pos == string::npos){
+                continue;
+            }
+            double v = atof(line.c_str() + set_pos + 8);
+            if(line.compare(set_pos + 5, 2, "X_") == 0){
+                positions[id].x = v;
+                found[id] = true;
+            }
+            else if(line.compare(set_pos + 5, 2, "Y_") == 0){
+                positions[id].y = v;
+            }
+            continue;
+        }
+        //中途出现的车辆没有初始位置，用第一个setdest的目的地代替
+        size_t dest_pos = line.find(" setdest ");
+        if(dest_pos != string::npos && !found[id]){
+            istringstream in(line.substr(dest_pos + 9));
+            in >> positions[id].x >> positions[id].y;
+            found[id] = true;
+        }
+    }
+    return positions;
+}
+
+void ScenarioHelper::CreateNodes(NodeContainer& nodes, const vector<uint32_t>& ranks){
+    for(uint32_t i = 0; i < ranks.size(); i++){
+        nodes.Create(1, ranks[i]);
+    }
+}
+
+void ScenarioHelper::ParseLifetimes(string tclFilePath){
+    ifstream file(tclFilePath.c_str());
+    if(!file.is_open()){
+        NS_FATAL_ERROR ("ScenarioHelper::ParseLifetimes 无法打开 " << tclFilePath);
+    }
+
+    string line;
+    while(getline(file, line)){
+        //只关心形如 $ns_ at 4.0 "$node_(3) setdest ..." 的行
+        if(line.compare(0, 8, "$ns_ at ") != 0){
+            continue;
+        }
+        size_t node_pos = line.find("$node_(");
+        if(node_pos == string::npos){
+            continue;
+        }
+        double t = atof(line.c_str() + 8);
+        uint32_t id = atoi(line.c_str() + node_pos + 7);
+
+        map<uint32_t, VehicleLifetime>::iterator iter = m_lifetimes.find(id);
+        if(iter == m_lifetimes.end()){
+            VehicleLifetime lt;
+            lt.first = Seconds(t);
+            lt.last = Seconds(t);
+            m_lifetimes[id] = lt;
+        }
+        else{
+            if(Seconds(t) < iter->second.first){
+                iter->second.first = Seconds(t);
+            }
+            if(Seconds(t) > iter->second.last){
+                iter->second.last = Seconds(t);
+            }
+        }
+    }
+}
+
+void ScenarioHelper::LoadTrace(string tclFilePath, NodeContainer& nodes){
+    Ns2MobilityHelper mobility(tclFilePath);
+    mobility.Install(nodes.Begin(), nodes.End());
+    ParseLifetimes(tclFilePath);
+}
+
+void ScenarioHelper::SetTxPower(double dbm){
+    if(m_abstractChannel){
+        m_abstractChannel->SetAttribute("MaxRange", DoubleValue(LogDistanceRange(dbm, ABSTRACT_RX_THRESHOLD_DBM)));
+        m_abstractChannel->SetAttribute("ReliableRange", DoubleValue(LogDistanceRange(dbm, ABSTRACT_RX_THRESHOLD_DBM + ABSTRACT_RELIABLE_MARGIN_DB)));
+        return;
+    }
+    m_phy->Set ("TxPowerStart", DoubleValue (dbm));
+    m_phy->Set ("TxPowerEnd", DoubleValue (dbm));
+}
+
+void ScenarioHelper::SetLazyActivation(bool enable){
+    m_lazy_activation = enable;
+}
+
+VehicleLifetime ScenarioHelper::GetLifetime(uint32_t node_id){
+    map<uint32_t, VehicleLifetime>::iterator iter = m_lifetimes.find(node_id);
+    if(iter != m_lifetimes.end()){
+        return iter->second;
+    }
+    VehicleLifetime lt;
+    lt.first = Seconds(0);
+    lt.last = Time::Max();
+    return lt;
+}
+
+void ScenarioHelper::Activate(Ptr<Node> node){
+    if(node->GetNDevices() > 0){
+        return;
+    }
+    if(m_abstractChannel){
+        Ptr<AbstractNetDevice> dev = CreateObject<AbstractNetDevice>();
+        dev->SetAttribute("Qos", BooleanValue(g_scenario_options.qos));
+        dev->SetAddress(Mac48Address::Allocate());
+        node->AddDevice(dev);
+        dev->SetChannel(m_abstractChannel);
+        return;
+    }
+    if(g_scenario_options.channel_mode == "alternating"){
+        NetDeviceContainer devices = m_wave.Install (*m_phy, m_qosMac, node);
+        Ptr<WaveNetDevice> dev = DynamicCast<WaveNetDevice>(devices.Get(0));
+        for(uint32_t c = 0; c < MESSAGE_CHANNEL_COUNT; c++){
+            ConnectQueueDelay(dev->GetMac(MESSAGE_CHANNEL_NUMBERS[c]), true);
+        }
+        ConnectRxStats(dev->GetPhy(0));
+        Simulator::ScheduleWithContext(node->GetId(), Seconds(0), &StartServiceChannel, dev);
+        return;
+    }
+    //连续接入时第一个设备在CCH上，第二个在SCH上，两个设备使用同一个地址，协议只看到一个节点地址
+    uint32_t radios = g_scenario_options.channel_mode == "continuous" ? MESSAGE_CHANNEL_COUNT : 1;
+    for(uint32_t c = 0; c < radios; c++){
+        if(radios > 1){
+            m_phy->Set ("ChannelNumber", UintegerValue (MESSAGE_CHANNEL_NUMBERS[c]));
+        }
+        NetDeviceContainer devices = m_wifi.Install (*m_phy, *m_mac, node);
+        if(g_scenario_options.pcap){
+            m_phy->EnablePcap ("vehicle-group", devices);
+        }
+        Ptr<WifiNetDevice> dev = DynamicCast<WifiNetDevice>(devices.Get(0));
+        if(c > 0){
+            dev->SetAddress(node->GetDevice(0)->GetAddress());
+        }
+        ConnectQueueDelay(dev->GetMac(), g_scenario_options.qos);
+        ConnectRxStats(dev->GetPhy());
+    }
+}
+
+void ScenarioHelper::ConnectRxStats(Ptr<WifiPhy> phy){
+    PointerValue ptr;
+    phy->GetAttribute("State", ptr);
+    Ptr<WifiPhyStateHelper> state = ptr.Get<WifiPhyStateHelper>();
+    state->TraceConnectWithoutContext("RxOk", MakeBoundCallback(&CountWifiRxOk, m_rx_stats));
+    state->TraceConnectWithoutContext("RxError", MakeBoundCallback(&CountWifiRxError, m_rx_stats));
+}
+
+void ScenarioHelper::Deactivate(Ptr<Node> node){
+    for(uint32_t i = 0; i < node->GetNDevices(); i++){
+        Ptr<WifiNetDevice> dev = DynamicCast<WifiNetDevice>(node->GetDevice(i));
+        if(dev){
+            dev->GetPhy()->SetSleepMode();
+        }
+        Ptr<WaveNetDevice> wave_dev = DynamicCast<WaveNetDevice>(node->GetDevice(i));
+        if(wave_dev){
+            wave_dev->GetPhy(0)->SetSleepMode();
+        }
+        //网格信道可以直接把PHY移除，之后的发送不再为它调度接收事件
+        if(dev && m_gridChannel){
+            m_gridChannel->RemoveDevice(dev);
+        }
+        Ptr<AbstractNetDevice> abstract_dev = DynamicCast<AbstractNetDevice>(node->GetDevice(i));
+        if(abstract_dev){
+            //从信道移除后设备仍然能发送，需要断开链路
+            abstract_dev->SetLinkDown();
+            m_abstractChannel->Remove(abstract_dev);
+        }
+    }
+}
+
+void ScenarioHelper::SetMissing(Ptr<Node> node){
+    Deactivate(node);
+    for(uint32_t i = 0; i < node->GetNApplications(); i++){
+        Ptr<EvolutionApplication> app = DynamicCast<EvolutionApplication>(node->GetApplication(i));
+        if(app){
+            app->SetMissing();
+        }
+    }
+}
+
+void ScenarioHelper::ConnectRanks(){
+    if(!m_abstractChannel){
+        NS_FATAL_ERROR ("分布式仿真只支持--linkLayer=abstract，WAVE信道不能跨进程投递");
+    }
+    //分布式调度器按跨进程点对点链路的最小时延计算lookahead，
+    //这些链路不传数据，时延取信道跨进程投递的最小时延，保证跨进程的帧不会早于lookahead到达
+    PointToPointHelper p2p;
+    p2p.SetChannelAttribute ("Delay", TimeValue (m_abstractChannel->GetRemoteDelay()));
+    NodeContainer anchors;
+    for(uint32_t r = 0; r < GetRankCount(); r++){
+        anchors.Create(1, r);
+    }
+    for(uint32_t r = 1; r < anchors.GetN(); r++){
+        p2p.Install(anchors.Get(0), anchors.Get(r));
+    }
+}
+
+void ScenarioHelper::Install(NodeContainer& nodes){
+    if(GetRankCount() > 1 && m_nodes.GetN() == 0){
+        ConnectRanks();
+    }
+    if(!g_scenario_options.memory_file.empty() && m_nodes.GetN() == 0){
+        Simulator::Schedule(Seconds(0), &ScenarioHelper::SampleMemory, this);
+    }
+    if(m_nodes.GetN() == 0){
+        Simulator::Schedule(Seconds(0), &ScenarioHelper::StartHeapCount, this);
+    }
+    if(!g_scenario_options.checkpoint_file.empty() && m_nodes.GetN() == 0){
+        Simulator::Schedule(Seconds(g_scenario_options.checkpoint_time), &ScenarioHelper::SaveCheckpoint, this);
+    }
+    if(g_scenario_options.branch_time >= 0 && m_nodes.GetN() == 0){
+        Simulator::Schedule(Seconds(g_scenario_options.branch_time), &ScenarioHelper::Branch, this);
+    }
+    m_nodes.Add(nodes);
+    for(uint32_t i = 0; i < nodes.GetN(); i++){
+        Ptr<Node> node = nodes.Get(i);
+        VehicleLifetime lt = GetLifetime(node->GetId());
+
+        //一开始就在路上的车，或者没有启用延迟激活，则立即安装设备
+        if(!m_lazy_activation || lt.first.IsZero()){
+            Activate(node);
+        }
+        else{
+            Simulator::Schedule(lt.first, &ScenarioHelper::Activate, this, node);
+        }
+
+        if(!m_lazy_activation){
+            continue;
+        }
+
+        //把应用的启停时间裁剪到车辆的存在时间内，保留调用者设置的更晚的启动和更早的停止
+        for(uint32_t j = 0; j < node->GetNApplications(); j++){
+            Ptr<Application> app = node->GetApplication(j);
+            TimeValue start, stop;
+            app->GetAttribute("StartTime", start);
+            app->GetAttribute("StopTime", stop);
+            app->SetStartTime(Max(start.Get(), lt.first));
+            //StopTime为0表示不停止
+            if(lt.last != Time::Max() && (stop.Get().IsZero() || stop.Get() > lt.last)){
+                app->SetStopTime(lt.last);
+            }
+        }
+        if(lt.last != Time::Max()){
+            Simulator::Schedule(lt.last, &ScenarioHelper::Deactivate, this, node);
+        }
+    }
+    if(!g_scenario_options.restore_file.empty()){
+        GroupCheckpoint::Restore(g_scenario_options.restore_file, nodes);
+    }
+}
+
+void ScenarioHelper::ScheduleMissing(Ptr<Node> node, Time t){
+    Simulator::Schedule(t, &ScenarioHelper::SetMissing, this, node);
+}
+
+void ScenarioHelper::SaveCheckpoint(){
+    GroupCheckpoint::Save(g_scenario_options.checkpoint_file, m_nodes);
+}
+
+void ScenarioHelper::Branch(){
+    if(GetRankCount() > 1){
+        NS_FATAL_ERROR ("ScenarioHelper::Branch 分支不能与分布式仿真一起使用");
+    }
+    vector<string> perturbations = SimulationBranch::Split(g_scenario_options.branch_perturbations);
+    m_memory_samples.flush();
+    uint32_t branch = SimulationBranch::Fork(perturbations.size());
+    //之后的内存统计写到各分支自己的文件，见SampleMemory
+    if(m_memory_samples.is_open()){
+        m_memory_samples.close();
+    }
+    AddMetric("branch", branch);
+    if(branch > 0){
+        cout<<"分支"<<branch<<" 进程"<<getpid()<<" 扰动 "<<perturbations[branch - 1]<<endl;
+        ApplyPerturbation(perturbations[branch - 1]);
+    }
+}
+
+//解析逗号分隔的数值
+static vector<double> ParseNumbers(string list){
+    vector<double> values;
+    istringstream is(list);
+    string item;
+    while(getline(is, item, ',')){
+        values.push_back(atof(item.c_str()));
+    }
+    return values;
+}
+
+void ScenarioHelper::ApplyPerturbation(string perturbation){
+    istringstream is(perturbation);
+    string item;
+    while(getline(is, item, ';')){
+        if(item.empty()){
+            continue;
+        }
+        size_t eq = item.find('=');
+        if(eq == string::npos){
+            NS_FATAL_ERROR ("ScenarioHelper::ApplyPerturbation 格式错误 " << item);
+        }
+        string key = item.substr(0, eq);
+        vector<double> values = ParseNumbers(item.substr(eq + 1));
+        if(values.empty()){
+            NS_FATAL_ERROR ("ScenarioHelper::ApplyPerturbation 缺少参数 " << item);
+        }
+
+        if(key == "missing"){
+            for(size_t i = 0; i < values.size(); i++){
+                uint32_t id = values[i];
+                if(id >= m_nodes.GetN()){
+                    NS_FATAL_ERROR ("ScenarioHelper::ApplyPerturbation 节点" << id << "不存在");
+                }
+                SetMissing(m_nodes.Get(id));
+            }
+            continue;
+        }
+        if(key == "obstacle" && values.size() < 2){
+            NS_FATAL_ERROR ("ScenarioHelper::ApplyPerturbation obstacle需要x,y " << item);
+        }
+        if(key != "obstacle" && key != "safeDistance" && key != "obstacleInterval" && key != "helloInterval"){
+            NS_FATAL_ERROR ("ScenarioHelper::ApplyPerturbation 未知的扰动 " << key);
+        }
+        for(uint32_t i = 0; i < m_nodes.GetN(); i++){
+            Ptr<Node> node = m_nodes.Get(i);
+            if(node->GetNApplications() == 0){
+                continue;
+            }
+            Ptr<EvolutionApplication> app = DynamicCast<EvolutionApplication>(node->GetApplication(0));
+            if(!app){
+                continue;
+            }
+            if(key == "obstacle"){
+                app->m_obstacle = Vector(values[0], values[1], values.size() > 2 ? values[2] : 0);
+            }
+            else if(key == "safeDistance"){
+                app->m_safe_avoid_obstacle_distance = values[0];
+            }
+            else if(key == "obstacleInterval"){
+                app->m_check_obstacle_interval = Seconds(values[0]);
+            }
+            else{
+                app->SetHelloInterval(Seconds(values[0]));
+            }
+        }
+    }
+}
+
+void ScenarioHelper::PrintStatistics(){
+    LatencyStats::Get()->Print(cout);
+    HazardStats::Get()->Print(cout);
+    MemoryReport memory;
+    CollectMemory(memory);
+    memory.Print(cout);
+    if(m_abstractChannel){
+        uint64_t tx = m_abstractChannel->GetTxCount();
+        uint64_t collisions = 0;
+        for(size_t i = 0; i < m_abstractChannel->GetNDevices(); i++){
+            collisions += DynamicCast<AbstractNetDevice>(m_abstractChannel->GetDevice(i))->GetCollisionCount();
+        }
+        cout<<"AbstractChannel: 发送 "<<tx<<" 帧，调度接收事件 "<<m_abstractChannel->GetRxEventCount()
+            <<" 个，冲突 "<<collisions<<" 次"<<endl;
+        return;
+    }
+    if(!m_gridChannel){
+        return;
+    }
+    uint64_t tx = m_gridChannel->GetTxCount();
+    uint64_t rx = m_gridChannel->GetRxEventCount();
+    cout<<"GridSpectrumChannel: 发送 "<<tx<<" 次，调度接收事件 "<<rx<<" 个";
+    if(tx > 0){
+        cout<<"，平均每次发送 "<<(double)rx/tx<<" 个";
+    }
+    cout<<endl;
+}
+
+void ScenarioHelper::AddMetric(string name, double value){
+    m_extra_metrics.push_back(make_pair(name, value));
+}
+
+void ScenarioHelper::AddSharedMemory(string name, uint64_t bytes){
+    m_shared_memory.push_back(make_pair(name, bytes));
+}
+
+void ScenarioHelper::CollectMemory(MemoryReport& report){
+    for(uint32_t i = 0; i < m_nodes.GetN(); i++){
+        Ptr<Node> node = m_nodes.Get(i);
+        if(node->GetSystemId() != Simulator::GetSystemId()){
+            continue;
+        }
+        MemoryUsage usage;
+        for(uint32_t j = 0; j < node->GetNApplications(); j++){
+            Ptr<EvolutionApplication> app = DynamicCast<EvolutionApplication>(node->GetApplication(j));
+            if(app){
+                app->GetMemoryUsage(usage);
+            }
+        }
+        for(uint32_t j = 0; j < node->GetNDevices(); j++){
+            Ptr<AbstractNetDevice> dev = DynamicCast<AbstractNetDevice>(node->GetDevice(j));
+            if(dev){
+                dev->GetMemoryUsage(usage);
+            }
+        }
+        report.AddNode(usage);
+    }
+    if(m_abstractChannel){
+        report.AddShared("channel", m_abstractChannel->GetMemoryBytes());
+    }
+    else if(m_gridChannel){
+        report.AddShared("channel", m_gridChannel->GetMemoryBytes());
+    }
+    report.AddShared("hazard_stats", HazardStats::Get()->GetMemoryBytes());
+    for(size_t i = 0; i < m_shared_memory.size(); i++){
+        report.AddShared(m_shared_memory[i].first, m_shared_memory[i].second);
+    }
+}
+
+void ScenarioHelper::SampleMemory(){
+    if(!m_memory_samples.is_open()){
+        ostringstream path;
+        path<<g_scenario_options.memory_file;
+        if(Simulator::GetSystemId() > 0){
+            path<<".rank"<<Simulator::GetSystemId();
+        }
+        path<<SimulationBranch::GetSuffix();
+        m_memory_samples.open(path.str().c_str());
+        if(!m_memory_samples.is_open()){
+            NS_FATAL_ERROR ("ScenarioHelper::SampleMemory 无法打开 " << path.str());
+        }
+        m_memory_samples<<"sim_time_s\tnodes\tnode_mean_bytes\tnode_max_bytes\ttotal_bytes"<<endl;
+    }
+    MemoryReport report;
+    CollectMemory(report);
+    m_memory_samples<<Simulator::Now().GetSeconds()<<"\t"<<report.GetNodeCount()<<"\t"<<report.GetMeanNodeBytes()
+                    <<"\t"<<report.GetMaxNodeBytes()<<"\t"<<report.GetTotalBytes()<<endl;
+    if(g_scenario_options.memory_interval > 0){
+        Simulator::Schedule(Seconds(g_scenario_options.memory_interval), &ScenarioHelper::SampleMemory, this);
+    }
+}
+
+void ScenarioHelper::StartHeapCount(){
+    m_heap_allocations_start = GetHeapAllocationCount();
+}
+
+void ScenarioHelper::WriteMetrics(){
+    if(g_scenario_options.metrics_file.empty()){
+        return;
+    }
+    ostringstream path;
+    path<<g_scenario_options.metrics_file;
+    if(Simulator::GetSystemId() > 0){
+        path<<".rank"<<Simulator::GetSystemId();
+    }
+    path<<SimulationBranch::GetSuffix();
+    ofstream file(path.str().c_str());
+    if(!file.is_open()){
+        NS_FATAL_ERROR ("ScenarioHelper::WriteMetrics 无法打开 " << path.str());
+    }
+
+    uint32_t leaders = 0;
+    uint32_t members = 0;
+    uint64_t sent = 0;
+    uint64_t received = 0;
+    uint64_t merge_messages = 0;
+    uint64_t split_messages = 0;
+    uint64_t failover_messages = 0;
+    uint64_t group_commands = 0;
+    uint64_t group_commands_incomplete = 0;
+    uint64_t group_retransmissions = 0;
+    uint64_t group_acks = 0;
+    uint64_t pool_reused = 0;
+    uint64_t pool_allocated = 0;
+    uint64_t geocast_sent = 0;
+    uint64_t geocast_suppressed = 0;
+    uint64_t hello_sent = 0;
+    uint64_t hello_replies = 0;
+    uint64_t dr_errors = 0;
+    double dr_error_sum = 0;
+    double dr_error_max = 0;
+    uint64_t dcc_samples = 0;
+    uint64_t dcc_state_changes = 0;
+    double dcc_cbr_sum = 0;
+    double dcc_cbr_max = 0;
+    uint64_t channel_sent[MESSAGE_CHANNEL_COUNT] = {0};
+    uint64_t channel_rx_bytes[MESSAGE_CHANNEL_COUNT] = {0};
+    uint32_t local_nodes = 0;
+    for(uint32_t i = 0; i < m_nodes.GetN(); i++){
+        Ptr<Node> node = m_nodes.Get(i);
+        if(node->GetSystemId() != Simulator::GetSystemId()){
+            continue;
+        }
+        local_nodes++;
+        for(uint32_t j = 0; j < node->GetNApplications(); j++){
+            Ptr<EvolutionApplication> app = DynamicCast<EvolutionApplication>(node->GetApplication(j));
+            if(!app){
+                continue;
+            }
+            leaders += app->isLeader() ? 1 : 0;
+            members += app->isMember() ? 1 : 0;
+            sent += app->GetSentCount();
+            received += app->GetReceivedCount();
+            merge_messages += app->GetMergeMessageCount();
+            split_messages += app->GetSplitMessageCount();
+            failover_messages += app->GetFailoverMessageCount();
+            group_commands += app->GetGroupCommandCount();
+            group_commands_incomplete += app->GetGroupCommandIncompleteCount();
+            group_retransmissions += app->GetGroupRetransmitCount();
+            group_acks += app->GetGroupAckCount();
+            pool_reused += app->GetPacketPoolReusedCount();
+            pool_allocated += app->GetPacketPoolAllocatedCount();
+            geocast_sent += app->GetGeocastSentCount();
+            geocast_suppressed += app->GetGeocastSuppressedCount();
+            hello_sent += app->GetHelloSentCount();
+            hello_replies += app->GetHelloReplyCount();
+            DeadReckoning& dr = app->GetDeadReckoning();
+            dr_errors += dr.GetErrorCount();
+            dr_error_sum += dr.GetErrorSum();
+            dr_error_max = max(dr_error_max, dr.GetErrorMax());
+            DccController& dcc = app->GetDccController();
+            dcc_samples += dcc.GetSampleCount();
+            dcc_state_changes += dcc.GetStateChangeCount();
+            dcc_cbr_sum += dcc.GetRawCbrSum();
+            dcc_cbr_max = max(dcc_cbr_max, dcc.GetRawCbrMax());
+            for(uint8_t c = 0; c < MESSAGE_CHANNEL_COUNT; c++){
+                channel_sent[c] += app->GetChannelSentCount(c);
+                channel_rx_bytes[c] += app->GetChannelReceivedBytes(c);
+            }
+        }
+    }
+    file<<"nodes\t"<<local_nodes<<endl;
+    file<<"leaders\t"<<leaders<<endl;
+    file<<"members\t"<<members<<endl;
+    file<<"app_sent\t"<<sent<<endl;
+    file<<"app_received\t"<<received<<endl;
+    file<<"merge_messages\t"<<merge_messages<<endl;
+    file<<"split_messages\t"<<split_messages<<endl;
+    file<<"failover_messages\t"<<failover_messages<<endl;
+    file<<"group_commands\t"<<group_commands<<endl;
+    file<<"group_commands_incomplete\t"<<group_commands_incomplete<<endl;
+    file<<"group_retransmissions\t"<<group_retransmissions<<endl;
+    file<<"group_acks\t"<<group_acks<<endl;
+    //避障警告的覆盖率和每个危险的发送次数，车群树和地理广播两种方式都统计
+    vector< pair<string, double> > hazard_metrics;
+    HazardStats::Get()->GetMetrics(hazard_metrics);
+    for(size_t i = 0; i < hazard_metrics.size(); i++){
+        file<<hazard_metrics[i].first<<"\t"<<hazard_metrics[i].second<<endl;
+    }
+    file<<"geocast_sent\t"<<geocast_sent<<endl;
+    file<<"geocast_suppressed\t"<<geocast_suppressed<<endl;
+    file<<"hello_sent\t"<<hello_sent<<endl;
+    file<<"hello_replies\t"<<hello_replies<<endl;
+    file<<"hello_reply_ratio\t"<<(hello_sent > 0 ? (double)hello_replies / hello_sent : 0)<<endl;
+    //每个心跳包发送前父节点外推的位置与真实位置的距离，周期发送和航位推算都统计
+    file<<"hello_position_error_mean\t"<<(dr_errors > 0 ? dr_error_sum / dr_errors : 0)<<endl;
+    file<<"hello_position_error_max\t"<<dr_error_max<<endl;
+    //启用Dcc的节点每DCC_SAMPLE_INTERVAL采样的信道忙比例
+    file<<"dcc_cbr_mean\t"<<(dcc_samples > 0 ? dcc_cbr_sum / dcc_samples : 0)<<endl;
+    file<<"dcc_cbr_max\t"<<dcc_cbr_max<<endl;
+    file<<"dcc_state_changes\t"<<dcc_state_changes<<endl;
+    file<<"sim_time_s\t"<<Simulator::Now().GetSeconds()<<endl;
+    //按逻辑信道统计的协议吞吐量（收到的载荷）和接收失败率，单信道时按消息类型归类，用于与多信道对比
+    double sim_seconds = Simulator::Now().GetSeconds();
+    uint64_t rx_bytes = 0;
+    for(uint8_t c = 0; c < MESSAGE_CHANNEL_COUNT; c++){
+        string name = MessageChannelName(c);
+        rx_bytes += channel_rx_bytes[c];
+        file<<name<<"_sent\t"<<channel_sent[c]<<endl;
+        file<<name<<"_rx_bytes\t"<<channel_rx_bytes[c]<<endl;
+        file<<name<<"_throughput_kbps\t"<<(sim_seconds > 0 ? channel_rx_bytes[c] * 8 / sim_seconds / 1000 : 0)<<endl;
+        if(!m_abstractChannel){
+            uint64_t rx_frames = m_rx_stats[c].rx_ok + m_rx_stats[c].rx_error;
+            file<<name<<"_rx_ok\t"<<m_rx_stats[c].rx_ok<<endl;
+            file<<name<<"_rx_error\t"<<m_rx_stats[c].rx_error<<endl;
+            file<<name<<"_rx_error_rate\t"<<(rx_frames > 0 ? (double)m_rx_stats[c].rx_error / rx_frames : 0)<<endl;
+        }
+    }
+    file<<"app_rx_bytes\t"<<rx_bytes<<endl;
+    file<<"app_throughput_kbps\t"<<(sim_seconds > 0 ? rx_bytes * 8 / sim_seconds / 1000 : 0)<<endl;
+    file<<"packet_pool_reused\t"<<pool_reused<<endl;
+    file<<"packet_pool_allocated\t"<<pool_allocated<<endl;
+    //仿真开始以来本进程的堆分配次数，包括ns-3调度器、信道等的分配
+    double node_seconds = local_nodes * Simulator::Now().GetSeconds();
+    uint64_t heap_allocations = GetHeapAllocationCount() - m_heap_allocations_start;
+    file<<"heap_allocs\t"<<heap_allocations<<endl;
+    file<<"heap_allocs_per_node_s\t"<<(node_seconds > 0 ? heap_allocations / node_seconds : 0)<<endl;
+    if(m_abstractChannel){
+        file<<"channel_tx\t"<<m_abstractChannel->GetTxCount()<<endl;
+        file<<"channel_rx_events\t"<<m_abstractChannel->GetRxEventCount()<<endl;
+    }
+    else if(m_gridChannel){
+        file<<"channel_tx\t"<<m_gridChannel->GetTxCount()<<endl;
+        file<<"channel_rx_events\t"<<m_gridChannel->GetRxEventCount()<<endl;
+    }
+    vector< pair<string, double> > latency;
+    LatencyStats::Get()->GetMetrics(latency);
+    for(size_t i = 0; i < latency.size(); i++){
+        file<<latency[i].first<<"\t"<<latency[i].second<<endl;
+    }
+    MemoryReport memory;
+    CollectMemory(memory);
+    vector< pair<string, double> > memory_metrics;
+    memory.GetMetrics(memory_metrics);
+    for(size_t i = 0; i < memory_metrics.size(); i++){
+        file<<memory_metrics[i].first<<"\t"<<memory_metrics[i].second<<endl;
+    }
+    for(size_t i = 0; i < m_extra_metrics.size(); i++){
+        file<<m_extra_metrics[i].first<<"\t"<<m_extra_metrics[i].second<<endl;
+    }
+}
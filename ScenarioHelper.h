@@ -0,0 +1,174 @@
+#ifndef SCENARIO_HELPER_H
+#define SCENARIO_HELPER_H
+
+#include "ns3/core-module.h"
+#include "ns3/node-container.h"
+#include "ns3/net-device-container.h"
+#include "ns3/yans-wifi-helper.h"
+#include "ns3/spectrum-wifi-helper.h"
+#include "ns3/wifi-80211p-helper.h"
+#include "ns3/wave-mac-helper.h"
+#include "ns3/wave-helper.h"
+#include "ns3/wifi-mode.h"
+#include "ns3/wifi-preamble.h"
+#include "MessageHeader.h"
+#include "GridSpectrumChannel.h"
+#include "AbstractChannel.h"
+#include "MemoryAccounting.h"
+#include <map>
+#include <string>
+#include <fstream>
+
+using namespace ns3;
+using namespace std;
+
+//车辆在trace中的存在时间
+typedef struct{
+    Time first;//第一次出现的时间
+    Time last;//最后一次出现的时间
+} VehicleLifetime;
+
+//一个逻辑信道上PHY的接收结果，接收失败（主要是冲突）的比例用于比较单信道和多信道
+typedef struct{
+    uint64_t rx_ok;//正确接收的帧数
+    uint64_t rx_error;//开始接收但没有正确解码的帧数，包括冲突和信噪比不足
+} WifiRxStats;
+
+//可以通过命令行修改的场景参数，在example-main.cc中解析
+typedef struct{
+    bool lazy_activation;//车辆出现在trace中之前不创建设备
+    bool grid_channel;//使用按网格划分的信道，只向通信距离内的车辆投递
+    string link_layer;//链路层："wifi"为完整的802.11p，"abstract"为AbstractNetDevice
+    bool pcap;//为WAVE设备生成pcap，规模大时文件很大，一般用TraceRecorder代替
+    string metrics_file;//仿真结束后把统计指标写到这个文件，供tools/sweep-runner.cc汇总，为空则不写
+    string memory_file;//周期性统计协议内存并写到这个文件，为空则只在仿真结束时统计
+    double memory_interval;//周期性统计协议内存的间隔 单位s
+    string checkpoint_file;//在checkpoint_time把车群状态保存到这个文件，为空则不保存
+    double checkpoint_time;//保存检查点的时间 单位s
+    string restore_file;//从这个检查点恢复车群状态，跳过车群建立阶段，为空则不恢复
+    double branch_time;//在这个时间fork出各分支，为负则不分支 单位s
+    string branch_perturbations;//各分支的扰动，分支之间用"|"分开，格式见ScenarioHelper::ApplyPerturbation
+    bool qos;//使用QoS WAVE MAC（抽象链路层为按接入类别分开的队列），按消息类别区分优先级
+    string channel_mode;//"single"为单信道WifiNetDevice，"alternating"为WaveNetDevice在CCH/SCH之间交替接入，"continuous"为CCH和SCH上各一个射频
+    string cch_messages;//多信道时使用控制信道的消息类型，","分隔，其它消息使用服务信道，见SetControlChannelMessages
+} ScenarioOptions;
+
+extern ScenarioOptions g_scenario_options;
+
+/*
+ * 负责场景的搭建：加载移动trace、安装WAVE设备、设置应用的启停时间
+ * 启用延迟激活后，车辆在trace中出现之前不创建设备，离开trace后设备休眠，
+ * 这样信道上每次发送的接收者数量和内存占用只与当前在路上的车辆数有关
+ */
+class ScenarioHelper{
+private:
+    YansWifiPhyHelper m_wifiPhy;
+    SpectrumWifiPhyHelper m_spectrumPhy;
+    WifiPhyHelper* m_phy;//实际使用的PHY helper，指向上面两个之一
+    NqosWaveMacHelper m_nqosMac;
+    QosWaveMacHelper m_qosMac;
+    WifiMacHelper* m_mac;//实际使用的MAC helper，指向上面两个之一
+    Wifi80211pHelper m_wifi;
+    Ptr<YansWifiChannel> m_channel;
+    Ptr<GridSpectrumChannel> m_gridChannel;
+    Ptr<AbstractChannel> m_abstractChannel;
+    bool m_lazy_activation;
+    map<uint32_t, VehicleLifetime> m_lifetimes;//node_id -> 存在时间
+    NodeContainer m_nodes;//Install过的节点，用于统计
+    vector< pair<string, double> > m_extra_metrics;//由AddMetric添加的指标
+    vector< pair<string, uint64_t> > m_shared_memory;//由AddSharedMemory添加的共享结构
+    ofstream m_memory_samples;//周期性内存统计的输出
+    uint64_t m_heap_allocations_start;//仿真开始时的堆分配次数
+    WaveHelper m_wave;//channel_mode为alternating时安装WaveNetDevice
+    WifiRxStats m_rx_stats[MESSAGE_CHANNEL_COUNT];//按消息所属的逻辑信道统计的PHY接收结果
+
+    //统计PHY接收结果，按帧中消息的逻辑信道计入m_rx_stats
+    void ConnectRxStats(Ptr<WifiPhy> phy);
+
+    //解析tcl文件中 $ns_ at 行的时间戳，得到每辆车的存在时间
+    void ParseLifetimes(string tclFilePath);
+
+    //为节点安装WAVE设备
+    void Activate(Ptr<Node> node);
+
+    //车辆离开trace后让设备休眠，不再参与收发，抽象链路层的设备断开链路
+    void Deactivate(Ptr<Node> node);
+
+    //节点失联：设备不再收发（同Deactivate），节点上的应用立即停止
+    void SetMissing(Ptr<Node> node);
+
+    //分布式仿真时在进程之间建立只用于同步的点对点链路，时延为信道的跨进程时延
+    void ConnectRanks();
+
+    //统计一次协议内存并写到g_scenario_options.memory_file，周期性调用
+    void SampleMemory();
+
+    //在仿真开始时记录堆分配次数，WriteMetrics据此计算每个节点每秒仿真时间的分配次数
+    void StartHeapCount();
+
+    //把Install过的节点的车群状态保存到g_scenario_options.checkpoint_file
+    void SaveCheckpoint();
+
+    //在g_scenario_options.branch_time调用，fork出各分支并施加各自的扰动，见SimulationBranch
+    void Branch();
+
+    //施加一个分支的扰动，格式为";"分隔的key=value：
+    //  obstacle=x,y         障碍物位置
+    //  safeDistance=m       与障碍物的安全距离
+    //  obstacleInterval=s   检查障碍物的周期
+    //  helloInterval=s      心跳包的间隔，已经安排的心跳包按新的间隔重新安排
+    //  missing=id,id...     这些节点失联，同ScheduleMissing：设备不再收发（WAVE设备休眠，抽象链路层的设备断开链路），应用停止
+    void ApplyPerturbation(string perturbation);
+
+public:
+    ScenarioHelper();
+
+    //进程数，没有启用分布式仿真时为1
+    static uint32_t GetRankCount();
+
+    //读取tcl文件中各车辆最早的位置，用于在创建节点之前划分进程
+    static vector<Vector> ReadInitialPositions(string tclFilePath, uint32_t n);
+
+    //第i个节点创建在进程ranks[i]上，划分见GroupInitializer::Partition
+    static void CreateNodes(NodeContainer& nodes, const vector<uint32_t>& ranks);
+
+    //加载ns2格式的trace并安装移动模型
+    void LoadTrace(string tclFilePath, NodeContainer& nodes);
+
+    //设置发射功率，单位dBm
+    void SetTxPower(double dbm);
+
+    //是否启用延迟激活，默认取g_scenario_options
+    void SetLazyActivation(bool enable);
+
+    //获取节点在trace中的存在时间，没有trace信息时为[0, Time::Max())
+    VehicleLifetime GetLifetime(uint32_t node_id);
+
+    //为节点安装设备，需要在应用添加到节点之后调用
+    //延迟激活时应用的启停时间会被裁剪到车辆的存在时间内
+    //设置了restore_file时从检查点恢复这些节点，设置了checkpoint_file时安排保存检查点，
+    //设置了branch_time时安排分支
+    void Install(NodeContainer& nodes);
+
+    //仿真结束后打印时延、内存和信道统计信息
+    void PrintStatistics();
+
+    //在t时让节点失联（设备不再收发，应用停止），用于测试失联处理
+    void ScheduleMissing(Ptr<Node> node, Time t);
+
+    //添加一项由场景自己统计的指标，由WriteMetrics一起写出
+    void AddMetric(string name, double value);
+
+    //添加一个不属于节点的数据结构（例如GroupInitializer）的内存，计入内存统计
+    void AddSharedMemory(string name, uint64_t bytes);
+
+    //统计本进程各节点的应用和设备、信道以及共享结构占用的内存
+    void CollectMemory(MemoryReport& report);
+
+    //仿真结束后把统计指标写到g_scenario_options.metrics_file，每行为"指标名\t值"
+    //只统计本进程的节点，分布式仿真时进程r(r>0)写到metrics_file.rank<r>
+    //需要在Simulator::Destroy之前调用
+    void WriteMetrics();
+};
+
+#endif
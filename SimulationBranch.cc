@@ -0,0 +1,113 @@
+#include "ns3/log.h"
+#include "SimulationBranch.h"
+#include "TraceRecorder.h"
+#include "EventLog.h"
+#include "HandlerProfiler.h"
+#include <iostream>
+#include <sstream>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/wait.h>
+
+NS_LOG_COMPONENT_DEFINE("SimulationBranch");
+
+bool SimulationBranch::s_forked = false;
+uint32_t SimulationBranch::s_branch_id = 0;
+vector<pid_t> SimulationBranch::s_children;
+
+vector<string> SimulationBranch::Split(string perturbations){
+    vector<string> branches;
+    size_t begin = 0;
+    while(begin <= perturbations.size()){
+        size_t end = perturbations.find('|', begin);
+        if(end == string::npos){
+            end = perturbations.size();
+        }
+        branches.push_back(perturbations.substr(begin, end - begin));
+        begin = end + 1;
+    }
+    return branches;
+}
+
+uint32_t SimulationBranch::Fork(uint32_t n){
+    if(s_forked){
+        NS_FATAL_ERROR ("SimulationBranch::Fork 只能分支一次");
+    }
+    //TraceRecorder的后台线程不会被复制到子进程中，先关闭，各分支再打开自己的文件
+    string trace_path = TraceRecorder::Get()->GetPath();
+    string event_log_path = EventLog::Get()->GetPath();
+    string profile_path = HandlerProfiler::Get()->GetPath();
+    TraceRecorder::Get()->Close();
+    EventLog::Get()->Close();
+    //没有写出的输出会在每个进程中各写一次
+    cout.flush();
+    cerr.flush();
+    fflush(NULL);
+
+    for(uint32_t k = 1; k <= n; k++){
+        pid_t pid = fork();
+        if(pid < 0){
+            NS_FATAL_ERROR ("SimulationBranch::Fork fork失败：" << strerror(errno));
+        }
+        if(pid == 0){
+            s_branch_id = k;
+            s_children.clear();
+            break;
+        }
+        s_children.push_back(pid);
+    }
+    s_forked = true;
+
+    string suffix = GetSuffix();
+    if(!trace_path.empty()){
+        TraceRecorder::Get()->Open(trace_path + suffix);
+    }
+    if(!event_log_path.empty()){
+        EventLog::Get()->Open(event_log_path + suffix);
+    }
+    if(!profile_path.empty()){
+        HandlerProfiler::Get()->SetPath(profile_path + suffix);
+    }
+    return s_branch_id;
+}
+
+uint32_t SimulationBranch::GetBranchId(){
+    return s_branch_id;
+}
+
+string SimulationBranch::GetSuffix(){
+    if(!s_forked){
+        return "";
+    }
+    ostringstream suffix;
+    suffix<<".branch"<<s_branch_id;
+    return suffix.str();
+}
+
+uint32_t SimulationBranch::WaitChildren(){
+    uint32_t failed = 0;
+    for(size_t i = 0; i < s_children.size(); i++){
+        int status = 0;
+        if(waitpid(s_children[i], &status, 0) < 0){
+            NS_LOG_ERROR("等待分支" << i + 1 << "失败：" << strerror(errno));
+            failed++;
+            continue;
+        }
+        bool ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+        if(!ok){
+            failed++;
+        }
+        cout<<"分支"<<i + 1<<"（进程"<<s_children[i]<<"）"<<(ok ? "完成" : "失败");
+        if(WIFEXITED(status)){
+            cout<<" 退出码 "<<WEXITSTATUS(status);
+        }
+        else if(WIFSIGNALED(status)){
+            cout<<" 信号 "<<WTERMSIG(status);
+        }
+        cout<<endl;
+    }
+    s_children.clear();
+    return failed;
+}
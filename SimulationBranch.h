@@ -0,0 +1,47 @@
+#ifndef SIMULATION_BRANCH_H
+#define SIMULATION_BRANCH_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+using namespace std;
+
+/*
+ * 在仿真运行到分支点时fork出多个进程，每个分支施加不同的扰动后各自继续仿真，用于what-if实验
+ * 分支点之前的仿真（车群建立、预热）只运行一次，fork后内存按页写时复制，只有被修改的页会被复制，
+ * 所以N个分支的开销远小于N次完整的仿真；各分支的随机数状态相同，结果的差别只来自扰动
+ *
+ * 父进程作为分支0继续运行（不施加扰动，作为基准），分支k(k>=1)由第k个子进程运行
+ * 各分支把结果写到原文件名加GetSuffix()的文件，例如metrics.txt.branch2，
+ * trace和事件日志在分支点之前的部分在原文件中，之后的部分在各分支自己的文件中
+ * 只有调用fork的线程会被复制，所以fork之前要关闭有后台线程的TraceRecorder，之后再重新打开
+ * 不能与MPI分布式仿真一起使用
+ */
+class SimulationBranch{
+public:
+    //把扰动描述按"|"分开，每一项对应一个分支
+    static vector<string> Split(string perturbations);
+
+    //fork出n个子进程，返回当前进程的分支编号，父进程为0
+    //同时把trace、事件日志和性能分析的输出切换到各分支自己的文件
+    static uint32_t Fork(uint32_t n);
+
+    //当前进程的分支编号，没有分支或者为父进程时为0
+    static uint32_t GetBranchId();
+
+    //分支输出文件的后缀，没有分支时为空
+    static string GetSuffix();
+
+    //父进程等待所有分支结束并打印它们的退出状态，在程序结束前调用，子进程中直接返回
+    //返回失败的分支数
+    static uint32_t WaitChildren();
+
+private:
+    static bool s_forked;
+    static uint32_t s_branch_id;
+    static vector<pid_t> s_children;//父进程中第k个元素为分支k+1的进程号
+};
+
+#endif
@@ -0,0 +1,138 @@
+#ifndef SPATIAL_GRID_H
+#define SPATIAL_GRID_H
+
+#include "ns3/vector.h"
+#include "MemoryAccounting.h"
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <algorithm>
+#include <cmath>
+
+using namespace ns3;
+using namespace std;
+
+/*
+ * 均匀网格，按位置存放对象，用于快速查找某个位置附近的对象
+ * 只使用x、y坐标，T需要支持比较和拷贝（例如Ptr<...>）
+ */
+template <class T>
+class SpatialGrid
+{
+public:
+    SpatialGrid()
+    {
+        m_cell_size = 250;
+    }
+
+    //设置网格边长，只能在放入对象之前调用
+    void SetCellSize(double cell_size)
+    {
+        m_cell_size = cell_size;
+    }
+
+    double GetCellSize()
+    {
+        return m_cell_size;
+    }
+
+    //网格占用的内存估计 单位byte，见MemoryAccounting.h
+    uint64_t GetMemoryBytes()
+    {
+        uint64_t bytes = m_cells.bucket_count() * sizeof(void*);
+        for(typename unordered_map< int64_t, vector<T> >::iterator iter = m_cells.begin(); iter != m_cells.end(); iter++){
+            bytes += sizeof(typename unordered_map< int64_t, vector<T> >::value_type) + HASH_NODE_OVERHEAD + iter->second.capacity() * sizeof(T);
+        }
+        bytes += m_item_cell.size() * (sizeof(typename map<T, int64_t>::value_type) + TREE_NODE_OVERHEAD);
+        return bytes;
+    }
+
+    //放入对象或更新对象的位置
+    void Update(T item, const Vector& pos)
+    {
+        int64_t key = GetCellKey(GetCellIndex(pos.x), GetCellIndex(pos.y));
+        typename map<T, int64_t>::iterator iter = m_item_cell.find(item);
+        if (iter != m_item_cell.end()) {
+            if (iter->second == key) {
+                return;
+            }
+            RemoveFromCell(item, iter->second);
+            iter->second = key;
+        } else {
+            m_item_cell[item] = key;
+        }
+        m_cells[key].push_back(item);
+    }
+
+    void Remove(T item)
+    {
+        typename map<T, int64_t>::iterator iter = m_item_cell.find(item);
+        if (iter == m_item_cell.end()) {
+            return;
+        }
+        RemoveFromCell(item, iter->second);
+        m_item_cell.erase(iter);
+    }
+
+    bool Contains(T item)
+    {
+        return m_item_cell.find(item) != m_item_cell.end();
+    }
+
+    //把与pos的x、y距离都不超过radius的网格中的对象追加到out，结果是实际范围内对象的超集
+    void GetItemsInRange(const Vector& pos, double radius, vector<T>& out)
+    {
+        int64_t x_begin = GetCellIndex(pos.x - radius);
+        int64_t x_end = GetCellIndex(pos.x + radius);
+        int64_t y_begin = GetCellIndex(pos.y - radius);
+        int64_t y_end = GetCellIndex(pos.y + radius);
+        for (int64_t cx = x_begin; cx <= x_end; cx++) {
+            for (int64_t cy = y_begin; cy <= y_end; cy++) {
+                typename unordered_map< int64_t, vector<T> >::iterator cell = m_cells.find(GetCellKey(cx, cy));
+                if (cell != m_cells.end()) {
+                    out.insert(out.end(), cell->second.begin(), cell->second.end());
+                }
+            }
+        }
+    }
+
+    void Clear()
+    {
+        m_cells.clear();
+        m_item_cell.clear();
+    }
+
+private:
+    int64_t GetCellIndex(double v)
+    {
+        return (int64_t)std::floor(v / m_cell_size);
+    }
+
+    int64_t GetCellKey(int64_t cx, int64_t cy)
+    {
+        //负的格子编号左移是未定义行为，按无符号数移位
+        return (int64_t)(((uint64_t)cx << 32) ^ ((uint64_t)cy & 0xffffffffu));
+    }
+
+    void RemoveFromCell(T item, int64_t key)
+    {
+        typename unordered_map< int64_t, vector<T> >::iterator cell = m_cells.find(key);
+        if (cell == m_cells.end()) {
+            return;
+        }
+        typename vector<T>::iterator pos = std::find(cell->second.begin(), cell->second.end(), item);
+        if (pos != cell->second.end()) {
+            *pos = cell->second.back();
+            cell->second.pop_back();
+        }
+        if (cell->second.empty()) {
+            m_cells.erase(cell);
+        }
+    }
+
+    double m_cell_size;//网格边长 单位m
+    unordered_map< int64_t, vector<T> > m_cells;//网格编号 -> 网格内的对象
+    map<T, int64_t> m_item_cell;//对象 -> 所在网格编号
+};
+
+#endif
@@ -10,7 +10,18 @@
 #include "ns3/netanim-module.h"
 #include "EvolutionApplication.h"
 #include "GroupInitializer.h"
+#include "ScenarioHelper.h"
 #include "Test.h"
+#include "MicroBenchmark.h"
+#include "MessageHeader.h"
+#include "PacketPool.h"
+#include "AbstractNetDevice.h"
+#include "GridSpectrumChannel.h"
+#include "ns3/single-model-spectrum-channel.h"
+#include "ns3/wifi-phy-state-helper.h"
+#include <chrono>
+#include <random>
+#include <sys/resource.h>
 
 void TestVGTreeHelper(){
     VGTreeHelper vh;
@@ -26,20 +37,16 @@ void TestGroupInitialer(){
     uint32_t nNodes = 9;//节点数目
     double simTime = 10; //仿真时间
 
-    NodeContainer nodes;
-    nodes.Create(nNodes);
-  
-    MobilityHelper mobility;
-    Ptr<ListPositionAllocator> positionAlloc = CreateObject<ListPositionAllocator> ();
+    vector<Vector> positions;
     
     VGTreeHelper vh;
     GroupInitializer gi;
     //group1
-    positionAlloc->Add (Vector (100, 100, 0));
-    positionAlloc->Add (Vector (80, 80, 0));
-    positionAlloc->Add (Vector (80, 100, 0));
-    positionAlloc->Add (Vector (60, 100, 0));
-    positionAlloc->Add (Vector (60, 80, 0));
+    positions.push_back (Vector (100, 100, 0));
+    positions.push_back (Vector (80, 80, 0));
+    positions.push_back (Vector (80, 100, 0));
+    positions.push_back (Vector (60, 100, 0));
+    positions.push_back (Vector (60, 80, 0));
     
     vh.AddLeader(0);
     vh.AddSubNodesFor(vector<int>({1,2}), 0);
@@ -47,22 +54,33 @@ void TestGroupInitialer(){
     gi.AddGroup(vh.GetTree());
     
     //group2
-    positionAlloc->Add (Vector (120, 100, 0));
-    positionAlloc->Add (Vector (120, 120, 0));
-    positionAlloc->Add (Vector (120, 80, 0));
+    positions.push_back (Vector (120, 100, 0));
+    positions.push_back (Vector (120, 120, 0));
+    positions.push_back (Vector (120, 80, 0));
     
     vh.AddLeader(5);
     vh.AddSubNodesFor(vector<int>({6,7}), 5);
     gi.AddGroup(vh.GetTree());
     
     //group3
-    positionAlloc->Add (Vector (90, 120, 0));
+    positions.push_back (Vector (90, 120, 0));
     vh.AddLeader(8);
     
+    gi.AddGroup(vh.GetTree());
+    
+    //分布式仿真时按车群划分进程，需要在创建节点之前
+    NodeContainer nodes;
+    ScenarioHelper::CreateNodes(nodes, gi.Partition(nNodes, ScenarioHelper::GetRankCount(), positions));
+    
+    MobilityHelper mobility;
+    Ptr<ListPositionAllocator> positionAlloc = CreateObject<ListPositionAllocator> ();
+    for (uint32_t i=0; i<positions.size(); i++)
+    {
+        positionAlloc->Add (positions[i]);
+    }
     mobility.SetPositionAllocator (positionAlloc);
     mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
     mobility.Install (nodes);
-    gi.AddGroup(vh.GetTree());
     
     //add link between groups
     gi.AddLink(0,5);
@@ -71,25 +89,9 @@ void TestGroupInitialer(){
     
     gi.PrintGroupStructures();
     
-    // The below set of helpers will help us to put together the wifi NICs we want
-    YansWifiPhyHelper wifiPhy =  YansWifiPhyHelper::Default ();
-    YansWifiChannelHelper wifiChannel = YansWifiChannelHelper::Default ();
-    Ptr<YansWifiChannel> channel = wifiChannel.Create ();
-    wifiPhy.SetChannel (channel);
-  
-    //可以调节通信距离
-//    wifiPhy.Set ("TxPowerStart", DoubleValue (20) );
-//    wifiPhy.Set ("TxPowerEnd", DoubleValue (40) );
-
-  // ns-3 supports generate a pcap trace
-    wifiPhy.SetPcapDataLinkType (WifiPhyHelper::DLT_IEEE802_11);
-    NqosWaveMacHelper wifi80211pMac = NqosWaveMacHelper::Default ();
-    Wifi80211pHelper wifi80211p = Wifi80211pHelper::Default ();
-
-    wifi80211p.SetRemoteStationManager ("ns3::ConstantRateWifiManager",
-                                      "DataMode",StringValue ("OfdmRate6MbpsBW10MHz"),
-                                      "ControlMode",StringValue ("OfdmRate6MbpsBW10MHz"));
-    NetDeviceContainer devices = wifi80211p.Install (wifiPhy, wifi80211pMac, nodes);
+    //WAVE设备的安装见ScenarioHelper，可以调节通信距离
+    ScenarioHelper sh;
+//    sh.SetTxPower(40);
 
     //为节点添加应用
     for (uint32_t i=0; i<nodes.GetN(); i++)
@@ -99,16 +101,20 @@ void TestGroupInitialer(){
         app_i->SetStopTime (Seconds (simTime));
         nodes.Get(i)->AddApplication (app_i);
     }
+    sh.Install(nodes);
 
     Simulator::Stop(Seconds(simTime));
     
     //初始化车群
     gi.Construct(nodes);
+    sh.AddSharedMemory("group_initializer", gi.GetMemoryBytes());
     //netAnim可视化
 //    AnimationInterface anim("EvolutionApplication.xml");
 //    anim.SetMobilityPollInterval (Seconds (1));
   
     Simulator::Run();
+    sh.PrintStatistics();
+    sh.WriteMetrics();
 
     Simulator::Destroy();
 }
@@ -116,16 +122,19 @@ void TestGroupInitialer(){
 void TestConstructGroup(){
     uint32_t nNodes = 7;//节点数目
     double simTime = 60; //仿真时间
+    // 基点是waf所在目录
+    string tclFilePath = "./scratch/ns3-vehicle-group-simulation/sumofiles/vehicleGroupConstruct/vehicleGroupConstruct.tcl";
 
+    //没有预先建立的车群，分布式仿真时只按道路位置划分进程
+    GroupInitializer gi;
     NodeContainer nodes;
-    nodes.Create(nNodes);
+    ScenarioHelper::CreateNodes(nodes, gi.Partition(nNodes, ScenarioHelper::GetRankCount(), ScenarioHelper::ReadInitialPositions(tclFilePath, nNodes)));
   
     LogComponentEnable ("EvolutionApplication", LOG_LEVEL_FUNCTION);
     
     //使用NS3的移动模型，可以修改为SUMO的FCD输出
-    // 基点是waf所在目录
-    Ns2MobilityHelper mobility("./scratch/ns3-vehicle-group-simulation/sumofiles/vehicleGroupConstruct/vehicleGroupConstruct.tcl");
-    mobility.Install(nodes.Begin(), nodes.End());
+    ScenarioHelper sh;
+    sh.LoadTrace(tclFilePath, nodes);
 //    MobilityHelper mobility;
 //    Ptr<ListPositionAllocator> positionAlloc = CreateObject<ListPositionAllocator> ();
 //    positionAlloc->Add (Vector (0, 0, 0));
@@ -139,25 +148,8 @@ void TestConstructGroup(){
 //    mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
 //    mobility.Install (nodes);
     
-    // The below set of helpers will help us to put together the wifi NICs we want
-    YansWifiPhyHelper wifiPhy =  YansWifiPhyHelper::Default ();
-    YansWifiChannelHelper wifiChannel = YansWifiChannelHelper::Default ();
-    Ptr<YansWifiChannel> channel = wifiChannel.Create ();
-    wifiPhy.SetChannel (channel);
-  
     //可以调节通信距离
-    wifiPhy.Set ("TxPowerStart", DoubleValue (40) );
-    wifiPhy.Set ("TxPowerEnd", DoubleValue (40) );
-
-    // ns-3 supports generate a pcap trace
-    wifiPhy.SetPcapDataLinkType (WifiPhyHelper::DLT_IEEE802_11);
-    NqosWaveMacHelper wifi80211pMac = NqosWaveMacHelper::Default ();
-    Wifi80211pHelper wifi80211p = Wifi80211pHelper::Default ();
-
-    wifi80211p.SetRemoteStationManager ("ns3::ConstantRateWifiManager",
-                                      "DataMode",StringValue ("OfdmRate6MbpsBW10MHz"),
-                                      "ControlMode",StringValue ("OfdmRate6MbpsBW10MHz"));
-    NetDeviceContainer devices = wifi80211p.Install (wifiPhy, wifi80211pMac, nodes);
+    sh.SetTxPower(40);
 
     //为节点添加应用
     Ptr<EvolutionApplication> app0 = CreateObject<EvolutionApplication>();
@@ -209,12 +201,17 @@ void TestConstructGroup(){
     app6->AssignTaskAtTime(1,Seconds(20));
     app6->m_debug_construct = true;
     nodes.Get(6)->AddApplication (app6);
+    
+    //车辆在trace中出现后才安装设备
+    sh.Install(nodes);
     Simulator::Stop(Seconds(simTime));
     //netAnim可视化
 //    AnimationInterface anim("EvolutionApplication.xml");
 //    anim.SetMobilityPollInterval (Seconds (1));
   
     Simulator::Run();
+    sh.PrintStatistics();
+    sh.WriteMetrics();
 
     Simulator::Destroy();
 }
@@ -222,16 +219,8 @@ void TestConstructGroup(){
 void TestAvoidObstable() {
     uint32_t nNodes = 6;//节点数目
     double simTime = 1.2; //仿真时间
-
-    NodeContainer nodes;
-    nodes.Create(nNodes);
-  
-    LogComponentEnable ("EvolutionApplication", LOG_LEVEL_FUNCTION);
-    
-    //使用NS3的移动模型，可以修改为SUMO的FCD输出
     // 基点是waf所在目录
-    Ns2MobilityHelper mobility("./scratch/ns3-vehicle-group-simulation/sumofiles/avoidObstacle/mobility.tcl");
-    mobility.Install(nodes.Begin(), nodes.End());
+    string tclFilePath = "./scratch/ns3-vehicle-group-simulation/sumofiles/avoidObstacle/mobility.tcl";
 
     VGTreeHelper vh;
     GroupInitializer gi;
@@ -252,25 +241,18 @@ void TestAvoidObstable() {
     
     gi.PrintGroupStructures();
     
-    // The below set of helpers will help us to put together the wifi NICs we want
-    YansWifiPhyHelper wifiPhy =  YansWifiPhyHelper::Default ();
-    YansWifiChannelHelper wifiChannel = YansWifiChannelHelper::Default ();
-    Ptr<YansWifiChannel> channel = wifiChannel.Create ();
-    wifiPhy.SetChannel (channel);
+    //分布式仿真时按车群和道路位置划分进程，需要在创建节点之前
+    NodeContainer nodes;
+    ScenarioHelper::CreateNodes(nodes, gi.Partition(nNodes, ScenarioHelper::GetRankCount(), ScenarioHelper::ReadInitialPositions(tclFilePath, nNodes)));
   
-    //可以调节通信距离
-//    wifiPhy.Set ("TxPowerStart", DoubleValue (20) );
-//    wifiPhy.Set ("TxPowerEnd", DoubleValue (40) );
-
-    // ns-3 supports generate a pcap trace
-    wifiPhy.SetPcapDataLinkType (WifiPhyHelper::DLT_IEEE802_11);
-    NqosWaveMacHelper wifi80211pMac = NqosWaveMacHelper::Default ();
-    Wifi80211pHelper wifi80211p = Wifi80211pHelper::Default ();
-
-    wifi80211p.SetRemoteStationManager ("ns3::ConstantRateWifiManager",
-                                      "DataMode",StringValue ("OfdmRate6MbpsBW10MHz"),
-                                      "ControlMode",StringValue ("OfdmRate6MbpsBW10MHz"));
-    NetDeviceContainer devices = wifi80211p.Install (wifiPhy, wifi80211pMac, nodes);
+    LogComponentEnable ("EvolutionApplication", LOG_LEVEL_FUNCTION);
+    
+    //使用NS3的移动模型，可以修改为SUMO的FCD输出
+    ScenarioHelper sh;
+    sh.LoadTrace(tclFilePath, nodes);
+    
+    //WAVE设备的安装见ScenarioHelper，可以调节通信距离
+//    sh.SetTxPower(40);
 
     //为节点添加应用
     for (uint32_t i=0; i<nodes.GetN(); i++)
@@ -291,17 +273,604 @@ void TestAvoidObstable() {
         // ======================= application 的一些参数的初始化 end ===============================
         
     }
+    sh.Install(nodes);
 
     Simulator::Stop(Seconds(simTime));
     
     //初始化车群
     gi.Construct(nodes);
+    sh.AddSharedMemory("group_initializer", gi.GetMemoryBytes());
   
     //netAnim可视化
 //    AnimationInterface anim("EvolutionApplication.xml");
 //    anim.SetMobilityPollInterval (Seconds (1));
   
     Simulator::Run();
+    sh.PrintStatistics();
+    sh.WriteMetrics();
+
+    Simulator::Destroy();
+}
+
+BenchmarkOptions g_benchmark_options = {
+    {
+        "highway",//road
+        1000,//vehicles
+        20,//density
+        3,//lanes
+        200,//block_size
+        30,//speed_mean
+        3,//speed_stddev
+    },
+    "construct",//workflow
+    10,//sim_time
+    10,//group_size
+    0,//hello_interval
+    false,//geocast
+};
+
+void TestBenchmark(){
+    BenchmarkOptions& opt = g_benchmark_options;
+    ScenarioGenerator gen(opt.scenario);
+    gen.Generate();
+    const vector<Vector>& positions = gen.GetPositions();
+    const vector< vector<uint32_t> >& lanes = gen.GetLaneVehicles();
+    uint32_t nNodes = positions.size();
+    uint32_t group_size = opt.group_size > 0 ? opt.group_size : 1;
+
+    //obstacle流程：每条车道上相邻的group_size辆车组成一个车群，成员按MAX_SUBNODES叉树挂在leader下，
+    //同一车道上相邻车群的leader互相连接
+    //adjust流程：车群的建立方式与obstacle相同，同一车道上的车群属于同一个任务，距离近的车群合并，拉开后分裂
+    //failover流程：车群的建立方式与obstacle相同，仿真进行到一半时所有leader失联，由备用leader接替
+    GroupInitializer gi;
+    vector<uint32_t> leaders;
+    bool prebuilt = opt.workflow == "obstacle" || opt.workflow == "adjust" || opt.workflow == "failover";
+    if(prebuilt){
+        for(size_t l = 0; l < lanes.size(); l++){
+            int last_leader = -1;
+            for(size_t begin = 0; begin < lanes[l].size(); begin += group_size){
+                size_t end = min(begin + group_size, lanes[l].size());
+                VGTreeHelper vh;
+                vh.AddLeader(lanes[l][begin]);
+                leaders.push_back(lanes[l][begin]);
+                for(size_t j = begin + 1; j < end; j++){
+                    size_t parent = begin + (j - begin - 1) / MAX_SUBNODES;
+                    vh.AddSubNodesFor(vector<int>({(int)lanes[l][j]}), lanes[l][parent]);
+                }
+                gi.AddGroup(vh.GetTree());
+                if(last_leader >= 0){
+                    gi.AddLink(last_leader, lanes[l][begin]);
+                }
+                last_leader = lanes[l][begin];
+            }
+        }
+    }
+    else if(opt.workflow != "construct"){
+        NS_FATAL_ERROR ("TestBenchmark 未知的流程 " << opt.workflow);
+    }
+
+    NodeContainer nodes;
+    ScenarioHelper::CreateNodes(nodes, gi.Partition(nNodes, ScenarioHelper::GetRankCount(), positions));
+    gen.InstallMobility(nodes);
+
+    ScenarioHelper sh;
+    Ptr<UniformRandomVariable> task_time = CreateObject<UniformRandomVariable>();
+    //障碍物放在0号车道中间那辆车前方50m
+    Vector obstacle;
+    if(!lanes.empty() && !lanes[0].empty()){
+        Vector p = positions[lanes[0][lanes[0].size() / 2]];
+        obstacle = Vector(p.x + 50, p.y, 0);
+    }
+    for(size_t l = 0; l < lanes.size(); l++){
+        for(size_t j = 0; j < lanes[l].size(); j++){
+            Ptr<EvolutionApplication> app = CreateObject<EvolutionApplication>();
+            app->SetStartTime (Seconds (0));
+            app->SetStopTime (Seconds (opt.sim_time));
+            if(opt.workflow == "construct"){
+                //同一车道上相邻的group_size辆车分配同一个任务，在前2s内随机开始建立车群
+                app->AssignTaskAtTime(l * 100000 + j / group_size, Seconds(task_time->GetValue(0, 2)));
+            }
+            else if(opt.workflow == "adjust"){
+                app->m_is_simulate_adjust = true;
+            }
+            else if(opt.workflow == "failover"){
+                app->m_is_simulate_node_missing = true;
+            }
+            else{
+                app->m_is_simulate_avoid_obstacle = true;
+                app->m_obstacle = obstacle;
+                app->m_geocast_obstacle = opt.geocast;
+                //避障消息的时延（queue_safety、group_command_confirmed）不应随信标负载增加
+                if(opt.hello_interval > 0){
+                    app->m_is_simulate_beacon = true;
+                    app->m_hello_interval = Seconds(opt.hello_interval);
+                }
+            }
+            nodes.Get(lanes[l][j])->AddApplication (app);
+        }
+    }
+    sh.Install(nodes);
+    if(prebuilt){
+        gi.Construct(nodes);
+        sh.AddSharedMemory("group_initializer", gi.GetMemoryBytes());
+    }
+    if(opt.workflow == "failover"){
+        //恢复时间见failover_takeover（备用leader接替）和failover_reparent（其它二级节点接到备用leader下）
+        for(size_t i = 0; i < leaders.size(); i++){
+            sh.ScheduleMissing(nodes.Get(leaders[i]), Seconds(opt.sim_time / 2));
+        }
+    }
+    if(opt.workflow == "adjust"){
+        //GroupInitializer为每个车群分配不同的任务，这里改为按车道分配
+        for(size_t l = 0; l < lanes.size(); l++){
+            for(size_t j = 0; j < lanes[l].size(); j++){
+                DynamicCast<EvolutionApplication>(nodes.Get(lanes[l][j])->GetApplication(0))->m_task_id = l;
+            }
+        }
+    }
+
+    Simulator::Stop(Seconds(opt.sim_time));
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    Simulator::Run();
+    double wall = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    //分布式仿真时只统计本进程的节点，每辆车的帧数按本进程的车辆数计算
+    uint64_t sent = 0;
+    uint32_t local_nodes = 0;
+    for(uint32_t i = 0; i < nodes.GetN(); i++){
+        if(nodes.Get(i)->GetSystemId() == Simulator::GetSystemId()){
+            sent += DynamicCast<EvolutionApplication>(nodes.Get(i)->GetApplication(0))->GetSentCount();
+            local_nodes++;
+        }
+    }
+    sh.AddMetric("wall_s", wall);
+    sh.AddMetric("sim_per_wall", wall > 0 ? opt.sim_time / wall : 0);
+    sh.AddMetric("events", Simulator::GetEventCount());
+    sh.AddMetric("peak_rss_kb", usage.ru_maxrss);
+    sh.AddMetric("frames_per_vehicle", local_nodes > 0 ? (double)sent / local_nodes : 0);
+    cout<<"benchmark: "<<opt.scenario.road<<" "<<opt.workflow<<" 车辆 "<<nNodes<<" 用时 "<<wall<<"s 仿真/墙钟 "
+        <<(wall > 0 ? opt.sim_time / wall : 0)<<" 事件 "<<Simulator::GetEventCount()<<" 峰值内存 "<<usage.ru_maxrss<<"KB"<<endl;
+    sh.PrintStatistics();
+    sh.WriteMetrics();
+
+    Simulator::Destroy();
+}
+
+//TestNodeMissing：邻居收到的失联节点的帧
+static Address g_missing_addr;
+static Time g_missing_time;
+static uint64_t g_missing_rx_before = 0;
+static uint64_t g_missing_rx_after = 0;
+
+static bool CountMissingRx(Ptr<NetDevice> dev, Ptr<const Packet> packet, uint16_t protocol,
+                           const Address& src, const Address& dest, NetDevice::PacketType type){
+    if(src != g_missing_addr){
+        return true;
+    }
+    //失联前开始发送的帧在一个帧的空中时间后才收到，留出余量
+    if(Now() < g_missing_time + MilliSeconds(10)){
+        g_missing_rx_before++;
+    }
+    else{
+        g_missing_rx_after++;
+    }
+    return true;
+}
+
+void TestNodeMissing(){
+    //抽象链路层上leader失联后，成员不应再收到它的心跳回复和同步消息
+    string link_layer = g_scenario_options.link_layer;
+    g_scenario_options.link_layer = "abstract";
+    uint32_t nNodes = 4;
+    double simTime = 20;
+
+    NodeContainer nodes;
+    nodes.Create(nNodes);
+    MobilityHelper mobility;
+    Ptr<ListPositionAllocator> positionAlloc = CreateObject<ListPositionAllocator> ();
+    for(uint32_t i = 0; i < nNodes; i++){
+        positionAlloc->Add (Vector (10 * i, 0, 0));
+    }
+    mobility.SetPositionAllocator (positionAlloc);
+    mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+    mobility.Install (nodes);
+
+    ScenarioHelper sh;
+    for(uint32_t i = 0; i < nNodes; i++){
+        Ptr<EvolutionApplication> app = CreateObject<EvolutionApplication>();
+        app->SetStartTime (Seconds (0));
+        app->SetStopTime (Seconds (simTime));
+        app->m_is_simulate_node_missing = true;
+        nodes.Get(i)->AddApplication (app);
+    }
+    sh.Install(nodes);
+    VGTreeHelper vh;
+    vh.AddLeader(0);
+    vh.AddSubNodesFor(vector<int>({1,2,3}), 0);
+    GroupInitializer gi;
+    gi.AddGroup(vh.GetTree());
+    gi.Construct(nodes);
+
+    g_missing_addr = nodes.Get(0)->GetDevice(0)->GetAddress();
+    g_missing_time = Seconds(simTime / 2);
+    g_missing_rx_before = 0;
+    g_missing_rx_after = 0;
+    for(uint32_t i = 1; i < nNodes; i++){
+        nodes.Get(i)->GetDevice(0)->SetPromiscReceiveCallback(MakeCallback(&CountMissingRx));
+    }
+    sh.ScheduleMissing(nodes.Get(0), g_missing_time);
+
+    Simulator::Stop(Seconds(simTime));
+    Simulator::Run();
+    cout<<"TestNodeMissing: 失联前收到leader的帧 "<<g_missing_rx_before<<" 失联后 "<<g_missing_rx_after<<endl;
+    if(g_missing_rx_before == 0){
+        NS_FATAL_ERROR ("TestNodeMissing 失联前成员没有收到leader的帧，测试场景无效");
+    }
+    if(g_missing_rx_after > 0){
+        NS_FATAL_ERROR ("TestNodeMissing 失联的leader仍然发送了" << g_missing_rx_after << "帧");
+    }
+    g_scenario_options.link_layer = link_layer;
+    Simulator::Destroy();
+}
+
+void TestLateSpawn(){
+    //test.tcl中3号车在4.0s才出现，延迟激活时预先建立车群要跳过它和它的子树，出现后再安装设备
+    uint32_t nNodes = 4;
+    double simTime = 10;
+    string tclFilePath = "./scratch/ns3-vehicle-group-simulation/sumofiles/test.tcl";
+
+    VGTreeHelper vh;
+    GroupInitializer gi;
+    vh.AddLeader(0);
+    vh.AddSubNodesFor(vector<int>({2,3}), 0);
+    vh.AddSubNodesFor(vector<int>({1}), 3);
+    gi.AddGroup(vh.GetTree());
+
+    NodeContainer nodes;
+    ScenarioHelper::CreateNodes(nodes, gi.Partition(nNodes, ScenarioHelper::GetRankCount(), ScenarioHelper::ReadInitialPositions(tclFilePath, nNodes)));
+    ScenarioHelper sh;
+    sh.LoadTrace(tclFilePath, nodes);
+    sh.SetLazyActivation(true);
+    for(uint32_t i = 0; i < nNodes; i++){
+        Ptr<EvolutionApplication> app = CreateObject<EvolutionApplication>();
+        app->SetStartTime (Seconds (0));
+        app->SetStopTime (Seconds (simTime));
+        nodes.Get(i)->AddApplication (app);
+    }
+    sh.Install(nodes);
+    gi.Construct(nodes);
+
+    if(nodes.Get(3)->GetNDevices() != 0){
+        NS_FATAL_ERROR ("TestLateSpawn 3号车在出现之前就安装了设备");
+    }
+    if(gi.GetSkippedCount() != 2){
+        NS_FATAL_ERROR ("TestLateSpawn 应该跳过3号车和它的子节点1号车，实际跳过" << gi.GetSkippedCount());
+    }
+    Ptr<EvolutionApplication> leader = DynamicCast<EvolutionApplication>(nodes.Get(0)->GetApplication(0));
+    if(!leader->isLeader() || leader->m_next.size() != 1){
+        NS_FATAL_ERROR ("TestLateSpawn leader应该只有已经出现的2号车一个子节点");
+    }
+    //启动时间裁剪到出现的时间，停止时间保留调用者设置的更早的时间
+    TimeValue start, stop;
+    nodes.Get(3)->GetApplication(0)->GetAttribute("StartTime", start);
+    nodes.Get(3)->GetApplication(0)->GetAttribute("StopTime", stop);
+    if(start.Get() != Seconds(4) || stop.Get() != Seconds(simTime)){
+        NS_FATAL_ERROR ("TestLateSpawn 3号车的应用应该在[4s, " << simTime << "s)运行，实际为[" << start.Get().GetSeconds() << "s, " << stop.Get().GetSeconds() << "s)");
+    }
+
+    Simulator::Stop(Seconds(simTime));
+    Simulator::Run();
+    if(nodes.Get(3)->GetNDevices() == 0){
+        NS_FATAL_ERROR ("TestLateSpawn 3号车出现后没有安装设备");
+    }
+    cout<<"TestLateSpawn: 跳过 "<<gi.GetSkippedCount()<<" 个还没有出现的节点"<<endl;
+    sh.PrintStatistics();
+    Simulator::Destroy();
+}
+
+//TestGridChannel：所有PHY成功接收的帧数
+static uint64_t g_grid_rx_ok = 0;
+
+static void CountGridRxOk(Ptr<const Packet> packet, double snr, WifiMode mode, WifiPreamble preamble){
+    g_grid_rx_ok++;
+}
+
+static void BroadcastFrame(Ptr<NetDevice> dev, Time interval){
+    dev->Send(Create<Packet>(200), Mac48Address::GetBroadcast(), 0x88dc);
+    Simulator::Schedule(interval, &BroadcastFrame, dev, interval);
+}
+
+//30辆车间隔150m排成一列（约4.4km），每辆车每100ms广播一帧，返回成功接收的帧数
+//grid为空时使用SingleModelSpectrumChannel，两者的传播模型与ScenarioHelper相同
+static uint64_t RunChannelScenario(Ptr<GridSpectrumChannel> grid){
+    uint32_t nNodes = 30;
+    double simTime = 5;
+    NodeContainer nodes;
+    nodes.Create(nNodes);
+    MobilityHelper mobility;
+    Ptr<ListPositionAllocator> positionAlloc = CreateObject<ListPositionAllocator> ();
+    for(uint32_t i = 0; i < nNodes; i++){
+        positionAlloc->Add (Vector (150 * i, 0, 0));
+    }
+    mobility.SetPositionAllocator (positionAlloc);
+    mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+    mobility.Install (nodes);
+
+    Ptr<SpectrumChannel> channel;
+    if(grid){
+        channel = grid;
+    }
+    else{
+        channel = CreateObject<SingleModelSpectrumChannel>();
+    }
+    channel->AddPropagationLossModel(CreateObject<LogDistancePropagationLossModel>());
+    channel->SetPropagationDelayModel(CreateObject<ConstantSpeedPropagationDelayModel>());
+    SpectrumWifiPhyHelper phy = SpectrumWifiPhyHelper::Default ();
+    phy.SetChannel (channel);
+    NqosWaveMacHelper mac = NqosWaveMacHelper::Default ();
+    Wifi80211pHelper wifi = Wifi80211pHelper::Default ();
+    wifi.SetRemoteStationManager ("ns3::ConstantRateWifiManager",
+                                  "DataMode",StringValue ("OfdmRate6MbpsBW10MHz"),
+                                  "ControlMode",StringValue ("OfdmRate6MbpsBW10MHz"));
+    NetDeviceContainer devices = wifi.Install (phy, mac, nodes);
+    //各次运行的退避使用相同的随机数流
+    wifi.AssignStreams (devices, 0);
+
+    g_grid_rx_ok = 0;
+    for(uint32_t i = 0; i < nNodes; i++){
+        PointerValue ptr;
+        DynamicCast<WifiNetDevice>(devices.Get(i))->GetPhy()->GetAttribute("State", ptr);
+        ptr.Get<WifiPhyStateHelper>()->TraceConnectWithoutContext("RxOk", MakeCallback(&CountGridRxOk));
+        Simulator::Schedule(MilliSeconds(7 * i), &BroadcastFrame, devices.Get(i), MilliSeconds(100));
+    }
+    Simulator::Stop(Seconds(simTime));
+    Simulator::Run();
+    uint64_t rx = g_grid_rx_ok;
+    Simulator::Destroy();
+    return rx;
+}
+
+void TestGridChannel(){
+    //关闭截断时网格信道只减少调度的接收事件，接收结果必须与原生信道完全相同
+    uint64_t stock = RunChannelScenario(0);
+    Ptr<GridSpectrumChannel> unlimited = CreateObject<GridSpectrumChannel>();
+    unlimited->SetAttribute("MinRxPowerDbm", DoubleValue(-1e9));
+    uint64_t grid_unlimited = RunChannelScenario(unlimited);
+    //默认截断只丢弃远低于噪声底的干扰，接收的帧数与原生信道相差不超过1%
+    uint64_t grid_default = RunChannelScenario(CreateObject<GridSpectrumChannel>());
+    cout<<"TestGridChannel: 成功接收的帧 SingleModelSpectrumChannel "<<stock<<" GridSpectrumChannel(不截断) "<<grid_unlimited
+        <<" GridSpectrumChannel(默认截断) "<<grid_default<<endl;
+    if(stock == 0){
+        NS_FATAL_ERROR ("TestGridChannel 没有收到任何帧，测试场景无效");
+    }
+    if(grid_unlimited != stock){
+        NS_FATAL_ERROR ("TestGridChannel 关闭截断时网格信道的接收结果与SingleModelSpectrumChannel不同");
+    }
+    if(grid_default > stock + stock / 100 || grid_default + stock / 100 < stock){
+        NS_FATAL_ERROR ("TestGridChannel 默认截断下接收的帧数与SingleModelSpectrumChannel相差超过1%");
+    }
+}
+
+//为微基准测试创建n个节点，每个节点有一个AbstractNetDevice（只用于分配地址）和一个EvolutionApplication
+static void CreateBenchmarkNodes(NodeContainer& nodes, uint32_t n){
+    nodes.Create(n);
+    for(uint32_t i = 0; i < n; i++){
+        Ptr<AbstractNetDevice> dev = CreateObject<AbstractNetDevice>();
+        dev->SetAddress(Mac48Address::Allocate());
+        nodes.Get(i)->AddDevice(dev);
+        nodes.Get(i)->AddApplication(CreateObject<EvolutionApplication>());
+    }
+}
+
+//用ids中的节点按MAX_SUBNODES叉树建立以ids[0]为leader的车群
+static void BuildGroupTree(VGTreeHelper& vh, const vector<int>& ids){
+    vh.AddLeader(ids[0]);
+    for(size_t parent = 0; parent * MAX_SUBNODES + 1 < ids.size(); parent++){
+        size_t begin = parent * MAX_SUBNODES + 1;
+        size_t end = min(begin + MAX_SUBNODES, ids.size());
+        vh.AddSubNodesFor(vector<int>(ids.begin() + begin, ids.begin() + end), ids[parent]);
+    }
+}
+
+void TestMicroBenchmark(){
+    MicroBenchmark mb(g_microbench_options);
+
+    // ------------ 消息头的序列化 --------------
+    MessageHeader header(CONSTRUCT_MESSAGE, Mac48Address::GetBroadcast(), Mac48Address::Allocate());
+    header.SetPayloadSize(sizeof(ConstructInformation));
+    vector<uint8_t> tag_buffer(header.GetSerializedSize());
+    MicroBenchmarkCase c;
+    c.single_iteration = false;
+    c.name = "message_header_serialize";
+    c.size = tag_buffer.size();
+    c.body = [&](uint64_t n){
+        for(uint64_t i = 0; i < n; i++){
+            header.Serialize(TagBuffer(&tag_buffer[0], &tag_buffer[0] + tag_buffer.size()));
+            MicroBenchmark::DoNotOptimize(tag_buffer[0]);
+        }
+    };
+    mb.Add(c);
+    c.name = "message_header_deserialize";
+    c.body = [&](uint64_t n){
+        MessageHeader h;
+        for(uint64_t i = 0; i < n; i++){
+            h.Deserialize(TagBuffer(&tag_buffer[0], &tag_buffer[0] + tag_buffer.size()));
+            MicroBenchmark::DoNotOptimize(h.GetPayloadSize());
+        }
+    };
+    mb.Add(c);
+
+    // ------------ 载荷的编码和解码，与发送和ReceivePacket的路径相同 --------------
+    ConstructInformation ci = ConstructInformation();
+    ci.pos = Vector(1, 2, 0);
+    ci.task_id = 7;
+    c.name = "payload_encode";
+    c.size = sizeof(ci);
+    c.body = [&](uint64_t n){
+        for(uint64_t i = 0; i < n; i++){
+            Ptr<Packet> packet = Create<Packet>((uint8_t*)&ci, sizeof(ci));
+            packet->AddPacketTag(header);
+            MicroBenchmark::DoNotOptimize(packet->GetSize());
+        }
+    };
+    mb.Add(c);
+    //与发送心跳包相同：包发送后引用计数回到1，下一次从池中重用
+    PacketPool pool;
+    c.name = "payload_encode_pooled";
+    c.body = [&](uint64_t n){
+        for(uint64_t i = 0; i < n; i++){
+            Ptr<Packet> packet = pool.Get(header, (uint8_t*)&ci, sizeof(ci));
+            MicroBenchmark::DoNotOptimize(packet->GetSize());
+        }
+    };
+    mb.Add(c);
+    Ptr<Packet> encoded = Create<Packet>((uint8_t*)&ci, sizeof(ci));
+    encoded->AddPacketTag(header);
+    c.name = "payload_decode";
+    c.body = [&](uint64_t n){
+        for(uint64_t i = 0; i < n; i++){
+            MessageHeader tag;
+            encoded->PeekPacketTag(tag);
+            uint8_t* buffer = new uint8_t[tag.GetPayloadSize()];
+            encoded->CopyData(buffer, tag.GetPayloadSize());
+            MicroBenchmark::DoNotOptimize(((ConstructInformation*)buffer)->task_id);
+            delete[] buffer;
+        }
+    };
+    mb.Add(c);
+    //ReceivePacket现在的路径：复用接收缓冲区，按MessageSchema检查长度后复制到对齐的结构中
+    vector<uint8_t> rx_buffer;
+    c.name = "payload_decode_typed";
+    c.body = [&](uint64_t n){
+        for(uint64_t i = 0; i < n; i++){
+            MessageHeader tag;
+            encoded->PeekPacketTag(tag);
+            if(rx_buffer.size() < tag.GetPayloadSize()){
+                rx_buffer.resize(tag.GetPayloadSize());
+            }
+            encoded->CopyData(&rx_buffer[0], tag.GetPayloadSize());
+            ConstructInformation decoded = ConstructInformation();
+            if(ReadMessage(&rx_buffer[0], tag.GetPayloadSize(), decoded)){
+                MicroBenchmark::DoNotOptimize(decoded.task_id);
+            }
+        }
+    };
+    mb.Add(c);
+
+    // ------------ 路由表 --------------
+    const uint32_t router_sizes[] = {8, 64, 512, 4096};
+    vector< vector<Address> > router_keys;
+    vector< map<Address, Address> > routers;
+    for(uint32_t s = 0; s < sizeof(router_sizes) / sizeof(router_sizes[0]); s++){
+        vector<Address> keys;
+        map<Address, Address> router;
+        for(uint32_t i = 0; i < router_sizes[s]; i++){
+            keys.push_back(Mac48Address::Allocate());
+            router[keys.back()] = keys[i / MAX_SUBNODES];
+        }
+        //查找顺序打乱，避免总是命中缓存中相邻的节点
+        shuffle(keys.begin(), keys.end(), mt19937(s));
+        router_keys.push_back(keys);
+        routers.push_back(router);
+    }
+    for(size_t s = 0; s < routers.size(); s++){
+        c.name = "router_lookup";
+        c.size = router_sizes[s];
+        c.body = [&, s](uint64_t n){
+            const vector<Address>& keys = router_keys[s];
+            for(uint64_t i = 0; i < n; i++){
+                map<Address, Address>::iterator iter = routers[s].find(keys[i % keys.size()]);
+                MicroBenchmark::DoNotOptimize(iter != routers[s].end());
+            }
+        };
+        mb.Add(c);
+        //建立整个路由表，每次操作为size次插入
+        c.name = "router_build";
+        c.body = [&, s](uint64_t n){
+            const vector<Address>& keys = router_keys[s];
+            for(uint64_t i = 0; i < n; i++){
+                map<Address, Address> router;
+                for(size_t k = 0; k < keys.size(); k++){
+                    router[keys[k]] = keys[k / MAX_SUBNODES];
+                }
+                MicroBenchmark::DoNotOptimize(router.size());
+            }
+        };
+        mb.Add(c);
+    }
+
+    // ------------ 车群树 --------------
+    const uint32_t tree_sizes[] = {100, 1000, 10000};
+    for(uint32_t s = 0; s < sizeof(tree_sizes) / sizeof(tree_sizes[0]); s++){
+        vector<int> ids(tree_sizes[s]);
+        for(uint32_t i = 0; i < ids.size(); i++){
+            ids[i] = i;
+        }
+        c.name = "vgtree_build";
+        c.size = ids.size();
+        c.body = [ids](uint64_t n){
+            for(uint64_t i = 0; i < n; i++){
+                VGTreeHelper vh;
+                BuildGroupTree(vh, ids);
+                MicroBenchmark::DoNotOptimize(vh.GetTree()->c_num);
+                vh.Destroy();
+            }
+        };
+        mb.Add(c);
+    }
+
+    // ------------ GroupInitializer::Construct --------------
+    //每20个节点一个车群，相邻车群的leader互相连接；setup清空应用中Construct写入的状态
+    const uint32_t construct_sizes[] = {1000, 10000, 100000};
+    const uint32_t group_size = 20;
+    vector<NodeContainer> construct_nodes;
+    vector<GroupInitializer> initializers;
+    for(uint32_t s = 0; s < sizeof(construct_sizes) / sizeof(construct_sizes[0]); s++){
+        if(construct_sizes[s] > g_microbench_options.max_nodes){
+            break;
+        }
+        if(!g_microbench_options.filter.empty() && string("group_construct").find(g_microbench_options.filter) == string::npos){
+            break;
+        }
+        NodeContainer nodes;
+        CreateBenchmarkNodes(nodes, construct_sizes[s]);
+        GroupInitializer gi;
+        for(uint32_t begin = 0; begin < construct_sizes[s]; begin += group_size){
+            vector<int> ids;
+            for(uint32_t i = begin; i < min(begin + group_size, construct_sizes[s]); i++){
+                ids.push_back(i);
+            }
+            VGTreeHelper vh;
+            BuildGroupTree(vh, ids);
+            gi.AddGroup(vh.GetTree());
+            if(begin > 0){
+                gi.AddLink(begin - group_size, begin);
+            }
+        }
+        construct_nodes.push_back(nodes);
+        initializers.push_back(gi);
+    }
+    for(size_t s = 0; s < initializers.size(); s++){
+        c.name = "group_construct";
+        c.size = construct_nodes[s].GetN();
+        c.single_iteration = true;
+        c.setup = [&, s](){
+            NodeContainer& nodes = construct_nodes[s];
+            for(uint32_t i = 0; i < nodes.GetN(); i++){
+                Ptr<EvolutionApplication> app = DynamicCast<EvolutionApplication>(nodes.Get(i)->GetApplication(0));
+                app->m_router.clear();
+                app->m_next.clear();
+                app->m_neighbor_leaders.clear();
+            }
+        };
+        c.body = [&, s](uint64_t n){
+            initializers[s].Construct(construct_nodes[s]);
+        };
+        mb.Add(c);
+    }
 
+    mb.Run();
     Simulator::Destroy();
 }
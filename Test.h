@@ -1,8 +1,27 @@
 #ifndef TEST_H
 #define TEST_H
 
+#include "ScenarioGenerator.h"
+
+//benchmark的参数，在example-main.cc中解析
+typedef struct{
+    SyntheticScenario scenario;//合成场景
+    string workflow;//"construct"为车群建立，"obstacle"为预先建立车群后避障，"adjust"为预先建立车群后合并与分裂，"failover"为预先建立车群后leader失联
+    double sim_time;//仿真时间 单位s
+    uint32_t group_size;//obstacle流程中每个车群的车辆数
+    double hello_interval;//obstacle流程中成员发送心跳包的间隔，用于增加信标负载，为0则不发送 单位s
+    bool geocast;//obstacle流程中避障警告向障碍物周围的区域地理广播，而不是沿车群树传递
+} BenchmarkOptions;
+
+extern BenchmarkOptions g_benchmark_options;
+
 void TestGroupInitialer();
 void TestVGTreeHelper();
 void TestAvoidObstable();
 void TestConstructGroup();
+void TestBenchmark();
+void TestMicroBenchmark();
+void TestNodeMissing();
+void TestLateSpawn();
+void TestGridChannel();
 #endif
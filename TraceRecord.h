@@ -0,0 +1,38 @@
+#ifndef TRACE_RECORD_H
+#define TRACE_RECORD_H
+
+// 协议trace的二进制格式，不依赖ns-3，离线解码工具tools/trace-decoder.cc也使用这个头文件
+// 文件由一个TraceFileHeader和若干个定长的TraceRecord组成，字节序为本机字节序
+
+#include <stdint.h>
+
+const uint32_t TRACE_MAGIC = 0x52544756;//"VGTR"
+const uint16_t TRACE_VERSION = 1;
+
+typedef struct{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t record_size;//sizeof(TraceRecord)，解码时用于校验
+} TraceFileHeader;
+
+//记录的结果
+const uint8_t TRACE_SENT = 0;//交给设备发送
+const uint8_t TRACE_SEND_FAILED = 1;//设备拒绝发送（例如队列满）
+const uint8_t TRACE_NO_ROUTE = 2;//没有路由，丢弃
+const uint8_t TRACE_RECEIVED = 3;//收到
+
+typedef struct{
+    int64_t time_ns;//仿真时间 单位ns
+    uint32_t node;//记录的节点编号
+    uint16_t size;//数据包大小 单位byte
+    uint8_t type;//消息类型，包含GROUP_MESSAGE标志位
+    uint8_t outcome;//TRACE_SENT等
+    uint8_t src[6];//发送方mac地址
+    uint8_t dst[6];//接收方mac地址（下一跳）
+    uint32_t reserved;
+} TraceRecord;
+
+static_assert(sizeof(TraceFileHeader) == 8, "TraceFileHeader的大小必须固定");
+static_assert(sizeof(TraceRecord) == 32, "TraceRecord的大小必须固定");
+
+#endif
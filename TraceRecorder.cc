@@ -0,0 +1,194 @@
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "TraceRecorder.h"
+#include <cstring>
+#include <cstdlib>
+
+NS_LOG_COMPONENT_DEFINE("TraceRecorder");
+
+//每个缓冲区的记录数，8192条为256KB
+const size_t TRACE_BUFFER_RECORDS = 8192;
+
+TraceRecorder* TraceRecorder::Get(){
+    static TraceRecorder recorder;
+    return &recorder;
+}
+
+TraceRecorder::TraceRecorder(){
+    m_enabled = false;
+    m_file = NULL;
+    m_stop = false;
+    for(int i = 0; i < 128; i++){
+        m_type_mask[i] = true;
+    }
+}
+
+TraceRecorder::~TraceRecorder(){
+    Close();
+}
+
+bool TraceRecorder::Open(string path){
+    if(m_enabled){
+        NS_LOG_ERROR("trace文件已经打开");
+        return false;
+    }
+    m_file = fopen(path.c_str(), "wb");
+    if(!m_file){
+        NS_LOG_ERROR("无法打开trace文件 " << path);
+        return false;
+    }
+    m_path = path;
+    TraceFileHeader header;
+    header.magic = TRACE_MAGIC;
+    header.version = TRACE_VERSION;
+    header.record_size = sizeof(TraceRecord);
+    fwrite(&header, sizeof(header), 1, m_file);
+
+    m_stop = false;
+    m_writer = thread(&TraceRecorder::WriterLoop, this);
+    m_enabled = true;
+    return true;
+}
+
+void TraceRecorder::Close(){
+    if(!m_enabled){
+        return;
+    }
+    m_enabled = false;
+
+    //此时仿真已经结束，其它线程不会再写缓冲区
+    vector<Buffer*> buffers;
+    {
+        unique_lock<mutex> lock(m_mutex);
+        buffers = m_thread_buffers;
+    }
+    for(vector<Buffer*>::iterator iter = buffers.begin(); iter != buffers.end(); iter++){
+        if((*iter)->count > 0){
+            Submit(*iter);
+        }
+    }
+
+    {
+        unique_lock<mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cond.notify_one();
+    m_writer.join();
+    fclose(m_file);
+    m_file = NULL;
+
+    for(vector<TraceRecord*>::iterator iter = m_free.begin(); iter != m_free.end(); iter++){
+        delete[] *iter;
+    }
+    m_free.clear();
+}
+
+//解析逗号分隔的编号列表
+static vector<uint32_t> ParseIdList(string list){
+    vector<uint32_t> ids;
+    size_t begin = 0;
+    while(begin < list.size()){
+        size_t end = list.find(',', begin);
+        if(end == string::npos){
+            end = list.size();
+        }
+        if(end > begin){
+            ids.push_back(atoi(list.substr(begin, end - begin).c_str()));
+        }
+        begin = end + 1;
+    }
+    return ids;
+}
+
+void TraceRecorder::SetTypeFilter(string types){
+    vector<uint32_t> ids = ParseIdList(types);
+    for(int i = 0; i < 128; i++){
+        m_type_mask[i] = ids.empty();
+    }
+    for(vector<uint32_t>::iterator iter = ids.begin(); iter != ids.end(); iter++){
+        m_type_mask[*iter & 0x7f] = true;
+    }
+}
+
+void TraceRecorder::SetNodeFilter(string nodes){
+    vector<uint32_t> ids = ParseIdList(nodes);
+    m_node_mask.clear();
+    for(vector<uint32_t>::iterator iter = ids.begin(); iter != ids.end(); iter++){
+        if(*iter >= m_node_mask.size()){
+            m_node_mask.resize(*iter + 1, false);
+        }
+        m_node_mask[*iter] = true;
+    }
+}
+
+TraceRecorder::Buffer* TraceRecorder::GetThreadBuffer(){
+    static thread_local Buffer* t_buffer = NULL;
+    if(!t_buffer){
+        t_buffer = new Buffer;
+        t_buffer->records = new TraceRecord[TRACE_BUFFER_RECORDS];
+        t_buffer->count = 0;
+        unique_lock<mutex> lock(m_mutex);
+        m_thread_buffers.push_back(t_buffer);
+    }
+    return t_buffer;
+}
+
+void TraceRecorder::Append(uint32_t node, uint8_t type, const Address& src, const Address& dst, uint32_t size, uint8_t outcome){
+    Buffer* buffer = GetThreadBuffer();
+    TraceRecord& record = buffer->records[buffer->count++];
+    record.time_ns = Simulator::Now().GetNanoSeconds();
+    record.node = node;
+    record.size = size > 0xffff ? 0xffff : size;
+    record.type = type;
+    record.outcome = outcome;
+    record.reserved = 0;
+
+    //Address::CopyTo要求缓冲区不小于Address::MAX_SIZE
+    uint8_t mac[Address::MAX_SIZE];
+    memset(mac, 0, sizeof(mac));
+    src.CopyTo(mac);
+    memcpy(record.src, mac, 6);
+    memset(mac, 0, sizeof(mac));
+    dst.CopyTo(mac);
+    memcpy(record.dst, mac, 6);
+
+    if(buffer->count == TRACE_BUFFER_RECORDS){
+        Submit(buffer);
+    }
+}
+
+void TraceRecorder::Submit(Buffer* buffer){
+    {
+        unique_lock<mutex> lock(m_mutex);
+        m_full.push_back(make_pair(buffer->records, buffer->count));
+        if(m_free.empty()){
+            buffer->records = new TraceRecord[TRACE_BUFFER_RECORDS];
+        }
+        else{
+            buffer->records = m_free.back();
+            m_free.pop_back();
+        }
+        buffer->count = 0;
+    }
+    m_cond.notify_one();
+}
+
+void TraceRecorder::WriterLoop(){
+    unique_lock<mutex> lock(m_mutex);
+    while(true){
+        while(m_full.empty() && !m_stop){
+            m_cond.wait(lock);
+        }
+        if(m_full.empty()){
+            break;
+        }
+        pair<TraceRecord*, size_t> item = m_full.front();
+        m_full.pop_front();
+
+        //写文件时不持有锁
+        lock.unlock();
+        fwrite(item.first, sizeof(TraceRecord), item.second, m_file);
+        lock.lock();
+        m_free.push_back(item.first);
+    }
+}
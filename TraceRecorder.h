@@ -0,0 +1,92 @@
+#ifndef TRACE_RECORDER_H
+#define TRACE_RECORDER_H
+
+#include "ns3/address.h"
+#include "TraceRecord.h"
+#include <string>
+#include <vector>
+#include <deque>
+#include <cstdio>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+using namespace ns3;
+using namespace std;
+
+/*
+ * 协议层的二进制trace，替代pcap和cout调试输出
+ * 每个线程写自己的缓冲区，写满后交给后台线程写文件，仿真线程不做IO
+ * 可以按消息类型和节点过滤，文件用tools/trace-decoder.cc解码
+ */
+class TraceRecorder{
+public:
+    //全局唯一的实例
+    static TraceRecorder* Get();
+
+    //打开trace文件，打开后开始记录
+    bool Open(string path);
+
+    //写出所有缓冲区并关闭文件，仿真结束后调用
+    void Close();
+
+    //只记录这些消息类型，格式为逗号分隔的类型编号，例如"0,2,11"，空串表示全部记录
+    void SetTypeFilter(string types);
+
+    //只记录这些节点，格式为逗号分隔的节点编号，空串表示全部记录
+    void SetNodeFilter(string nodes);
+
+    bool IsEnabled(){
+        return m_enabled;
+    }
+
+    //当前trace文件的路径，没有打开时为空
+    string GetPath(){
+        return m_enabled ? m_path : "";
+    }
+
+    //记录一条消息，未打开或被过滤时直接返回
+    void Record(uint32_t node, uint8_t type, const Address& src, const Address& dst, uint32_t size, uint8_t outcome){
+        if(!m_enabled || !m_type_mask[type & 0x7f] || (!m_node_mask.empty() && (node >= m_node_mask.size() || !m_node_mask[node]))){
+            return;
+        }
+        Append(node, type, src, dst, size, outcome);
+    }
+
+private:
+    //每个线程的缓冲区
+    typedef struct{
+        TraceRecord* records;
+        size_t count;
+    } Buffer;
+
+    TraceRecorder();
+    ~TraceRecorder();
+
+    void Append(uint32_t node, uint8_t type, const Address& src, const Address& dst, uint32_t size, uint8_t outcome);
+
+    //取得当前线程的缓冲区，第一次调用时分配
+    Buffer* GetThreadBuffer();
+
+    //把写满的缓冲区交给后台线程，并换一个空的缓冲区
+    void Submit(Buffer* buffer);
+
+    //后台线程：把提交的缓冲区写入文件
+    void WriterLoop();
+
+    bool m_enabled;
+    bool m_type_mask[128];//下标为去掉GROUP_MESSAGE标志后的类型
+    vector<bool> m_node_mask;//为空表示不过滤
+
+    string m_path;
+    FILE* m_file;
+    thread m_writer;
+    mutex m_mutex;
+    condition_variable m_cond;
+    bool m_stop;
+    deque< pair<TraceRecord*, size_t> > m_full;//等待写入的缓冲区和其中的记录数
+    vector<TraceRecord*> m_free;//可以复用的缓冲区
+    vector<Buffer*> m_thread_buffers;//所有线程的缓冲区，关闭时写出
+};
+
+#endif
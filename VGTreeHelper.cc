@@ -93,3 +93,18 @@ void VGTreeHelper::PrintTree(VGTree* T){
 VGTree* VGTreeHelper::GetTree(){
     return root;
 }
+
+uint64_t VGTreeHelper::GetMemoryBytes(VGTree* t){
+    if(!t){
+        return 0;
+    }
+    uint64_t bytes = sizeof(VGTree);
+    for(int i=0; i<t->c_num; i++){
+        bytes += GetMemoryBytes(t->child[i]);
+    }
+    return bytes;
+}
+
+uint64_t VGTreeHelper::GetMemoryBytes(){
+    return GetMemoryBytes(root) + MapBytes(id2Tree);
+}
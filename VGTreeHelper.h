@@ -1,6 +1,7 @@
 #include <iostream>
 #include <vector>
 #include <map>
+#include "MemoryAccounting.h"
 using namespace std;
 #define MAX_CHILD_NUN 10//最大子节点个数
 
@@ -48,4 +49,10 @@ public:
     
     //获取root
     VGTree* GetTree();
+
+    //以t为根的树占用的内存 单位byte
+    static uint64_t GetMemoryBytes(VGTree* t);
+
+    //当前树和索引占用的内存 单位byte
+    uint64_t GetMemoryBytes();
 };
@@ -10,8 +10,17 @@
 #include "ns3/netanim-module.h"
 #include "EvolutionApplication.h"
 #include "GroupInitializer.h"
+#include "ScenarioHelper.h"
+#include "TraceRecorder.h"
+#include "EventLog.h"
+#include "HandlerProfiler.h"
 #include "Test.h"
+#include "MicroBenchmark.h"
+#include "SimulationBranch.h"
 #include "string"
+#ifdef NS3_MPI
+#include "ns3/mpi-interface.h"
+#endif
 using namespace ns3;
 using namespace std;
 
@@ -21,23 +30,121 @@ int main (int argc, char *argv[])
 {
     string testCase = "test";
     string tclFilePath = "scratch/ns3-vehicle-group-simulation/sumofiles/test.tcl";
+    string traceFile = "";
+    string traceTypes = "";
+    string traceNodes = "";
+    string eventLogFile = "";
+    string profileFile = "";
+    double profileSampleInterval = 0.1;
+    bool distributed = false;
     
     CommandLine cmd;
     cmd.AddValue("testCase", "通过指定testCase对main函数进行个性化修改", testCase);
     cmd.AddValue("tclFilePath", "要加载的tcl文件位置", tclFilePath);
+    cmd.AddValue("lazyActivation", "车辆在trace中出现时才安装设备，离开后设备休眠", g_scenario_options.lazy_activation);
+    cmd.AddValue("gridChannel", "使用按网格划分的信道，只向通信距离内的车辆投递", g_scenario_options.grid_channel);
+    cmd.AddValue("linkLayer", "链路层：wifi为完整的802.11p，abstract为按距离投递的轻量设备（参数见ns3::AbstractChannel）", g_scenario_options.link_layer);
+    cmd.AddValue("pcap", "为WAVE设备生成pcap", g_scenario_options.pcap);
+    cmd.AddValue("traceFile", "协议trace的输出文件，用tools/trace-decoder解码，为空则不记录", traceFile);
+    cmd.AddValue("traceTypes", "只记录这些消息类型，逗号分隔，例如0,2,11", traceTypes);
+    cmd.AddValue("traceNodes", "只记录这些节点，逗号分隔", traceNodes);
+    cmd.AddValue("eventLog", "结构化事件日志的输出文件，用tools/event-log-reader读取，为空则不记录（级别在编译时由EVENT_LOG_LEVEL决定）", eventLogFile);
+    cmd.AddValue("profile", "协议处理函数的性能分析输出文件（折叠栈格式，另有.summary和.queue），为空则不分析", profileFile);
+    cmd.AddValue("profileSampleInterval", "性能分析时事件队列长度的采样周期 单位s（仿真时间）", profileSampleInterval);
+    cmd.AddValue("memoryFile", "周期性统计协议内存（每节点平均、最大和总量）并写到这个文件，为空则只在仿真结束时统计", g_scenario_options.memory_file);
+    cmd.AddValue("memoryInterval", "周期性统计协议内存的间隔 单位s", g_scenario_options.memory_interval);
+    cmd.AddValue("checkpointFile", "在checkpointTime把车群状态保存到这个文件，为空则不保存", g_scenario_options.checkpoint_file);
+    cmd.AddValue("checkpointTime", "保存检查点的时间 单位s", g_scenario_options.checkpoint_time);
+    cmd.AddValue("restoreFile", "从检查点恢复车群状态，检查点时间之前不运行协议，为空则不恢复", g_scenario_options.restore_file);
+    cmd.AddValue("branchTime", "在这个时间fork出各分支，每个分支施加不同的扰动后继续仿真，结果文件加.branch<k>后缀，为负则不分支 单位s", g_scenario_options.branch_time);
+    cmd.AddValue("branchPerturbations", "各分支的扰动，分支之间用|分开，例如\"obstacle=80,-4.8|missing=3;safeDistance=30\"，父进程为不加扰动的分支0", g_scenario_options.branch_perturbations);
+    cmd.AddValue("qos", "使用QoS WAVE MAC，安全消息、车群控制消息和信标分别使用AC_VO、AC_VI和AC_BE，关闭时所有消息在同一个队列中", g_scenario_options.qos);
+    cmd.AddValue("channelMode", "single为单信道，alternating为WaveNetDevice在CCH/SCH之间交替接入，continuous为CCH和SCH上各一个射频（多信道只支持--linkLayer=wifi）", g_scenario_options.channel_mode);
+    cmd.AddValue("cchMessages", "多信道时使用控制信道的消息类型，逗号分隔的名字或编号，其它消息使用服务信道", g_scenario_options.cch_messages);
+    cmd.AddValue("metricsFile", "仿真结束后把统计指标写到这个文件，供tools/sweep-runner汇总", g_scenario_options.metrics_file);
+    cmd.AddValue("road", "benchmark：highway为多车道双向高速公路，urban为方格路网", g_benchmark_options.scenario.road);
+    cmd.AddValue("vehicles", "benchmark：车辆数", g_benchmark_options.scenario.vehicles);
+    cmd.AddValue("density", "benchmark：每条车道每公里的车辆数", g_benchmark_options.scenario.density);
+    cmd.AddValue("lanes", "benchmark：高速公路每个方向的车道数", g_benchmark_options.scenario.lanes);
+    cmd.AddValue("blockSize", "benchmark：方格路网的街区边长 单位m", g_benchmark_options.scenario.block_size);
+    cmd.AddValue("speedMean", "benchmark：车速均值 单位m/s", g_benchmark_options.scenario.speed_mean);
+    cmd.AddValue("speedStddev", "benchmark：车速标准差 单位m/s", g_benchmark_options.scenario.speed_stddev);
+    cmd.AddValue("workflow", "benchmark：construct为车群建立，obstacle为预先建立车群后避障，adjust为预先建立车群后合并与分裂，failover为预先建立车群后leader失联、由备用leader接替", g_benchmark_options.workflow);
+    cmd.AddValue("simTime", "benchmark：仿真时间 单位s", g_benchmark_options.sim_time);
+    cmd.AddValue("helloInterval", "benchmark：obstacle流程中成员发送心跳包的间隔，用于增加信标负载，为0则不发送 单位s", g_benchmark_options.hello_interval);
+    cmd.AddValue("geocast", "benchmark：obstacle流程中避障警告向障碍物周围的区域地理广播，而不是沿车群树传递", g_benchmark_options.geocast);
+    cmd.AddValue("groupSize", "benchmark：每个车群（或每个建立任务）的车辆数", g_benchmark_options.group_size);
+    cmd.AddValue("microbenchFilter", "microbench：只运行名字包含这个字符串的用例", g_microbench_options.filter);
+    cmd.AddValue("microbenchJson", "microbench：结果写到这个JSON文件", g_microbench_options.json_file);
+    cmd.AddValue("microbenchWarmup", "microbench：预热次数", g_microbench_options.warmup);
+    cmd.AddValue("microbenchReps", "microbench：计时的重复次数", g_microbench_options.repetitions);
+    cmd.AddValue("microbenchMinTime", "microbench：每次重复至少运行的时间 单位s", g_microbench_options.min_time);
+    cmd.AddValue("microbenchMaxNodes", "microbench：GroupInitializer::Construct用例的最大节点数", g_microbench_options.max_nodes);
+    cmd.AddValue("distributed", "使用MPI分布式仿真（需要以--enable-mpi编译ns-3，并配合--linkLayer=abstract），例如mpirun -np 4", distributed);
     cmd.Parse (argc, argv);
 
+    if (distributed) {
+#ifdef NS3_MPI
+        GlobalValue::Bind ("SimulatorImplementationType", StringValue ("ns3::DistributedSimulatorImpl"));
+        MpiInterface::Enable (&argc, &argv);
+        //每个进程写自己的trace文件
+        if (!traceFile.empty() && MpiInterface::GetSize() > 1) {
+            traceFile += ".rank" + to_string(MpiInterface::GetSystemId());
+        }
+        if (!eventLogFile.empty() && MpiInterface::GetSize() > 1) {
+            eventLogFile += ".rank" + to_string(MpiInterface::GetSystemId());
+        }
+        if (!profileFile.empty() && MpiInterface::GetSize() > 1) {
+            profileFile += ".rank" + to_string(MpiInterface::GetSystemId());
+        }
+#else
+        NS_FATAL_ERROR ("ns-3没有以--enable-mpi编译，不能使用--distributed");
+#endif
+    }
+
     cout<<"testCase: "<< testCase <<endl;
     cout<<"tclFilePath: "<< tclFilePath <<endl;
     cout<<endl;
     
+    if (!traceFile.empty()) {
+        TraceRecorder::Get()->SetTypeFilter(traceTypes);
+        TraceRecorder::Get()->SetNodeFilter(traceNodes);
+        TraceRecorder::Get()->Open(traceFile);
+    }
+    if (!eventLogFile.empty()) {
+        EventLog::Get()->Open(eventLogFile);
+    }
+    if (!profileFile.empty()) {
+        HandlerProfiler::Get()->Open(profileFile, Seconds(profileSampleInterval));
+    }
+    
     if (testCase == "avoidObstacle") {
         TestAvoidObstable();
     } else if(testCase == "constructGroup"){
         TestConstructGroup();
+    } else if(testCase == "benchmark"){
+        TestBenchmark();
+    } else if(testCase == "microbench"){
+        TestMicroBenchmark();
+    } else if(testCase == "nodeMissing"){
+        TestNodeMissing();
+    } else if(testCase == "lateSpawn"){
+        TestLateSpawn();
+    } else if(testCase == "gridChannel"){
+        TestGridChannel();
     } else {
         TestGroupInitialer();
     }
     
+    TraceRecorder::Get()->Close();
+    EventLog::Get()->Close();
+    HandlerProfiler::Get()->Close();
+    //分支的父进程等待各分支结束
+    SimulationBranch::WaitChildren();
+#ifdef NS3_MPI
+    if (distributed) {
+        MpiInterface::Disable ();
+    }
+#endif
     return 0;
 }
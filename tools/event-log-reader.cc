@@ -0,0 +1,154 @@
+// 结构化事件日志的离线读取工具，不依赖ns-3
+// 编译：g++ -O2 -std=c++11 -o event-log-reader tools/event-log-reader.cc
+// 用法：event-log-reader <日志文件> [--summary] [--level=N] [--node=N] [--event=名字] [--sort]
+// 默认每条记录输出一行：time_s node level event key=value ...
+// --level=N只输出级别不大于N的记录（0 ERROR,1 WARN,2 INFO,3 DEBUG）
+// --sort按时间排序，多线程写入时各缓冲区的记录是分块写入的
+// --summary只输出每种事件的条数
+
+#include "../EventLogRecord.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+
+static const char* LevelName(uint8_t level){
+    static const char* names[] = {"ERROR", "WARN", "INFO", "DEBUG"};
+    return level <= EVENT_LEVEL_DEBUG ? names[level] : "UNKNOWN";
+}
+
+static string FormatArg(char kind, uint64_t arg){
+    char buffer[32];
+    if(kind == 'm'){
+        snprintf(buffer, sizeof(buffer), "%02x:%02x:%02x:%02x:%02x:%02x",
+                 (unsigned)(arg >> 40) & 0xff, (unsigned)(arg >> 32) & 0xff, (unsigned)(arg >> 24) & 0xff,
+                 (unsigned)(arg >> 16) & 0xff, (unsigned)(arg >> 8) & 0xff, (unsigned)arg & 0xff);
+    }
+    else{
+        snprintf(buffer, sizeof(buffer), "%llu", (unsigned long long)arg);
+    }
+    return buffer;
+}
+
+static bool EarlierThan(const EventLogRecord& a, const EventLogRecord& b){
+    return a.time_ns < b.time_ns;
+}
+
+static void PrintRecord(const EventLogRecord& r){
+    printf("%.9f %u %s", r.time_ns / 1e9, r.node, LevelName(r.level));
+    if(r.event >= EVENT_COUNT){
+        printf(" UNKNOWN(%u)\n", r.event);
+        return;
+    }
+    const EventDescription& desc = EVENT_LOG_TABLE[r.event];
+    printf(" %s", desc.name);
+    for(uint32_t a = 0; a < EVENT_LOG_MAX_ARGS; a++){
+        if(desc.arg_kinds[a] != '-'){
+            printf(" %s=%s", desc.arg_names[a], FormatArg(desc.arg_kinds[a], r.args[a]).c_str());
+        }
+    }
+    printf("\n");
+}
+
+int main(int argc, char* argv[]){
+    if(argc < 2){
+        fprintf(stderr, "用法: %s <日志文件> [--summary] [--level=N] [--node=N] [--event=名字] [--sort]\n", argv[0]);
+        return 1;
+    }
+
+    bool summary = false;
+    bool sort_by_time = false;
+    int level_filter = EVENT_LEVEL_DEBUG;
+    long node_filter = -1;
+    int event_filter = -1;
+    for(int i = 2; i < argc; i++){
+        if(strcmp(argv[i], "--summary") == 0){
+            summary = true;
+        }
+        else if(strcmp(argv[i], "--sort") == 0){
+            sort_by_time = true;
+        }
+        else if(strncmp(argv[i], "--level=", 8) == 0){
+            level_filter = atoi(argv[i] + 8);
+        }
+        else if(strncmp(argv[i], "--node=", 7) == 0){
+            node_filter = atol(argv[i] + 7);
+        }
+        else if(strncmp(argv[i], "--event=", 8) == 0){
+            for(int e = 0; e < EVENT_COUNT; e++){
+                if(strcmp(EVENT_LOG_TABLE[e].name, argv[i] + 8) == 0){
+                    event_filter = e;
+                }
+            }
+            if(event_filter < 0){
+                fprintf(stderr, "未知事件 %s\n", argv[i] + 8);
+                return 1;
+            }
+        }
+        else{
+            fprintf(stderr, "未知参数 %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    FILE* file = fopen(argv[1], "rb");
+    if(!file){
+        fprintf(stderr, "无法打开 %s\n", argv[1]);
+        return 1;
+    }
+    EventLogFileHeader header;
+    if(fread(&header, sizeof(header), 1, file) != 1 || header.magic != EVENT_LOG_MAGIC){
+        fprintf(stderr, "%s 不是事件日志文件\n", argv[1]);
+        return 1;
+    }
+    if(header.version != EVENT_LOG_VERSION || header.record_size != sizeof(EventLogRecord)){
+        fprintf(stderr, "日志版本%u(记录%u字节)与读取工具版本%u(记录%u字节)不一致\n",
+                header.version, header.record_size, EVENT_LOG_VERSION, (unsigned)sizeof(EventLogRecord));
+        return 1;
+    }
+
+    vector<EventLogRecord> sorted;//--sort时全部读入内存后再输出
+    vector<uint64_t> counts(EVENT_COUNT + 1, 0);//最后一个为未知事件
+    vector<EventLogRecord> records(4096);
+    size_t n;
+    while((n = fread(&records[0], sizeof(EventLogRecord), records.size(), file)) > 0){
+        for(size_t i = 0; i < n; i++){
+            const EventLogRecord& r = records[i];
+            if(r.level > level_filter ||
+               (node_filter >= 0 && r.node != (uint32_t)node_filter) ||
+               (event_filter >= 0 && r.event != event_filter)){
+                continue;
+            }
+            if(summary){
+                counts[r.event < EVENT_COUNT ? (uint32_t)r.event : (uint32_t)EVENT_COUNT]++;
+            }
+            else if(sort_by_time){
+                sorted.push_back(r);
+            }
+            else{
+                PrintRecord(r);
+            }
+        }
+    }
+    fclose(file);
+
+    if(sort_by_time){
+        stable_sort(sorted.begin(), sorted.end(), EarlierThan);
+        for(size_t i = 0; i < sorted.size(); i++){
+            PrintRecord(sorted[i]);
+        }
+    }
+    if(summary){
+        printf("event,count\n");
+        for(int e = 0; e <= EVENT_COUNT; e++){
+            if(counts[e] > 0){
+                printf("%s,%llu\n", e < EVENT_COUNT ? EVENT_LOG_TABLE[e].name : "UNKNOWN", (unsigned long long)counts[e]);
+            }
+        }
+    }
+    return 0;
+}
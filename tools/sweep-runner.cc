@@ -0,0 +1,435 @@
+// 多进程参数扫描工具，不依赖ns-3
+// 编译：g++ -O2 -std=c++11 -o sweep-runner tools/sweep-runner.cc
+// 用法（在ns-3根目录下的./waf shell中运行，保证能找到ns-3的动态库和相对路径的trace文件）：
+//   sweep-runner <仿真程序> <参数表> <结果文件> [--jobs=N] [--memLimitMb=N] [--logDir=目录]
+// 仿真程序一般为build/scratch/ns3-vehicle-group-simulation/ns3-vehicle-group-simulation
+//
+// 参数表每行为一个命令行参数名和它的所有取值，#开头为注释，a..b表示整数区间，例如：
+//   testCase constructGroup
+//   linkLayer abstract
+//   ns3::EvolutionApplication::Interval 250ms 500ms 1s
+//   ns3::EvolutionApplication::MaxSubnodes 3 5 8
+//   RngRun 1..20
+// 每个参数组合（一个格子）单独fork一个进程运行，参数以--名字=值传给仿真程序，
+// RngRun使每个进程使用独立的随机数流。
+// 结果文件为制表符分隔的列式文件，列依次为各参数、status、wall_s和仿真程序--metricsFile输出的指标，
+// 每完成一个格子追加一行；重新运行时只跳过status为ok的格子，失败的格子（exitN、signalN，
+// 包括超过--memLimitMb被杀死的）会重跑，新的结果替换原来的行。
+// 后来的运行输出了表头中没有的指标时增加一列并重写结果文件，之前的行补NA。
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+using namespace std;
+
+typedef struct{
+    string name;
+    vector<string> values;
+} SweepParameter;
+
+typedef struct{
+    vector<string> values;
+    string status;
+    double wall;
+} PendingRow;
+
+typedef struct{
+    size_t cell;//格子编号
+    double start;//开始时间 单位s
+    string metrics_path;
+} RunningCell;
+
+static double NowSeconds(){
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static vector<string> Split(const string& line, char sep){
+    vector<string> fields;
+    string field;
+    istringstream in(line);
+    while(getline(in, field, sep)){
+        fields.push_back(field);
+    }
+    return fields;
+}
+
+//读取参数表，a..b展开为整数区间
+static vector<SweepParameter> LoadGrid(const char* path){
+    ifstream file(path);
+    if(!file.is_open()){
+        fprintf(stderr, "无法打开参数表 %s\n", path);
+        exit(1);
+    }
+    vector<SweepParameter> params;
+    string line;
+    while(getline(file, line)){
+        if(line.empty() || line[0] == '#'){
+            continue;
+        }
+        istringstream in(line);
+        SweepParameter param;
+        string value;
+        if(!(in >> param.name)){
+            continue;
+        }
+        while(in >> value){
+            size_t dots = value.find("..");
+            if(dots == string::npos){
+                param.values.push_back(value);
+                continue;
+            }
+            long first = atol(value.substr(0, dots).c_str());
+            long last = atol(value.substr(dots + 2).c_str());
+            for(long v = first; v <= last; v++){
+                ostringstream out;
+                out << v;
+                param.values.push_back(out.str());
+            }
+        }
+        if(param.values.empty()){
+            fprintf(stderr, "参数 %s 没有取值\n", param.name.c_str());
+            exit(1);
+        }
+        params.push_back(param);
+    }
+    return params;
+}
+
+//第cell个格子中各参数的取值，最后一个参数变化最快
+static vector<string> CellValues(const vector<SweepParameter>& params, size_t cell){
+    vector<string> values(params.size());
+    for(size_t i = params.size(); i-- > 0;){
+        values[i] = params[i].values[cell % params[i].values.size()];
+        cell /= params[i].values.size();
+    }
+    return values;
+}
+
+static string JoinTab(const vector<string>& fields){
+    string line;
+    for(size_t i = 0; i < fields.size(); i++){
+        if(i > 0){
+            line += '\t';
+        }
+        line += fields[i];
+    }
+    return line;
+}
+
+class ResultsFile{
+public:
+    //读入已有的结果，返回已经成功完成（status为ok）的格子（各参数取值用制表符连接）
+    set<string> Load(const string& path, const vector<SweepParameter>& params){
+        m_path = path;
+        m_n_params = params.size();
+        m_header.clear();
+        for(size_t i = 0; i < params.size(); i++){
+            m_header.push_back(params[i].name);
+        }
+        m_header.push_back("status");
+        m_header.push_back("wall_s");
+
+        set<string> done;
+        ifstream file(path.c_str());
+        string line;
+        bool has_header = false;
+        while(getline(file, line)){
+            vector<string> fields = Split(line, '\t');
+            if(!has_header){
+                for(size_t i = 0; i < params.size(); i++){
+                    if(i >= fields.size() || fields[i] != params[i].name){
+                        fprintf(stderr, "结果文件 %s 的列与参数表不一致\n", path.c_str());
+                        exit(1);
+                    }
+                }
+                //参数列之后是status和wall_s，再之后是指标
+                for(size_t i = params.size() + 2; i < fields.size(); i++){
+                    m_metric_names.push_back(fields[i]);
+                }
+                has_header = true;
+                continue;
+            }
+            if(fields.size() < params.size() + 1){
+                continue;
+            }
+            fields.resize(m_header.size() + m_metric_names.size(), "NA");
+            string key = Key(fields);
+            if(fields[params.size()] == "ok"){
+                done.insert(key);
+            }
+            Store(key, fields);
+        }
+        //没有结果文件时先写出表头，指标列在第一次有指标输出时再加上
+        if(!has_header){
+            Rewrite();
+        }
+        return done;
+    }
+
+    //记录一个格子的结果：新的格子追加一行，重跑的格子替换原来的行，
+    //出现表头中没有的指标时增加列，之前的行补NA，这两种情况都重写整个文件
+    void Append(const vector<string>& values, const string& status, double wall, const vector< pair<string, string> >& metrics){
+        bool rewrite = false;
+        for(size_t i = 0; i < metrics.size(); i++){
+            if(find(m_metric_names.begin(), m_metric_names.end(), metrics[i].first) == m_metric_names.end()){
+                m_metric_names.push_back(metrics[i].first);
+                for(size_t r = 0; r < m_rows.size(); r++){
+                    m_rows[r].push_back("NA");
+                }
+                rewrite = true;
+            }
+        }
+        vector<string> row = Row(values, status, wall, metrics);
+        string key = Key(row);
+        if(m_index.find(key) != m_index.end()){
+            rewrite = true;
+        }
+        Store(key, row);
+        if(rewrite){
+            Rewrite();
+            return;
+        }
+        FILE* file = fopen(m_path.c_str(), "a");
+        if(!file){
+            fprintf(stderr, "无法写入结果文件 %s\n", m_path.c_str());
+            exit(1);
+        }
+        fprintf(file, "%s\n", JoinTab(row).c_str());
+        fclose(file);
+    }
+
+private:
+    string Key(const vector<string>& fields){
+        return JoinTab(vector<string>(fields.begin(), fields.begin() + m_n_params));
+    }
+
+    void Store(const string& key, const vector<string>& row){
+        map<string, size_t>::iterator iter = m_index.find(key);
+        if(iter != m_index.end()){
+            m_rows[iter->second] = row;
+            return;
+        }
+        m_index[key] = m_rows.size();
+        m_rows.push_back(row);
+    }
+
+    //写到临时文件后改名，中途被打断时原来的结果文件不受影响
+    void Rewrite(){
+        string tmp_path = m_path + ".tmp";
+        FILE* file = fopen(tmp_path.c_str(), "w");
+        if(!file){
+            fprintf(stderr, "无法写入结果文件 %s\n", tmp_path.c_str());
+            exit(1);
+        }
+        vector<string> header = m_header;
+        header.insert(header.end(), m_metric_names.begin(), m_metric_names.end());
+        fprintf(file, "%s\n", JoinTab(header).c_str());
+        for(size_t r = 0; r < m_rows.size(); r++){
+            fprintf(file, "%s\n", JoinTab(m_rows[r]).c_str());
+        }
+        fclose(file);
+        if(rename(tmp_path.c_str(), m_path.c_str()) != 0){
+            fprintf(stderr, "无法写入结果文件 %s\n", m_path.c_str());
+            exit(1);
+        }
+    }
+
+    vector<string> Row(const vector<string>& values, const string& status, double wall, const vector< pair<string, string> >& metrics){
+        vector<string> fields = values;
+        fields.push_back(status);
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), "%.3f", wall);
+        fields.push_back(buffer);
+        //按表头的顺序输出指标，缺少的为NA
+        for(size_t i = 0; i < m_metric_names.size(); i++){
+            string value = "NA";
+            for(size_t j = 0; j < metrics.size(); j++){
+                if(metrics[j].first == m_metric_names[i]){
+                    value = metrics[j].second;
+                    break;
+                }
+            }
+            fields.push_back(value);
+        }
+        return fields;
+    }
+
+    string m_path;
+    size_t m_n_params;
+    vector<string> m_header;//参数列、status、wall_s
+    vector<string> m_metric_names;
+    vector< vector<string> > m_rows;//结果文件中的所有行，按第一次出现的顺序
+    map<string, size_t> m_index;//格子 -> m_rows中的下标
+};
+
+//读取仿真程序写出的指标，每行为"指标名\t值"
+static vector< pair<string, string> > LoadMetrics(const string& path){
+    vector< pair<string, string> > metrics;
+    ifstream file(path.c_str());
+    string line;
+    while(getline(file, line)){
+        size_t tab = line.find('\t');
+        if(tab != string::npos){
+            metrics.push_back(make_pair(line.substr(0, tab), line.substr(tab + 1)));
+        }
+    }
+    return metrics;
+}
+
+//在子进程中运行一个格子，不返回
+static void RunCell(const string& binary, const vector<SweepParameter>& params, const vector<string>& values,
+                    const string& metrics_path, long mem_limit_mb, const string& log_path){
+    if(mem_limit_mb > 0){
+        rlimit limit;
+        limit.rlim_cur = limit.rlim_max = (rlim_t)mem_limit_mb * 1024 * 1024;
+        setrlimit(RLIMIT_AS, &limit);
+    }
+    int fd = open(log_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(fd >= 0){
+        dup2(fd, STDOUT_FILENO);
+        dup2(fd, STDERR_FILENO);
+        close(fd);
+    }
+
+    vector<string> args;
+    args.push_back(binary);
+    for(size_t i = 0; i < params.size(); i++){
+        args.push_back("--" + params[i].name + "=" + values[i]);
+    }
+    args.push_back("--metricsFile=" + metrics_path);
+    vector<char*> argv;
+    for(size_t i = 0; i < args.size(); i++){
+        argv.push_back(const_cast<char*>(args[i].c_str()));
+    }
+    argv.push_back(NULL);
+    execv(binary.c_str(), &argv[0]);
+    perror("execv");
+    _exit(127);
+}
+
+int main(int argc, char* argv[]){
+    if(argc < 4){
+        fprintf(stderr, "用法: %s <仿真程序> <参数表> <结果文件> [--jobs=N] [--memLimitMb=N] [--logDir=目录]\n", argv[0]);
+        return 1;
+    }
+    string binary = argv[1];
+    string results_path = argv[3];
+    long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+    long mem_limit_mb = 0;
+    string log_dir = "";
+    for(int i = 4; i < argc; i++){
+        if(strncmp(argv[i], "--jobs=", 7) == 0){
+            jobs = atol(argv[i] + 7);
+        }
+        else if(strncmp(argv[i], "--memLimitMb=", 13) == 0){
+            mem_limit_mb = atol(argv[i] + 13);
+        }
+        else if(strncmp(argv[i], "--logDir=", 9) == 0){
+            log_dir = argv[i] + 9;
+        }
+        else{
+            fprintf(stderr, "未知参数 %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if(jobs < 1){
+        jobs = 1;
+    }
+
+    vector<SweepParameter> params = LoadGrid(argv[2]);
+    size_t n_cells = 1;
+    for(size_t i = 0; i < params.size(); i++){
+        n_cells *= params[i].values.size();
+    }
+
+    ResultsFile results;
+    set<string> done = results.Load(results_path, params);
+    vector<size_t> todo;
+    for(size_t cell = 0; cell < n_cells; cell++){
+        if(done.find(JoinTab(CellValues(params, cell))) == done.end()){
+            todo.push_back(cell);
+        }
+    }
+    fprintf(stderr, "共%zu个格子，已完成%zu个，待运行%zu个，并行%ld个进程\n",
+            n_cells, n_cells - todo.size(), todo.size(), jobs);
+
+    map<pid_t, RunningCell> running;
+    size_t next = 0;
+    size_t finished = 0;
+    double sweep_start = NowSeconds();
+    while(next < todo.size() || !running.empty()){
+        //保持jobs个子进程在运行
+        while(next < todo.size() && (long)running.size() < jobs){
+            RunningCell rc;
+            rc.cell = todo[next++];
+            ostringstream metrics_path;
+            metrics_path << results_path << "." << getpid() << "." << rc.cell << ".metrics";
+            rc.metrics_path = metrics_path.str();
+            string log_path = "/dev/null";
+            if(!log_dir.empty()){
+                ostringstream out;
+                out << log_dir << "/cell-" << rc.cell << ".log";
+                log_path = out.str();
+            }
+            vector<string> values = CellValues(params, rc.cell);
+            rc.start = NowSeconds();
+            pid_t pid = fork();
+            if(pid < 0){
+                perror("fork");
+                return 1;
+            }
+            if(pid == 0){
+                RunCell(binary, params, values, rc.metrics_path, mem_limit_mb, log_path);
+            }
+            running[pid] = rc;
+        }
+
+        int wstatus;
+        pid_t pid = waitpid(-1, &wstatus, 0);
+        if(pid < 0){
+            perror("waitpid");
+            return 1;
+        }
+        map<pid_t, RunningCell>::iterator iter = running.find(pid);
+        if(iter == running.end()){
+            continue;
+        }
+        RunningCell rc = iter->second;
+        running.erase(iter);
+        double wall = NowSeconds() - rc.start;
+
+        char status[32];
+        if(WIFEXITED(wstatus)){
+            snprintf(status, sizeof(status), WEXITSTATUS(wstatus) == 0 ? "ok" : "exit%d", WEXITSTATUS(wstatus));
+        }
+        else{
+            snprintf(status, sizeof(status), "signal%d", WTERMSIG(wstatus));
+        }
+        vector< pair<string, string> > metrics;
+        if(strcmp(status, "ok") == 0){
+            metrics = LoadMetrics(rc.metrics_path);
+        }
+        unlink(rc.metrics_path.c_str());
+        vector<string> values = CellValues(params, rc.cell);
+        results.Append(values, status, wall, metrics);
+        finished++;
+        fprintf(stderr, "[%zu/%zu] %s %s %.1fs\n", finished, todo.size(), JoinTab(values).c_str(), status, wall);
+    }
+    fprintf(stderr, "完成，用时%.1fs\n", NowSeconds() - sweep_start);
+    return 0;
+}
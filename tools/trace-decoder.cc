@@ -0,0 +1,127 @@
+// 协议trace的离线解码工具，不依赖ns-3
+// 编译：g++ -O2 -std=c++11 -o trace-decoder tools/trace-decoder.cc
+// 用法：trace-decoder <trace文件> [--summary] [--type=N] [--node=N] [--outcome=N]
+// 默认每条记录输出一行CSV：time_s,node,type,group,outcome,src,dst,size
+// --summary只输出按消息类型和结果统计的条数
+
+#include "../TraceRecord.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <map>
+#include <vector>
+
+using namespace std;
+
+//与MessageHeader.h中的消息类型一致
+static const char* TypeName(uint8_t type){
+    static const char* names[] = {
+        "HELLO", "HELLO_R", "CONSTRUCT_MESSAGE", "REPLY_MESSAGE", "COMFIRM_MESSAGE",
+        "ERROR_MESSAGE", "RETURN_MESSAGE", "RECEIVE_MESSAGE", "MISSING_MESSAGE", "SEARCH_MESSAGE",
+        "TRANSFER_MESSAGE", "OBSTACLE_MESSAGE", "ADJUST_MESSAGE", "AVOID_MESSAGE",
+        "CONSTRUCT_REPLY_MESSAGE", "CONSTRUCT_CONFIRM_MESSAGE", "ROUTE_UPDATE_MESSAGE", "GEOCAST_MESSAGE"
+    };
+    if(type < sizeof(names) / sizeof(names[0])){
+        return names[type];
+    }
+    return "UNKNOWN";
+}
+
+static const char* OutcomeName(uint8_t outcome){
+    switch(outcome){
+        case TRACE_SENT: return "SENT";
+        case TRACE_SEND_FAILED: return "SEND_FAILED";
+        case TRACE_NO_ROUTE: return "NO_ROUTE";
+        case TRACE_RECEIVED: return "RECEIVED";
+        default: return "UNKNOWN";
+    }
+}
+
+static string MacToString(const uint8_t* mac){
+    char buffer[18];
+    snprintf(buffer, sizeof(buffer), "%02x:%02x:%02x:%02x:%02x:%02x", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    return buffer;
+}
+
+int main(int argc, char* argv[]){
+    if(argc < 2){
+        fprintf(stderr, "用法: %s <trace文件> [--summary] [--type=N] [--node=N] [--outcome=N]\n", argv[0]);
+        return 1;
+    }
+
+    bool summary = false;
+    int type_filter = -1;
+    long node_filter = -1;
+    int outcome_filter = -1;
+    for(int i = 2; i < argc; i++){
+        if(strcmp(argv[i], "--summary") == 0){
+            summary = true;
+        }
+        else if(strncmp(argv[i], "--type=", 7) == 0){
+            type_filter = atoi(argv[i] + 7);
+        }
+        else if(strncmp(argv[i], "--node=", 7) == 0){
+            node_filter = atol(argv[i] + 7);
+        }
+        else if(strncmp(argv[i], "--outcome=", 10) == 0){
+            outcome_filter = atoi(argv[i] + 10);
+        }
+        else{
+            fprintf(stderr, "未知参数 %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    FILE* file = fopen(argv[1], "rb");
+    if(!file){
+        fprintf(stderr, "无法打开 %s\n", argv[1]);
+        return 1;
+    }
+    TraceFileHeader header;
+    if(fread(&header, sizeof(header), 1, file) != 1 || header.magic != TRACE_MAGIC){
+        fprintf(stderr, "%s 不是协议trace文件\n", argv[1]);
+        return 1;
+    }
+    if(header.version != TRACE_VERSION || header.record_size != sizeof(TraceRecord)){
+        fprintf(stderr, "trace版本%u(记录%u字节)与解码工具版本%u(记录%u字节)不一致\n",
+                header.version, header.record_size, TRACE_VERSION, (unsigned)sizeof(TraceRecord));
+        return 1;
+    }
+
+    if(!summary){
+        printf("time_s,node,type,group,outcome,src,dst,size\n");
+    }
+    map< pair<uint8_t, uint8_t>, uint64_t > counts;//(类型, 结果) -> 条数
+    uint64_t total = 0;
+    vector<TraceRecord> records(4096);
+    size_t n;
+    while((n = fread(&records[0], sizeof(TraceRecord), records.size(), file)) > 0){
+        for(size_t i = 0; i < n; i++){
+            const TraceRecord& r = records[i];
+            uint8_t type = r.type & 0x7f;
+            if((type_filter >= 0 && type != type_filter) ||
+               (node_filter >= 0 && r.node != (uint32_t)node_filter) ||
+               (outcome_filter >= 0 && r.outcome != outcome_filter)){
+                continue;
+            }
+            total++;
+            if(summary){
+                counts[make_pair(type, r.outcome)]++;
+                continue;
+            }
+            printf("%.9f,%u,%s,%d,%s,%s,%s,%u\n", r.time_ns / 1e9, r.node, TypeName(type), (r.type & 0x80) ? 1 : 0,
+                   OutcomeName(r.outcome), MacToString(r.src).c_str(), MacToString(r.dst).c_str(), r.size);
+        }
+    }
+    fclose(file);
+
+    if(summary){
+        printf("type,outcome,count\n");
+        for(map< pair<uint8_t, uint8_t>, uint64_t >::iterator iter = counts.begin(); iter != counts.end(); iter++){
+            printf("%s,%s,%llu\n", TypeName(iter->first.first), OutcomeName(iter->first.second), (unsigned long long)iter->second);
+        }
+        printf("TOTAL,,%llu\n", (unsigned long long)total);
+    }
+    return 0;
+}